@@ -7,7 +7,8 @@ const char* CgFxKinectDepthToTexture::DEFAULT_TECHNIQUE_NAME = "KinectDepthConve
 
 CgFxKinectDepthToTexture::CgFxKinectDepthToTexture(FBO* resultFBO, Texture2D* kinectDepthTexture) :
 CgFxPostProcessingShader("../resources/shaders/kinect_depth_to_texture.cgfx"),
-kinectDepthTexture(kinectDepthTexture), resultFBO(resultFBO), kinectDepthSamplerParam(NULL) {
+kinectDepthTexture(kinectDepthTexture), resultFBO(resultFBO), nearDistInMm(0.0f), farDistInMm(USHRT_MAX),
+kinectDepthSamplerParam(NULL), nearDistanceParam(NULL), distanceDiffParam(NULL) {
     
     assert(resultFBO != NULL);
     assert(kinectDepthTexture != NULL);
@@ -23,12 +24,18 @@ CgFxKinectDepthToTexture::~CgFxKinectDepthToTexture() {
 void CgFxKinectDepthToTexture::SetupParameterHandles() {
     this->kinectDepthSamplerParam = cgGetNamedEffectParameter(this->cgEffect, "KinectDepthSampler");
     assert(this->kinectDepthSamplerParam != NULL);
+    this->nearDistanceParam = cgGetNamedEffectParameter(this->cgEffect, "NearDistanceInMm");
+    assert(this->nearDistanceParam != NULL);
+    this->distanceDiffParam = cgGetNamedEffectParameter(this->cgEffect, "DistanceDiffInMm");
+    assert(this->distanceDiffParam != NULL);
 
     augengine::debug_cg_state();
 }
 
 void CgFxKinectDepthToTexture::Draw(int screenWidth, int screenHeight) {
     cgGLSetTextureParameter(this->kinectDepthSamplerParam, this->kinectDepthTexture->GetTextureID());
+    cgSetParameter1f(this->nearDistanceParam, this->nearDistInMm);
+    cgSetParameter1f(this->distanceDiffParam, this->farDistInMm - this->nearDistInMm);
     
     this->resultFBO->BindFBO();
     CGpass currPass = cgGetFirstPass(this->currTechnique);
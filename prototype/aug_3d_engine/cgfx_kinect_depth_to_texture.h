@@ -12,6 +12,7 @@ public:
     CgFxKinectDepthToTexture(FBO* resultFBO, Texture2D* kinectDepthTexture);
     ~CgFxKinectDepthToTexture();
 
+    void SetDistanceRangeInMm(float nearDistInMm, float farDistInMm);
     void Draw();
 
 protected:
@@ -22,13 +23,27 @@ private:
 
     FBO* resultFBO;
     Texture2D* kinectDepthTexture;
+    float nearDistInMm;
+    float farDistInMm;
+
     CGparameter kinectDepthSamplerParam;
+    CGparameter nearDistanceParam;
+    CGparameter distanceDiffParam;
 
     void Draw(int screenWidth, int screenHeight);
 
     DISALLOW_COPY_AND_ASSIGN(CgFxKinectDepthToTexture);
 };
 
+/// <summary>
+/// Set the range of raw kinect depths (in mm) that get mapped to [0, 1] in the result FBO.
+/// </summary>
+inline void CgFxKinectDepthToTexture::SetDistanceRangeInMm(float nearDistInMm, float farDistInMm) {
+    assert(farDistInMm > nearDistInMm);
+    this->nearDistInMm = nearDistInMm;
+    this->farDistInMm  = farDistInMm;
+}
+
 inline void CgFxKinectDepthToTexture::Draw() {
     this->Draw(this->resultFBO->GetFBOTexture()->GetWidth(), 
                this->resultFBO->GetFBOTexture()->GetHeight());
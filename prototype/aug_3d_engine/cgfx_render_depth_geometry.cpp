@@ -9,12 +9,18 @@ const char* CgFxRenderDepthGeometry::SHADED_GEOMETRY_TECHNIQUE_NAME = "RenderDep
 
 CgFxRenderDepthGeometry::CgFxRenderDepthGeometry(const Texture2D* depthTexture,
                                                  const Texture2D* colourTexture,
+                                                 const Texture2D* normalTexture,
+                                                 float depthFocalLengthInPixels,
                                                  float nearDistInCm, float farDistInCm) : 
 
 CgFxShader("../resources/shaders/render_depth_geometry.cgfx"), depthTexture(depthTexture),
-colourTexture(colourTexture), nearDistInCm(nearDistInCm), farDistInCm(farDistInCm),
+colourTexture(colourTexture), normalTexture(normalTexture), depthFocalLengthInPixels(depthFocalLengthInPixels),
+nearDistInCm(nearDistInCm), farDistInCm(farDistInCm),
 wvpMatrixParam(NULL), worldMatrixParam(NULL), nearDistanceParam(NULL),
-distanceDiffParam(NULL), depthSamplerParam(NULL) {
+distanceDiffParam(NULL), depthSamplerParam(NULL), normalSamplerParam(NULL),
+depthFocalLengthParam(NULL), depthRayScaleParam(NULL) {
+    assert(normalTexture != NULL);
+    assert(depthFocalLengthInPixels > 0.0f);
 
     bool success = this->SetTechnique(CgFxRenderDepthGeometry::GEOMETRY_ONLY_TECHNIQUE_NAME);
     assert(success);
@@ -40,6 +46,9 @@ void CgFxRenderDepthGeometry::SetupParameterHandles() {
     this->distanceDiffParam           = cgGetNamedEffectParameter(this->cgEffect, "DistanceDiffInCm");
     this->depthSamplerParam           = cgGetNamedEffectParameter(this->cgEffect, "DepthSampler");
     this->colourSamplerParam          = cgGetNamedEffectParameter(this->cgEffect, "ColourSampler");
+    this->normalSamplerParam          = cgGetNamedEffectParameter(this->cgEffect, "NormalSampler");
+    this->depthFocalLengthParam       = cgGetNamedEffectParameter(this->cgEffect, "DepthFocalLengthInPixels");
+    this->depthRayScaleParam          = cgGetNamedEffectParameter(this->cgEffect, "DepthRayScale");
     
     this->keyLightPosParam      = cgGetNamedEffectParameter(this->cgEffect, "KeyPointLightPos");
     this->keyLightColourParam   = cgGetNamedEffectParameter(this->cgEffect, "KeyPointLightColour");
@@ -58,6 +67,14 @@ void CgFxRenderDepthGeometry::SetupBeforePasses(const Camera& camera) {
 
     cgGLSetTextureParameter(this->depthSamplerParam, this->depthTexture->GetTextureID());
     cgGLSetTextureParameter(this->colourSamplerParam, this->colourTexture->GetTextureID());
+    cgGLSetTextureParameter(this->normalSamplerParam, this->normalTexture->GetTextureID());
+
+    // Texture coordinates span the centres of the first and last depth pixels, so a coordinate's
+    // offset from the centre of the image times these is the direction of its ray (over its depth)
+    cgSetParameter1f(this->depthFocalLengthParam, this->depthFocalLengthInPixels);
+    cgSetParameter2f(this->depthRayScaleParam,
+        (static_cast<float>(this->normalTexture->GetWidth()) - 1.0f) / this->depthFocalLengthInPixels,
+        (static_cast<float>(this->normalTexture->GetHeight()) - 1.0f) / this->depthFocalLengthInPixels);
 
     cgSetParameter1f(this->nearDistanceParam, this->nearDistInCm);
     cgSetParameter1f(this->distanceDiffParam, this->farDistInCm - this->nearDistInCm);
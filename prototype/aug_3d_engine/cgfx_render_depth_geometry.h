@@ -4,6 +4,7 @@
 // AugEngine Includes
 #include "common.h"
 #include "cgfx_shader.h"
+#include "depth_displaced_mesh.h"
 
 class Texture2D;
 class Camera;
@@ -14,12 +15,14 @@ public:
     static const char* SHADED_GEOMETRY_TECHNIQUE_NAME;
 
     CgFxRenderDepthGeometry(const Texture2D* depthTexture, const Texture2D* colourTexture,
+                            const Texture2D* normalTexture, float depthFocalLengthInPixels,
                             float nearDistInCm, float farDistInCm);
     ~CgFxRenderDepthGeometry();
 
-	void Draw(const Camera& camera, GLuint displayListID);
+	void Draw(const Camera& camera, const DepthDisplacedMesh& mesh);
 
     void SetLightPosition(const Eigen::Vector3f& pos);
+    void SetDistanceRangeInCm(float nearDistInCm, float farDistInCm);
     
 protected:
     void SetupParameterHandles();
@@ -27,6 +30,8 @@ protected:
 private:
     const Texture2D* depthTexture;
     const Texture2D* colourTexture;
+    const Texture2D* normalTexture;     // Packed normals of the depth image (see DepthNormalMap)
+    float depthFocalLengthInPixels;     // Focal length the normals were estimated with
 
     float nearDistInCm;
     float farDistInCm;
@@ -39,6 +44,9 @@ private:
     CGparameter distanceDiffParam;
     CGparameter depthSamplerParam;
     CGparameter colourSamplerParam;
+    CGparameter normalSamplerParam;
+    CGparameter depthFocalLengthParam;
+    CGparameter depthRayScaleParam;
 
     CGparameter keyLightPosParam;
     CGparameter keyLightColourParam;
@@ -46,18 +54,18 @@ private:
     CGparameter shininessParam;
 
     void SetupBeforePasses(const Camera& camera);
-    void DrawPass(CGpass pass, GLuint displayListID);
+    void DrawPass(CGpass pass, const DepthDisplacedMesh& mesh);
 
     DISALLOW_COPY_AND_ASSIGN(CgFxRenderDepthGeometry);
 };
 
-inline void CgFxRenderDepthGeometry::Draw(const Camera& camera, GLuint displayListID) {
+inline void CgFxRenderDepthGeometry::Draw(const Camera& camera, const DepthDisplacedMesh& mesh) {
 	this->SetupBeforePasses(camera);
 	
 	// Draw each pass of this effect
 	CGpass currPass = cgGetFirstPass(this->currTechnique);
 	while (currPass) {
-		this->DrawPass(currPass, displayListID);
+		this->DrawPass(currPass, mesh);
 		currPass = cgGetNextPass(currPass);
 	}
 }
@@ -66,9 +74,16 @@ inline void CgFxRenderDepthGeometry::SetLightPosition(const Eigen::Vector3f& pos
     cgSetParameter3f(this->keyLightPosParam, pos.x(), pos.y(), pos.z());
 }
 
-inline void CgFxRenderDepthGeometry::DrawPass(CGpass pass, GLuint displayListID) {
+/// <summary> Set the range of distances the depth texture was converted over (see CgFxKinectDepthToTexture). </summary>
+inline void CgFxRenderDepthGeometry::SetDistanceRangeInCm(float nearDistInCm, float farDistInCm) {
+    assert(nearDistInCm < farDistInCm);
+    this->nearDistInCm = nearDistInCm;
+    this->farDistInCm  = farDistInCm;
+}
+
+inline void CgFxRenderDepthGeometry::DrawPass(CGpass pass, const DepthDisplacedMesh& mesh) {
 	cgSetPassState(pass);
-	glCallList(displayListID);
+	mesh.Draw();
 	cgResetPassState(pass);
 }
 
@@ -0,0 +1,77 @@
+#include "cpu_features.h"
+
+// Intrinsics Includes
+#include <intrin.h>
+
+// AVX2 (and _xgetbv for checking that the OS supports it) can only be detected, and used, from Visual Studio 2012
+#if defined(_MSC_VER) && _MSC_VER >= 1700
+#define AUGENGINE_CPU_FEATURES_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace augengine {
+namespace cpufeatures {
+
+static InstructionSet DetectSupportedInstructionSet() {
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+    int maxFunctionId = cpuInfo[0];
+    __cpuid(cpuInfo, 1);
+
+#ifdef AUGENGINE_CPU_FEATURES_AVX2
+    // AVX2 needs both the CPU and the OS (which must save/restore the YMM registers) to support it
+    bool hasOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+    bool hasAVX     = (cpuInfo[2] & (1 << 28)) != 0;
+    if (hasOSXSave && hasAVX && maxFunctionId >= 7 && (_xgetbv(0) & 0x6) == 0x6) {
+        int extendedCpuInfo[4];
+        __cpuidex(extendedCpuInfo, 7, 0);
+        if ((extendedCpuInfo[1] & (1 << 5)) != 0) {
+            return AVX2;
+        }
+    }
+#else
+    UNUSED_PARAMETER(maxFunctionId);
+#endif
+
+    bool hasSSE2 = (cpuInfo[3] & (1 << 26)) != 0;
+    return hasSSE2 ? SSE2 : Scalar;
+}
+
+static const InstructionSet SUPPORTED_INSTRUCTION_SET = DetectSupportedInstructionSet();
+static InstructionSet currInstructionSet = SUPPORTED_INSTRUCTION_SET;
+
+/// <summary> Gets the best instruction set that is supported by both the CPU and this build. </summary>
+InstructionSet GetSupportedInstructionSet() {
+    return SUPPORTED_INSTRUCTION_SET;
+}
+
+/// <summary> Gets the instruction set the SIMD kernels currently use. </summary>
+InstructionSet GetInstructionSet() {
+    return currInstructionSet;
+}
+
+/// <summary>
+/// Force the SIMD kernels to use the given instruction set (e.g., Scalar for comparing against
+/// them), it is limited to the supported instruction set. This must not be called while a
+/// kernel is running on another thread.
+/// </summary>
+void SetInstructionSet(InstructionSet instructionSet) {
+    currInstructionSet = std::min<InstructionSet>(instructionSet, SUPPORTED_INSTRUCTION_SET);
+}
+
+const char* GetInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case Scalar:
+            return "Scalar";
+        case SSE2:
+            return "SSE2";
+        case AVX2:
+            return "AVX2";
+        default:
+            assert(false);
+            return "";
+    }
+}
+
+}; // namespace cpufeatures
+}; // namespace augengine
\ No newline at end of file
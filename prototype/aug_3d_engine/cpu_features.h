@@ -0,0 +1,27 @@
+#ifndef AUG3DENGINE_CPUFEATURES_H_
+#define AUG3DENGINE_CPUFEATURES_H_
+
+// AugEngine Includes
+#include "common.h"
+
+namespace augengine {
+
+/// <summary>
+/// Detects the best SIMD instruction set (scalar, SSE2 or AVX2) supported by both the CPU and
+/// this build, once at start-up. The engine's SIMD kernels check it to choose between their
+/// scalar and SIMD implementations, which give the same results.
+/// </summary>
+namespace cpufeatures {
+
+enum InstructionSet { Scalar = 0, SSE2 = 1, AVX2 = 2 };
+
+InstructionSet GetSupportedInstructionSet();
+InstructionSet GetInstructionSet();
+void SetInstructionSet(InstructionSet instructionSet);
+const char* GetInstructionSetName(InstructionSet instructionSet);
+
+}; // namespace cpufeatures
+
+}; // namespace augengine
+
+#endif // AUG3DENGINE_CPUFEATURES_H_
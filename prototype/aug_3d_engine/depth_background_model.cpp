@@ -0,0 +1,93 @@
+// AugEngine Includes
+#include "depth_background_model.h"
+
+const float DepthBackgroundModel::DEFAULT_LEARNING_RATE             = 0.02f;
+const float DepthBackgroundModel::DEFAULT_MIN_FOREGROUND_DIST_IN_MM = 50.0f;
+const float DepthBackgroundModel::DEFAULT_FOREGROUND_DIST_FRACTION  = 0.04f;
+
+// Smallest number of rows modelled by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK = 16;
+
+DepthBackgroundModel::DepthBackgroundModel(int width, int height, ThreadPool* threadPool) :
+width(width), height(height), threadPool(threadPool), learningRate(DEFAULT_LEARNING_RATE),
+minForegroundDistInMm(DEFAULT_MIN_FOREGROUND_DIST_IN_MM), foregroundDistFraction(DEFAULT_FOREGROUND_DIST_FRACTION),
+absorbFrames(DEFAULT_ABSORB_FRAMES), backgroundDepthInMm(width*height, 0.0f),
+candidateDepthInMm(width*height, 0), candidateAge(width*height, 0), modelRowsTask(*this) {
+    assert(width > 0 && height > 0);
+    assert(threadPool != NULL);
+}
+
+DepthBackgroundModel::~DepthBackgroundModel() {
+}
+
+/// <summary> Forget the learned background, the next frame is taken as the background. </summary>
+void DepthBackgroundModel::Reset() {
+    std::fill(this->backgroundDepthInMm.begin(), this->backgroundDepthInMm.end(), 0.0f);
+    std::fill(this->candidateDepthInMm.begin(), this->candidateDepthInMm.end(), 0);
+    std::fill(this->candidateAge.begin(), this->candidateAge.end(), 0);
+}
+
+/// <summary>
+/// Learn from the given depth image (which must be the size of the model) and mark its pixels
+/// that are in front of the background in the given mask.
+/// </summary>
+void DepthBackgroundModel::Apply(const USHORT* depthInMm, ForegroundMask& foregroundMask) {
+    assert(depthInMm != NULL);
+    if (foregroundMask.GetWidth() != this->width || foregroundMask.GetHeight() != this->height) {
+        foregroundMask.Resize(this->width, this->height);
+    }
+
+    this->modelRowsTask.depthInMm = depthInMm;
+    this->modelRowsTask.foregroundMask = &foregroundMask;
+    this->threadPool->ParallelFor(this->modelRowsTask, this->height, MIN_ROWS_PER_CHUNK);
+}
+
+void DepthBackgroundModel::ModelRowsTask::Run(size_t beginRow, size_t endRow) {
+    DepthBackgroundModel& model = this->model;
+
+    for (size_t y = beginRow; y < endRow; y++) {
+        UINT32* maskRow = this->foregroundMask->GetRow(static_cast<int>(y));
+        std::fill(maskRow, maskRow + this->foregroundMask->GetWordsPerRow(), 0);
+
+        size_t rowStartIdx = y * model.width;
+        for (int x = 0; x < model.width; x++) {
+            size_t i = rowStartIdx + x;
+            USHORT depthInMm = this->depthInMm[i];
+            if (depthInMm == 0) {
+                continue;
+            }
+
+            float& backgroundDepthInMm = model.backgroundDepthInMm[i];
+            float foregroundDistInMm = model.GetForegroundDist(backgroundDepthInMm);
+            if (backgroundDepthInMm == 0.0f || depthInMm > backgroundDepthInMm + foregroundDistInMm) {
+                // Nothing seen here yet, or the background was covered when it was learned
+                backgroundDepthInMm = depthInMm;
+                model.candidateAge[i] = 0;
+                continue;
+            }
+            if (depthInMm >= backgroundDepthInMm - foregroundDistInMm) {
+                backgroundDepthInMm += model.learningRate * (depthInMm - backgroundDepthInMm);
+                model.candidateAge[i] = 0;
+                continue;
+            }
+
+            // In front of the background, see whether it has stayed put long enough to become background
+            USHORT& candidateDepthInMm = model.candidateDepthInMm[i];
+            USHORT& candidateAge = model.candidateAge[i];
+            if (candidateAge > 0 && fabs(static_cast<float>(depthInMm - candidateDepthInMm)) <= model.GetForegroundDist(candidateDepthInMm)) {
+                candidateAge++;
+            }
+            else {
+                candidateDepthInMm = depthInMm;
+                candidateAge = 1;
+            }
+            if (candidateAge >= model.absorbFrames) {
+                backgroundDepthInMm = candidateDepthInMm;
+                candidateAge = 0;
+                continue;
+            }
+
+            maskRow[x >> 5] |= 1u << (x & 31);
+        }
+    }
+}
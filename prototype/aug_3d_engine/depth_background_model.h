@@ -0,0 +1,92 @@
+#ifndef AUG3DENGINE_DEPTHBACKGROUNDMODEL_H_
+#define AUG3DENGINE_DEPTHBACKGROUNDMODEL_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+#include "foreground_mask.h"
+
+/// <summary>
+/// Learns the static scene (walls, floor, plinths) seen by a fixed kinect and marks the pixels of
+/// each depth image (16-bit, in mm) that are in front of it as foreground:
+///  - Every pixel has a background depth that slowly follows the depths that agree with it.
+///  - Depths behind the background depth replace it straight away, whatever was covering the
+///    background when it was learned has moved away.
+///  - Depths in front of the background depth are foreground, unless they have stayed put for long
+///    enough, in which case something was left in the scene and it becomes part of the background.
+///  - Holes (zero depth) are never foreground.
+/// The image is split into rows that are modelled in parallel on a thread pool.
+/// </summary>
+class DepthBackgroundModel {
+public:
+    static const float DEFAULT_LEARNING_RATE;
+    static const float DEFAULT_MIN_FOREGROUND_DIST_IN_MM;
+    static const float DEFAULT_FOREGROUND_DIST_FRACTION;
+    static const unsigned int DEFAULT_ABSORB_FRAMES = 300;
+
+    DepthBackgroundModel(int width, int height, ThreadPool* threadPool);
+    ~DepthBackgroundModel();
+
+    void SetLearningRate(float learningRate);
+    void SetForegroundDistance(float minForegroundDistInMm, float foregroundDistFraction);
+    void SetAbsorbFrames(unsigned int absorbFrames);
+
+    void Reset();
+    void Apply(const USHORT* depthInMm, ForegroundMask& foregroundMask);
+
+private:
+    // Models a range of rows of the current frame
+    class ModelRowsTask : public ParallelTask {
+    public:
+        ModelRowsTask(DepthBackgroundModel& model) : model(model), depthInMm(NULL), foregroundMask(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthBackgroundModel& model;
+        const USHORT* depthInMm;
+        ForegroundMask* foregroundMask;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(ModelRowsTask);
+    };
+
+    int width, height;
+    ThreadPool* threadPool; // Not owned by this
+
+    float learningRate;             // How far (in (0,1]) the background depth moves towards each depth that agrees with it
+    float minForegroundDistInMm;    // Smallest distance in front of the background that is foreground
+    float foregroundDistFraction;   // Distance in front of the background (as a fraction of the depth) that is foreground
+    unsigned int absorbFrames;      // Number of frames a foreground depth has to stay put for to become background
+
+    std::vector<float> backgroundDepthInMm;     // Per pixel background depth, zero if none has been seen
+    std::vector<USHORT> candidateDepthInMm;     // Per pixel foreground depth that may become background
+    std::vector<USHORT> candidateAge;           // Per pixel number of frames the candidate depth has stayed put
+
+    ModelRowsTask modelRowsTask;
+
+    float GetForegroundDist(float depthInMm) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthBackgroundModel);
+};
+
+inline void DepthBackgroundModel::SetLearningRate(float learningRate) {
+    assert(learningRate > 0.0f && learningRate <= 1.0f);
+    this->learningRate = learningRate;
+}
+
+inline void DepthBackgroundModel::SetForegroundDistance(float minForegroundDistInMm, float foregroundDistFraction) {
+    assert(minForegroundDistInMm >= 0.0f && foregroundDistFraction >= 0.0f);
+    this->minForegroundDistInMm  = minForegroundDistInMm;
+    this->foregroundDistFraction = foregroundDistFraction;
+}
+
+inline void DepthBackgroundModel::SetAbsorbFrames(unsigned int absorbFrames) {
+    assert(absorbFrames > 0 && absorbFrames < USHRT_MAX);
+    this->absorbFrames = absorbFrames;
+}
+
+/// <summary> Get the distance a depth has to be in front of the background by to be foreground (noise grows with depth). </summary>
+inline float DepthBackgroundModel::GetForegroundDist(float depthInMm) const {
+    return std::max<float>(this->minForegroundDistInMm, this->foregroundDistFraction * depthInMm);
+}
+
+#endif // AUG3DENGINE_DEPTHBACKGROUNDMODEL_H_
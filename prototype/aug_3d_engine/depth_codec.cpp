@@ -0,0 +1,247 @@
+#include "depth_codec.h"
+#include "cpu_features.h"
+
+// Intrinsics Includes
+#include <intrin.h>
+#include <emmintrin.h>
+
+namespace augengine {
+namespace depthcodec {
+
+// Number of bytes of the bit plane of one block
+static const size_t BIT_PLANE_SIZE = BLOCK_SIZE / 8;
+// Largest number of bits of a residual (and of bit planes of a block)
+static const int MAX_BITS = 16;
+
+/// <summary> Gets the number of depths in the given image, rounded up to a whole number of blocks. </summary>
+inline size_t GetNumBlocks(int width, int height) {
+    return (static_cast<size_t>(width) * height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+inline USHORT ZigZagEncode(USHORT depthInMm, USHORT predictedDepthInMm) {
+    short residual = static_cast<short>(depthInMm - predictedDepthInMm);
+    return static_cast<USHORT>((residual << 1) ^ (residual >> 15));
+}
+
+inline USHORT ZigZagDecode(USHORT encodedResidual, USHORT predictedDepthInMm) {
+    USHORT residual = static_cast<USHORT>((encodedResidual >> 1) ^ (0 - (encodedResidual & 1)));
+    return static_cast<USHORT>(predictedDepthInMm + residual);
+}
+
+/// <summary> Gets the number of bits needed for the given value. </summary>
+inline int GetNumBits(unsigned int value) {
+    unsigned long highestBit;
+    if (!_BitScanReverse(&highestBit, value)) {
+        return 0;
+    }
+    return static_cast<int>(highestBit) + 1;
+}
+
+// Scalar Kernels ****************************************************************************
+
+/// <summary>
+/// Encode the depths of the block starting at the given index, depths past the end of the
+/// image are encoded as zero residuals.
+/// </summary>
+/// <returns> The byte past the end of the encoded block. </returns>
+static BYTE* EncodeBlockScalar(const USHORT* depthInMm, size_t width, size_t numDepths, size_t blockStart, BYTE* encoded) {
+    USHORT residuals[BLOCK_SIZE];
+    USHORT allResidualBits = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        size_t idx = blockStart + i;
+        if (idx >= numDepths) {
+            residuals[i] = 0;
+            continue;
+        }
+        residuals[i] = ZigZagEncode(depthInMm[idx], idx < width ? 0 : depthInMm[idx - width]);
+        allResidualBits |= residuals[i];
+    }
+
+    int numBits = GetNumBits(allResidualBits);
+    *encoded++ = static_cast<BYTE>(numBits);
+    for (int bit = 0; bit < numBits; bit++) {
+        USHORT bitPlane = 0;
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            bitPlane |= ((residuals[i] >> bit) & 1) << i;
+        }
+        *encoded++ = static_cast<BYTE>(bitPlane);
+        *encoded++ = static_cast<BYTE>(bitPlane >> 8);
+    }
+    return encoded;
+}
+
+/// <summary> Decode the block starting at the given index, the rows above it must already be decoded. </summary>
+/// <returns> The byte past the end of the encoded block, NULL if the block is corrupt. </returns>
+static const BYTE* DecodeBlockScalar(const BYTE* encoded, const BYTE* encodedEnd, size_t width, size_t numDepths,
+                                     size_t blockStart, USHORT* depthInMm) {
+    if (encoded >= encodedEnd) {
+        return NULL;
+    }
+    int numBits = *encoded++;
+    if (numBits > MAX_BITS || static_cast<size_t>(encodedEnd - encoded) < numBits * BIT_PLANE_SIZE) {
+        return NULL;
+    }
+
+    USHORT residuals[BLOCK_SIZE] = { 0 };
+    for (int bit = 0; bit < numBits; bit++) {
+        USHORT bitPlane = static_cast<USHORT>(encoded[0] | (encoded[1] << 8));
+        encoded += BIT_PLANE_SIZE;
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            residuals[i] |= ((bitPlane >> i) & 1) << bit;
+        }
+    }
+
+    size_t blockEnd = std::min<size_t>(blockStart + BLOCK_SIZE, numDepths);
+    for (size_t idx = blockStart; idx < blockEnd; idx++) {
+        depthInMm[idx] = ZigZagDecode(residuals[idx - blockStart], idx < width ? 0 : depthInMm[idx - width]);
+    }
+    return encoded;
+}
+
+// SSE2 Kernels ******************************************************************************
+
+// NOTE: A block only reads depths of the rows above it, which are a whole row back (and so in an
+// earlier block) as long as the image is at least a block wide. Blocks in the first row and the
+// last (partial) block go through the scalar kernels.
+
+static BYTE* EncodeBlockSSE2(const USHORT* depthInMm, size_t width, size_t blockStart, BYTE* encoded) {
+    const USHORT* depths = depthInMm + blockStart;
+    const USHORT* predictedDepths = depths - width;
+
+    __m128i residualsLo = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(depths)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(predictedDepths)));
+    __m128i residualsHi = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(depths + 8)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(predictedDepths + 8)));
+    residualsLo = _mm_xor_si128(_mm_slli_epi16(residualsLo, 1), _mm_srai_epi16(residualsLo, 15));
+    residualsHi = _mm_xor_si128(_mm_slli_epi16(residualsHi, 1), _mm_srai_epi16(residualsHi, 15));
+
+    // OR all the residuals together to find how many bits the largest one needs
+    __m128i allResidualBits = _mm_or_si128(residualsLo, residualsHi);
+    allResidualBits = _mm_or_si128(allResidualBits, _mm_srli_si128(allResidualBits, 8));
+    allResidualBits = _mm_or_si128(allResidualBits, _mm_srli_si128(allResidualBits, 4));
+    allResidualBits = _mm_or_si128(allResidualBits, _mm_srli_si128(allResidualBits, 2));
+    int numBits = GetNumBits(_mm_cvtsi128_si32(allResidualBits) & 0xFFFF);
+
+    // Each bit plane is gathered by shifting its bit into the sign bit, the signed saturating
+    // pack keeps the sign of every residual and the byte mask then picks up all 16 sign bits
+    *encoded++ = static_cast<BYTE>(numBits);
+    for (int bit = 0; bit < numBits; bit++) {
+        __m128i shift = _mm_cvtsi32_si128(15 - bit);
+        int bitPlane = _mm_movemask_epi8(_mm_packs_epi16(_mm_sll_epi16(residualsLo, shift),
+                                                         _mm_sll_epi16(residualsHi, shift)));
+        *encoded++ = static_cast<BYTE>(bitPlane);
+        *encoded++ = static_cast<BYTE>(bitPlane >> 8);
+    }
+    return encoded;
+}
+
+static const BYTE* DecodeBlockSSE2(const BYTE* encoded, const BYTE* encodedEnd, size_t width,
+                                   size_t blockStart, USHORT* depthInMm) {
+    if (encoded >= encodedEnd) {
+        return NULL;
+    }
+    int numBits = *encoded++;
+    if (numBits > MAX_BITS || static_cast<size_t>(encodedEnd - encoded) < numBits * BIT_PLANE_SIZE) {
+        return NULL;
+    }
+
+    // Bit i of a bit plane belongs to depth i of the block
+    const __m128i laneBitsLo = _mm_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080);
+    const __m128i laneBitsHi = _mm_setr_epi16(0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000,
+                                              static_cast<short>(0x8000));
+
+    __m128i residualsLo = _mm_setzero_si128();
+    __m128i residualsHi = _mm_setzero_si128();
+    for (int bit = 0; bit < numBits; bit++) {
+        __m128i bitPlane = _mm_set1_epi16(static_cast<short>(encoded[0] | (encoded[1] << 8)));
+        __m128i bitValue = _mm_set1_epi16(static_cast<short>(1 << bit));
+        encoded += BIT_PLANE_SIZE;
+
+        residualsLo = _mm_or_si128(residualsLo, _mm_and_si128(bitValue,
+            _mm_cmpeq_epi16(_mm_and_si128(bitPlane, laneBitsLo), laneBitsLo)));
+        residualsHi = _mm_or_si128(residualsHi, _mm_and_si128(bitValue,
+            _mm_cmpeq_epi16(_mm_and_si128(bitPlane, laneBitsHi), laneBitsHi)));
+    }
+
+    // Undo the zig-zag and add the residuals to the depths above
+    const __m128i one = _mm_set1_epi16(1);
+    residualsLo = _mm_xor_si128(_mm_srli_epi16(residualsLo, 1), _mm_sub_epi16(_mm_setzero_si128(),
+                                                                              _mm_and_si128(residualsLo, one)));
+    residualsHi = _mm_xor_si128(_mm_srli_epi16(residualsHi, 1), _mm_sub_epi16(_mm_setzero_si128(),
+                                                                              _mm_and_si128(residualsHi, one)));
+
+    USHORT* depths = depthInMm + blockStart;
+    const USHORT* predictedDepths = depths - width;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(depths), _mm_add_epi16(residualsLo,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(predictedDepths))));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(depths + 8), _mm_add_epi16(residualsHi,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(predictedDepths + 8))));
+    return encoded;
+}
+
+// Codec *************************************************************************************
+
+/// <summary> Gets the largest number of bytes that encoding an image of the given size can take. </summary>
+size_t GetMaxEncodedSize(int width, int height) {
+    return GetNumBlocks(width, height) * (1 + MAX_BITS * BIT_PLANE_SIZE);
+}
+
+/// <summary>
+/// Encode the given depth image into the given buffer, which must hold at least
+/// GetMaxEncodedSize bytes. The image must be at least BLOCK_SIZE wide.
+/// </summary>
+/// <returns> The number of bytes of the encoded image. </returns>
+size_t Encode(const USHORT* depthInMm, int width, int height, BYTE* encoded) {
+    assert(depthInMm != NULL && encoded != NULL);
+    assert(width >= BLOCK_SIZE && height > 0);
+
+    size_t numDepths = static_cast<size_t>(width) * height;
+    size_t numBlocks = GetNumBlocks(width, height);
+    BYTE* encodedStart = encoded;
+
+    size_t blockIdx = 0;
+    if (cpufeatures::GetInstructionSet() != cpufeatures::Scalar) {
+        // The first row has no depths above it and the last block may be partial
+        for (; blockIdx * BLOCK_SIZE < static_cast<size_t>(width); blockIdx++) {
+            encoded = EncodeBlockScalar(depthInMm, width, numDepths, blockIdx * BLOCK_SIZE, encoded);
+        }
+        for (; (blockIdx + 1) * BLOCK_SIZE <= numDepths; blockIdx++) {
+            encoded = EncodeBlockSSE2(depthInMm, width, blockIdx * BLOCK_SIZE, encoded);
+        }
+    }
+    for (; blockIdx < numBlocks; blockIdx++) {
+        encoded = EncodeBlockScalar(depthInMm, width, numDepths, blockIdx * BLOCK_SIZE, encoded);
+    }
+
+    assert(static_cast<size_t>(encoded - encodedStart) <= GetMaxEncodedSize(width, height));
+    return encoded - encodedStart;
+}
+
+/// <summary> Decode the given encoded image (of the given size) into the given depth image. </summary>
+/// <returns> true if the whole image was decoded, false if the encoded image is truncated or corrupt. </returns>
+bool Decode(const BYTE* encoded, size_t encodedSize, int width, int height, USHORT* depthInMm) {
+    assert(encoded != NULL && depthInMm != NULL);
+    assert(width >= BLOCK_SIZE && height > 0);
+
+    size_t numDepths = static_cast<size_t>(width) * height;
+    size_t numBlocks = GetNumBlocks(width, height);
+    const BYTE* encodedEnd = encoded + encodedSize;
+
+    size_t blockIdx = 0;
+    if (cpufeatures::GetInstructionSet() != cpufeatures::Scalar) {
+        for (; encoded != NULL && blockIdx * BLOCK_SIZE < static_cast<size_t>(width); blockIdx++) {
+            encoded = DecodeBlockScalar(encoded, encodedEnd, width, numDepths, blockIdx * BLOCK_SIZE, depthInMm);
+        }
+        for (; encoded != NULL && (blockIdx + 1) * BLOCK_SIZE <= numDepths; blockIdx++) {
+            encoded = DecodeBlockSSE2(encoded, encodedEnd, width, blockIdx * BLOCK_SIZE, depthInMm);
+        }
+    }
+    for (; encoded != NULL && blockIdx < numBlocks; blockIdx++) {
+        encoded = DecodeBlockScalar(encoded, encodedEnd, width, numDepths, blockIdx * BLOCK_SIZE, depthInMm);
+    }
+
+    return encoded == encodedEnd;
+}
+
+}; // namespace depthcodec
+}; // namespace augengine
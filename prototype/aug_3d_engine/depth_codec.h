@@ -0,0 +1,31 @@
+#ifndef AUG3DENGINE_DEPTHCODEC_H_
+#define AUG3DENGINE_DEPTHCODEC_H_
+
+// AugEngine Includes
+#include "common.h"
+
+namespace augengine {
+
+/// <summary>
+/// Lossless codec for 16-bit kinect depth images (in mm):
+///  - Every depth is predicted by the depth right above it (the first row by zero) and the
+///    residual is zig-zag encoded, so small residuals of either sign become small numbers.
+///  - The residuals are split into blocks of BLOCK_SIZE, each block is stored as one byte holding
+///    the number of bits of its largest residual followed by that many bit planes (one 16-bit
+///    mask per bit). Flat surfaces and holes take few (or no) bit planes.
+/// The SSE2 and scalar implementations (picked at runtime, see cpufeatures::GetInstructionSet)
+/// write exactly the same bytes.
+/// </summary>
+namespace depthcodec {
+
+static const int BLOCK_SIZE = 16;
+
+size_t GetMaxEncodedSize(int width, int height);
+size_t Encode(const USHORT* depthInMm, int width, int height, BYTE* encoded);
+bool Decode(const BYTE* encoded, size_t encodedSize, int width, int height, USHORT* depthInMm);
+
+}; // namespace depthcodec
+
+}; // namespace augengine
+
+#endif // AUG3DENGINE_DEPTHCODEC_H_
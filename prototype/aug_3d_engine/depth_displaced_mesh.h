@@ -0,0 +1,19 @@
+#ifndef AUG3DENGINE_DEPTHDISPLACEDMESH_H_
+#define AUG3DENGINE_DEPTHDISPLACEDMESH_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Flat mesh in the z = 0 plane whose vertices carry the texture coordinates of depth pixels, for
+/// vertex shaders that displace it by sampling the depth texture (see CgFxRenderDepthGeometry).
+/// </summary>
+class DepthDisplacedMesh {
+public:
+    virtual ~DepthDisplacedMesh() {}
+
+    virtual size_t GetNumTriangles() const = 0;
+    virtual void Draw() const = 0;
+};
+
+#endif // AUG3DENGINE_DEPTHDISPLACEDMESH_H_
@@ -0,0 +1,113 @@
+// AugEngine Includes
+#include "depth_grid_mesh.h"
+
+DepthGridMesh::DepthGridMesh(int width, int height, float cellSize) : width(width), height(height),
+cellSize(cellSize), vertexBuffer(0), indexBuffer(0), numIndices(0), usePrimitiveRestart(false) {
+}
+
+DepthGridMesh::~DepthGridMesh() {
+    if (this->vertexBuffer != 0) {
+        glDeleteBuffers(1, &this->vertexBuffer);
+        this->vertexBuffer = 0;
+    }
+    if (this->indexBuffer != 0) {
+        glDeleteBuffers(1, &this->indexBuffer);
+        this->indexBuffer = 0;
+    }
+}
+
+/// <summary> Build the grid for a depth image of the given size, with vertices the given distance apart. </summary>
+/// <returns> The new grid, NULL if vertex buffer objects aren't supported. </returns>
+DepthGridMesh* DepthGridMesh::Build(int width, int height, float cellSize) {
+    assert(width > 1 && height > 1 && cellSize > 0.0f);
+    if (!GLEW_VERSION_1_5 && !GLEW_ARB_vertex_buffer_object) {
+        std::cerr << "Vertex buffer objects aren't supported, can't build the depth grid." << std::endl;
+        return NULL;
+    }
+
+    std::auto_ptr<DepthGridMesh> newMesh(new DepthGridMesh(width, height, cellSize));
+    newMesh->usePrimitiveRestart = (GLEW_NV_primitive_restart != 0);
+
+    std::vector<Vertex> vertices(width * height);
+    for (int y = 0; y < height; y++) {
+        float v = static_cast<float>(y) / static_cast<float>(height - 1);
+        for (int x = 0; x < width; x++) {
+            Vertex& vertex = vertices[y * width + x];
+            vertex.x = x * cellSize;
+            vertex.y = y * cellSize;
+            vertex.u = static_cast<float>(x) / static_cast<float>(width - 1);
+            vertex.v = v;
+        }
+    }
+
+    // Every strip runs along a pair of rows, alternating between the upper and lower row (so its
+    // triangles are counter-clockwise), and has an even number of vertices so the degenerate
+    // triangles joining the strips don't flip the winding of the next strip
+    std::vector<GLuint> indices;
+    indices.reserve((height - 1) * (2 * width + 2));
+    for (int y = 0; y < height - 1; y++) {
+        if (y > 0) {
+            if (newMesh->usePrimitiveRestart) {
+                indices.push_back(RESTART_INDEX);
+            }
+            else {
+                indices.push_back(indices.back());
+                indices.push_back((y + 1) * width);
+            }
+        }
+        for (int x = 0; x < width; x++) {
+            indices.push_back((y + 1) * width + x);
+            indices.push_back(y * width + x);
+        }
+    }
+    newMesh->numIndices = static_cast<GLsizei>(indices.size());
+
+    glGenBuffers(1, &newMesh->vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, newMesh->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &newMesh->indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, newMesh->indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    augengine::debug_opengl_state();
+    return newMesh.release();
+}
+
+/// <summary>
+/// Draw primitives of the given mode from the grid's vertices, indexed by the given (32-bit)
+/// element buffer, the primitive restart index is RESTART_INDEX if it is used.
+/// </summary>
+void DepthGridMesh::DrawElements(GLenum mode, GLuint elementBuffer, GLsizei numElements, bool usePrimitiveRestart) const {
+    assert(!usePrimitiveRestart || GLEW_NV_primitive_restart);
+    if (numElements == 0) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, x)));
+    glClientActiveTexture(GL_TEXTURE0);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, u)));
+    if (usePrimitiveRestart) {
+        glEnableClientState(GL_PRIMITIVE_RESTART_NV);
+        glPrimitiveRestartIndexNV(RESTART_INDEX);
+    }
+
+    glDrawElements(mode, numElements, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+
+    if (usePrimitiveRestart) {
+        glDisableClientState(GL_PRIMITIVE_RESTART_NV);
+    }
+    glPopClientAttrib();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    augengine::debug_opengl_state();
+}
@@ -0,0 +1,82 @@
+#ifndef AUG3DENGINE_DEPTHGRIDMESH_H_
+#define AUG3DENGINE_DEPTHGRIDMESH_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "depth_displaced_mesh.h"
+
+/// <summary>
+/// Flat grid with a vertex for every pixel of a depth image, for vertex shaders that displace it
+/// by sampling the depth texture (see CgFxRenderDepthGeometry). Each vertex has a position in the
+/// z = 0 plane (cellSize apart, row 0 at y = 0) and the texture coordinate of its pixel. Other
+/// meshes can draw a subset of the grid's vertices with their own indices (see DrawElements).
+///
+/// The grid never changes, so it is built once per depth resolution into static vertex and index
+/// buffers and drawn with a single call: every pair of rows is a triangle strip, the strips are
+/// separated by a primitive restart index (or joined by degenerate triangles if primitive restart
+/// isn't supported).
+/// </summary>
+class DepthGridMesh : public DepthDisplacedMesh {
+public:
+    static const GLuint RESTART_INDEX = 0xFFFFFFFF;
+
+    static DepthGridMesh* Build(int width, int height, float cellSize);
+    ~DepthGridMesh();
+
+    int GetWidth() const;
+    int GetHeight() const;
+    float GetCellSize() const;
+    size_t GetNumTriangles() const;
+
+    void Draw() const;
+    void DrawElements(GLenum mode, GLuint elementBuffer, GLsizei numElements, bool usePrimitiveRestart) const;
+
+    int GetVertexIndex(int x, int y) const;
+
+private:
+    struct Vertex {
+        float x, y;
+        float u, v;
+    };
+
+    DepthGridMesh(int width, int height, float cellSize);
+
+    int width, height;
+    float cellSize;
+
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLsizei numIndices;
+    bool usePrimitiveRestart;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthGridMesh);
+};
+
+inline int DepthGridMesh::GetWidth() const {
+    return this->width;
+}
+
+inline int DepthGridMesh::GetHeight() const {
+    return this->height;
+}
+
+inline float DepthGridMesh::GetCellSize() const {
+    return this->cellSize;
+}
+
+inline size_t DepthGridMesh::GetNumTriangles() const {
+    return 2 * static_cast<size_t>(this->width - 1) * static_cast<size_t>(this->height - 1);
+}
+
+/// <summary> Draw the whole grid, positions go to the vertex array and texture coordinates to texture unit 0. </summary>
+inline void DepthGridMesh::Draw() const {
+    this->DrawElements(GL_TRIANGLE_STRIP, this->indexBuffer, this->numIndices, this->usePrimitiveRestart);
+}
+
+/// <summary> Get the index of the vertex of the given depth pixel. </summary>
+inline int DepthGridMesh::GetVertexIndex(int x, int y) const {
+    assert(x >= 0 && x < this->width && y >= 0 && y < this->height);
+    return y * this->width + x;
+}
+
+#endif // AUG3DENGINE_DEPTHGRIDMESH_H_
@@ -0,0 +1,147 @@
+// AugEngine Includes
+#include "depth_mesh_generator.h"
+
+const float DepthMeshGenerator::DEFAULT_MIN_DISCONTINUITY_IN_MM = 40.0f;
+const float DepthMeshGenerator::DEFAULT_DISCONTINUITY_FRACTION  = 0.04f;
+
+// Smallest number of rows meshed by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK = 8;
+
+DepthMeshGenerator::DepthMeshGenerator(int width, int height, float focalLengthInPixels, ThreadPool* threadPool,
+                                       int step) :
+width(width), height(height), step(step), numVerticesX((width + step - 1) / step), numVerticesY((height + step - 1) / step),
+invFocalLength(1.0f / focalLengthInPixels), threadPool(threadPool),
+minDiscontinuityInMm(DEFAULT_MIN_DISCONTINUITY_IN_MM), discontinuityFraction(DEFAULT_DISCONTINUITY_FRACTION),
+cellTriangles(std::max<int>(numVerticesX - 1, 0) * std::max<int>(numVerticesY - 1, 0), 0),
+rowFirstIndices(std::max<int>(numVerticesY - 1, 0) + 1, 0), buildRowsTask(*this), writeIndicesTask(*this) {
+    assert(width > 0 && height > 0 && step > 0);
+    assert(focalLengthInPixels > 0.0f);
+    assert(threadPool != NULL);
+    assert(numVerticesX > 1 && numVerticesY > 1);
+}
+
+DepthMeshGenerator::~DepthMeshGenerator() {
+}
+
+/// <summary> Replace the given mesh with the mesh of the given depth image (which must be the size of the generator). </summary>
+void DepthMeshGenerator::Generate(const USHORT* depthInMm, DepthMesh& mesh) {
+    assert(depthInMm != NULL);
+
+    // Only the first mesh allocates, for the most triangles the image can have
+    size_t numVertices = this->numVerticesX * this->numVerticesY;
+    if (mesh.vertices.size() != numVertices) {
+        mesh.vertices.resize(numVertices);
+        mesh.indices.resize(this->cellTriangles.size() * 2 * 3);
+    }
+
+    this->buildRowsTask.depthInMm = depthInMm;
+    this->buildRowsTask.mesh = &mesh;
+    this->threadPool->ParallelFor(this->buildRowsTask, this->numVerticesY, MIN_ROWS_PER_CHUNK);
+
+    // Every row's triangles go right after the triangles of the rows before it
+    int numCellsX = this->numVerticesX - 1;
+    for (int cellY = 0; cellY < this->numVerticesY - 1; cellY++) {
+        size_t numRowIndices = 0;
+        const BYTE* rowCells = &this->cellTriangles[cellY * numCellsX];
+        for (int cellX = 0; cellX < numCellsX; cellX++) {
+            numRowIndices += 3 * ((rowCells[cellX] & UPPER_TRIANGLE) + ((rowCells[cellX] & LOWER_TRIANGLE) >> 1));
+        }
+        this->rowFirstIndices[cellY + 1] = this->rowFirstIndices[cellY] + numRowIndices;
+    }
+    mesh.numIndices = this->rowFirstIndices.back();
+
+    this->writeIndicesTask.mesh = &mesh;
+    this->threadPool->ParallelFor(this->writeIndicesTask, this->numVerticesY - 1, MIN_ROWS_PER_CHUNK);
+}
+
+void DepthMeshGenerator::BuildRowsTask::Run(size_t beginRow, size_t endRow) {
+    DepthMeshGenerator& generator = this->generator;
+    float centreX = 0.5f * (generator.width - 1);
+    float centreY = 0.5f * (generator.height - 1);
+    float invTexWidth  = 1.0f / (generator.width - 1);
+    float invTexHeight = 1.0f / (generator.height - 1);
+
+    // Unproject the row's vertices
+    for (size_t vertexY = beginRow; vertexY < endRow; vertexY++) {
+        int y = static_cast<int>(vertexY) * generator.step;
+        const USHORT* depthRow = this->depthInMm + y * generator.width;
+        DepthMesh::Vertex* vertexRow = &this->mesh->vertices[vertexY * generator.numVerticesX];
+
+        float rayY = (centreY - y) * generator.invFocalLength;
+        for (int vertexX = 0; vertexX < generator.numVerticesX; vertexX++) {
+            int x = vertexX * generator.step;
+            float depth = depthRow[x];
+            DepthMesh::Vertex& vertex = vertexRow[vertexX];
+            vertex.x = (x - centreX) * generator.invFocalLength * depth;
+            vertex.y = rayY * depth;
+            vertex.z = depth;
+            vertex.u = x * invTexWidth;
+            vertex.v = y * invTexHeight;
+        }
+    }
+
+    // Flag the triangles of the cells below the rows (the last row has none)
+    int numCellsX = generator.numVerticesX - 1;
+    size_t endCellRow = std::min<size_t>(endRow, generator.numVerticesY - 1);
+    for (size_t cellY = beginRow; cellY < endCellRow; cellY++) {
+        const USHORT* upperDepthRow = this->depthInMm + cellY * generator.step * generator.width;
+        const USHORT* lowerDepthRow = this->depthInMm + std::min<int>((cellY + 1) * generator.step, generator.height - 1) * generator.width;
+        BYTE* rowCells = &generator.cellTriangles[cellY * numCellsX];
+
+        for (int cellX = 0; cellX < numCellsX; cellX++) {
+            int leftX  = cellX * generator.step;
+            int rightX = std::min<int>(leftX + generator.step, generator.width - 1);
+            float upperLeft  = upperDepthRow[leftX];
+            float upperRight = upperDepthRow[rightX];
+            float lowerLeft  = lowerDepthRow[leftX];
+            float lowerRight = lowerDepthRow[rightX];
+
+            // Both triangles share the cell's upper right and lower left corners
+            BYTE triangles = 0;
+            if (upperRight != 0.0f && lowerLeft != 0.0f) {
+                if (upperLeft != 0.0f && !generator.IsDiscontinuous(upperLeft, upperRight, lowerLeft)) {
+                    triangles |= UPPER_TRIANGLE;
+                }
+                if (lowerRight != 0.0f && !generator.IsDiscontinuous(upperRight, lowerRight, lowerLeft)) {
+                    triangles |= LOWER_TRIANGLE;
+                }
+            }
+            rowCells[cellX] = triangles;
+        }
+    }
+}
+
+void DepthMeshGenerator::WriteIndicesTask::Run(size_t beginRow, size_t endRow) {
+    DepthMeshGenerator& generator = this->generator;
+    int numCellsX = generator.numVerticesX - 1;
+
+    for (size_t cellY = beginRow; cellY < endRow; cellY++) {
+        const BYTE* rowCells = &generator.cellTriangles[cellY * numCellsX];
+        GLuint* indices = &this->mesh->indices[generator.rowFirstIndices[cellY]];
+        GLuint upperLeftIdx = static_cast<GLuint>(cellY * generator.numVerticesX);
+
+        for (int cellX = 0; cellX < numCellsX; cellX++, upperLeftIdx++) {
+            BYTE triangles = rowCells[cellX];
+            if (triangles == 0) {
+                continue;
+            }
+            GLuint upperRightIdx = upperLeftIdx + 1;
+            GLuint lowerLeftIdx  = upperLeftIdx + generator.numVerticesX;
+            GLuint lowerRightIdx = lowerLeftIdx + 1;
+
+            // Both triangles wind the same way around
+            if ((triangles & UPPER_TRIANGLE) != 0) {
+                indices[0] = upperLeftIdx;
+                indices[1] = upperRightIdx;
+                indices[2] = lowerLeftIdx;
+                indices += 3;
+            }
+            if ((triangles & LOWER_TRIANGLE) != 0) {
+                indices[0] = upperRightIdx;
+                indices[1] = lowerRightIdx;
+                indices[2] = lowerLeftIdx;
+                indices += 3;
+            }
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef AUG3DENGINE_DEPTHMESHGENERATOR_H_
+#define AUG3DENGINE_DEPTHMESHGENERATOR_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+
+/// <summary>
+/// Indexed triangle mesh of the surface seen in a depth image (see DepthMeshGenerator). The
+/// buffers are sized for the most triangles the image can have when the mesh is first generated
+/// and are reused from then on, only the first GetNumIndices() indices are valid. The vertices and
+/// indices are laid out so they can be copied into vertex/index buffer objects as they are.
+/// </summary>
+class DepthMesh {
+public:
+    struct Vertex {
+        float x, y, z;  // Position in the sensor's space in mm (x right, y up, z away from the sensor)
+        float u, v;     // Texture coordinate of the vertex's depth pixel
+    };
+
+    DepthMesh() : numIndices(0) {}
+    void Clear();
+
+    const std::vector<Vertex>& GetVertices() const;
+    const GLuint* GetIndices() const;
+    size_t GetNumIndices() const;
+    size_t GetNumTriangles() const;
+
+private:
+    friend class DepthMeshGenerator;
+
+    std::vector<Vertex> vertices;   // One per sampled depth pixel, row by row (holes are at the origin)
+    std::vector<GLuint> indices;    // Three per triangle
+    size_t numIndices;
+};
+
+/// <summary>
+/// Turns depth images (16-bit, in mm) into indexed triangle meshes on the CPU, for consumers that
+/// need the surface itself rather than a displaced grid on the GPU:
+///  - Every step-th pixel of every step-th row is unprojected into a vertex (with the given focal
+///    length, from the centre of the image).
+///  - Each cell of four neighbouring vertices is split into two triangles, triangles touching a
+///    hole or spanning a jump in depth (a discontinuity between separate surfaces) are dropped
+///    instead of being stretched across the gap.
+/// The rows are split across a thread pool in two passes: the first unprojects the vertices and
+/// flags the kept triangles of each row, the second writes each row's triangles straight into the
+/// mesh's index buffer (after the rows before it), so nothing is allocated per frame.
+/// </summary>
+class DepthMeshGenerator {
+public:
+    static const float DEFAULT_MIN_DISCONTINUITY_IN_MM;
+    static const float DEFAULT_DISCONTINUITY_FRACTION;
+
+    DepthMeshGenerator(int width, int height, float focalLengthInPixels, ThreadPool* threadPool, int step = 1);
+    ~DepthMeshGenerator();
+
+    void SetDiscontinuityDistance(float minDiscontinuityInMm, float discontinuityFraction);
+
+    int GetNumVerticesX() const;
+    int GetNumVerticesY() const;
+
+    void Generate(const USHORT* depthInMm, DepthMesh& mesh);
+
+private:
+    // Cell flags for which of its triangles are kept
+    enum { UPPER_TRIANGLE = 0x1, LOWER_TRIANGLE = 0x2 };
+
+    // Unprojects the vertices of a range of rows and flags the triangles of their cells
+    class BuildRowsTask : public ParallelTask {
+    public:
+        BuildRowsTask(DepthMeshGenerator& generator) : generator(generator), depthInMm(NULL), mesh(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthMeshGenerator& generator;
+        const USHORT* depthInMm;
+        DepthMesh* mesh;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(BuildRowsTask);
+    };
+
+    // Writes the kept triangles of a range of rows of cells into the index buffer
+    class WriteIndicesTask : public ParallelTask {
+    public:
+        WriteIndicesTask(DepthMeshGenerator& generator) : generator(generator), mesh(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthMeshGenerator& generator;
+        DepthMesh* mesh;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(WriteIndicesTask);
+    };
+
+    int width, height;
+    int step;
+    int numVerticesX, numVerticesY;
+    float invFocalLength;
+    ThreadPool* threadPool; // Not owned by this
+
+    float minDiscontinuityInMm;     // Smallest jump in depth across a triangle that is a discontinuity
+    float discontinuityFraction;    // Jump in depth (as a fraction of the depth) across a triangle that is a discontinuity
+
+    std::vector<BYTE> cellTriangles;        // Per cell flags of the kept triangles
+    std::vector<size_t> rowFirstIndices;    // Per row of cells index (in the index buffer) of its first triangle
+
+    BuildRowsTask buildRowsTask;
+    WriteIndicesTask writeIndicesTask;
+
+    bool IsDiscontinuous(float depth0, float depth1, float depth2) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthMeshGenerator);
+};
+
+/// <summary> Drop every triangle, the buffers are kept for the next mesh. </summary>
+inline void DepthMesh::Clear() {
+    this->numIndices = 0;
+}
+
+inline const std::vector<DepthMesh::Vertex>& DepthMesh::GetVertices() const {
+    return this->vertices;
+}
+
+inline const GLuint* DepthMesh::GetIndices() const {
+    return this->indices.empty() ? NULL : &this->indices[0];
+}
+
+inline size_t DepthMesh::GetNumIndices() const {
+    return this->numIndices;
+}
+
+inline size_t DepthMesh::GetNumTriangles() const {
+    return this->numIndices / 3;
+}
+
+inline void DepthMeshGenerator::SetDiscontinuityDistance(float minDiscontinuityInMm, float discontinuityFraction) {
+    assert(minDiscontinuityInMm >= 0.0f && discontinuityFraction >= 0.0f);
+    this->minDiscontinuityInMm  = minDiscontinuityInMm;
+    this->discontinuityFraction = discontinuityFraction;
+}
+
+inline int DepthMeshGenerator::GetNumVerticesX() const {
+    return this->numVerticesX;
+}
+
+inline int DepthMeshGenerator::GetNumVerticesY() const {
+    return this->numVerticesY;
+}
+
+/// <summary> Check whether the given depths of a triangle's corners (none of them holes) span a discontinuity. </summary>
+inline bool DepthMeshGenerator::IsDiscontinuous(float depth0, float depth1, float depth2) const {
+    float minDepth = std::min<float>(depth0, std::min<float>(depth1, depth2));
+    float maxDepth = std::max<float>(depth0, std::max<float>(depth1, depth2));
+    return maxDepth - minDepth > std::max<float>(this->minDiscontinuityInMm, this->discontinuityFraction * minDepth);
+}
+
+#endif // AUG3DENGINE_DEPTHMESHGENERATOR_H_
@@ -0,0 +1,299 @@
+// AugEngine Includes
+#include "depth_normal_estimator.h"
+#include "cpu_features.h"
+
+// Intrinsics Includes
+#include <emmintrin.h>
+
+// Smallest number of rows (or columns) of the integral images and normals handled by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK    = 8;
+static const size_t MIN_COLUMNS_PER_CHUNK = 64;
+
+// Packed normal components are mapped from [-1, 1] to [0, 255] (rounded by truncating from +0.5)
+static const float PACK_SCALE  = 127.5f;
+static const float PACK_OFFSET = 128.0f;
+static const DWORD PACKED_VALID_BITS = 0xFF000000;
+
+static const size_t SSE2_PIXELS_PER_ITERATION = 4;
+
+DepthNormalEstimator::DepthNormalEstimator(int width, int height, float focalLengthInPixels,
+                                           ThreadPool* threadPool, int smoothingRadius) :
+width(width), height(height), integralWidth(width + 1), invFocalLength(1.0f / focalLengthInPixels),
+threadPool(threadPool), smoothingRadius(smoothingRadius),
+depthSums((width + 1) * (height + 1), 0), depthCounts((width + 1) * (height + 1), 0),
+sumRowsTask(*this), sumColumnsTask(*this), estimateRowsTask(*this) {
+    assert(width > 0 && height > 0);
+    assert(focalLengthInPixels > 0.0f);
+    assert(threadPool != NULL);
+    this->SetSmoothingRadius(smoothingRadius);
+}
+
+DepthNormalEstimator::~DepthNormalEstimator() {
+}
+
+/// <summary> Replace the given normals with the normals of the given depth image (which must be the size of the estimator). </summary>
+void DepthNormalEstimator::Estimate(const USHORT* depthInMm, DepthNormalMap& normals) {
+    assert(depthInMm != NULL);
+
+    // Only the first estimate allocates
+    if (normals.width != this->width || normals.height != this->height) {
+        normals.width  = this->width;
+        normals.height = this->height;
+        normals.packedNormals.resize(this->width * this->height);
+    }
+
+    // The integral images are summed along the rows and then down the columns (their first row
+    // and column stay zero)
+    this->sumRowsTask.depthInMm = depthInMm;
+    this->threadPool->ParallelFor(this->sumRowsTask, this->height, MIN_ROWS_PER_CHUNK);
+    this->threadPool->ParallelFor(this->sumColumnsTask, this->integralWidth, MIN_COLUMNS_PER_CHUNK);
+
+    this->estimateRowsTask.depthInMm = depthInMm;
+    this->estimateRowsTask.normals   = &normals;
+    this->estimateRowsTask.useSSE2   = (augengine::cpufeatures::GetInstructionSet() != augengine::cpufeatures::Scalar);
+    this->threadPool->ParallelFor(this->estimateRowsTask, this->height, MIN_ROWS_PER_CHUNK);
+}
+
+/// <summary>
+/// Mark every normal of the given map as missing (as for holes), sized like the estimated maps, for
+/// depth images whose normals aren't estimated.
+/// </summary>
+void DepthNormalEstimator::Clear(DepthNormalMap& normals) const {
+    normals.width  = this->width;
+    normals.height = this->height;
+    normals.packedNormals.assign(this->width * this->height, 0);
+}
+
+void DepthNormalEstimator::SumRowsTask::Run(size_t beginRow, size_t endRow) {
+    DepthNormalEstimator& estimator = this->estimator;
+    for (size_t y = beginRow; y < endRow; y++) {
+        const USHORT* depthRow = this->depthInMm + y * estimator.width;
+        unsigned int* sumRow   = &estimator.depthSums[(y + 1) * estimator.integralWidth + 1];
+        unsigned int* countRow = &estimator.depthCounts[(y + 1) * estimator.integralWidth + 1];
+
+        unsigned int sum = 0;
+        unsigned int count = 0;
+        for (int x = 0; x < estimator.width; x++) {
+            sum   += depthRow[x];
+            count += (depthRow[x] != 0) ? 1 : 0;
+            sumRow[x]   = sum;
+            countRow[x] = count;
+        }
+    }
+}
+
+void DepthNormalEstimator::SumColumnsTask::Run(size_t beginColumn, size_t endColumn) {
+    DepthNormalEstimator& estimator = this->estimator;
+    for (int y = 1; y < estimator.height; y++) {
+        const unsigned int* prevSumRow   = &estimator.depthSums[y * estimator.integralWidth];
+        const unsigned int* prevCountRow = &estimator.depthCounts[y * estimator.integralWidth];
+        unsigned int* sumRow   = &estimator.depthSums[(y + 1) * estimator.integralWidth];
+        unsigned int* countRow = &estimator.depthCounts[(y + 1) * estimator.integralWidth];
+        for (size_t x = beginColumn; x < endColumn; x++) {
+            sumRow[x]   += prevSumRow[x];
+            countRow[x] += prevCountRow[x];
+        }
+    }
+}
+
+void DepthNormalEstimator::EstimateRowsTask::Run(size_t beginRow, size_t endRow) {
+    DepthNormalEstimator& estimator = this->estimator;
+    int radius = estimator.smoothingRadius;
+    DWORD* packedNormals = &this->normals->packedNormals[0];
+
+    for (int y = static_cast<int>(beginRow); y < static_cast<int>(endRow); y++) {
+        DWORD* normalRow = packedNormals + y * estimator.width;
+
+        // Pixels whose windows are cut short by the edges of the image are done one at a time
+        int beginX = 0;
+        if (this->useSSE2 && y >= radius && y < estimator.height - radius) {
+            int numInnerPixels = std::max<int>(estimator.width - 2 * radius, 0);
+            int endInnerX = radius + numInnerPixels - numInnerPixels % SSE2_PIXELS_PER_ITERATION;
+            for (int x = 0; x < radius; x++) {
+                normalRow[x] = estimator.EstimatePixel(this->depthInMm, x, y);
+            }
+            this->EstimateRowSSE2(y, radius, endInnerX);
+            beginX = endInnerX;
+        }
+        for (int x = beginX; x < estimator.width; x++) {
+            normalRow[x] = estimator.EstimatePixel(this->depthInMm, x, y);
+        }
+    }
+}
+
+/// <summary>
+/// Estimate the normal of the given pixel. The gradient along each axis is the difference between
+/// the mean depths on either side of the pixel over the distance between them. A side without any
+/// depths (past the edge of the image or all holes) is replaced by the pixel's own row (or column)
+/// of the window, which covers the same span across the axis.
+/// </summary>
+DWORD DepthNormalEstimator::EstimatePixel(const USHORT* depthInMm, int x, int y) const {
+    float depth = depthInMm[y * this->width + x];
+    if (depth == 0.0f) {
+        return 0;
+    }
+
+    int radius = this->smoothingRadius;
+    int beginX = std::max<int>(x - radius, 0);
+    int beginY = std::max<int>(y - radius, 0);
+    int endX   = std::min<int>(x + radius + 1, this->width);
+    int endY   = std::min<int>(y + radius + 1, this->height);
+
+    // Left, right, upper and lower windows, then the pixel's column and row of the window
+    int windows[6][4] = {
+        { beginX, beginY, x,      endY  },
+        { x + 1,  beginY, endX,   endY  },
+        { beginX, beginY, endX,   y     },
+        { beginX, y + 1,  endX,   endY  },
+        { x,      beginY, x + 1,  endY  },
+        { beginX, y,      endX,   y + 1 }
+    };
+    float means[6];
+    bool hasDepths[6];
+    for (int i = 0; i < 6; i++) {
+        unsigned int count = this->GetWindowSum(this->depthCounts, windows[i][0], windows[i][1], windows[i][2], windows[i][3]);
+        unsigned int sum   = this->GetWindowSum(this->depthSums,   windows[i][0], windows[i][1], windows[i][2], windows[i][3]);
+        hasDepths[i] = (count != 0);
+        means[i] = hasDepths[i] ? static_cast<float>(sum) / static_cast<float>(count) : 0.0f;
+    }
+
+    // Distance from the pixel to the middle of each window
+    float leftDistance  = hasDepths[0] ? x - 0.5f * (beginX + x - 1) : 0.0f;
+    float rightDistance = hasDepths[1] ? 0.5f * (x + endX) - x       : 0.0f;
+    float upperDistance = hasDepths[2] ? y - 0.5f * (beginY + y - 1) : 0.0f;
+    float lowerDistance = hasDepths[3] ? 0.5f * (y + endY) - y       : 0.0f;
+    float distanceX = leftDistance + rightDistance;
+    float distanceY = upperDistance + lowerDistance;
+    if (distanceX == 0.0f || distanceY == 0.0f) {
+        return 0;
+    }
+    float gradientX = ((hasDepths[1] ? means[1] : means[4]) - (hasDepths[0] ? means[0] : means[4])) / distanceX;
+    float gradientY = ((hasDepths[3] ? means[3] : means[5]) - (hasDepths[2] ? means[2] : means[5])) / distanceY;
+
+    // The tangents along the row and column of the unprojected pixel, (x, y, depth) * invFocalLength
+    // away from the centre, are (rayX * gradientX + depthScale, rayY * gradientX, gradientX) and
+    // (rayX * gradientY, rayY * gradientY - depthScale, gradientY) (y is up in the sensor's space,
+    // but down the image). Their cross product, divided by depthScale (normalizing drops it), is:
+    float rayX = (x - 0.5f * (this->width - 1)) * this->invFocalLength;
+    float rayY = (0.5f * (this->height - 1) - y) * this->invFocalLength;
+    float depthScale = depth * this->invFocalLength;
+    float normalX = gradientX;
+    float normalY = -gradientY;
+    float normalZ = rayY * gradientY - rayX * gradientX - depthScale;
+
+    float invLength = 1.0f / sqrt(normalX * normalX + normalY * normalY + normalZ * normalZ);
+    DWORD packedX = static_cast<DWORD>(static_cast<int>(normalX * invLength * PACK_SCALE + PACK_OFFSET));
+    DWORD packedY = static_cast<DWORD>(static_cast<int>(normalY * invLength * PACK_SCALE + PACK_OFFSET));
+    DWORD packedZ = static_cast<DWORD>(static_cast<int>(normalZ * invLength * PACK_SCALE + PACK_OFFSET));
+    return packedX | (packedY << 8) | (packedZ << 16) | PACKED_VALID_BITS;
+}
+
+/// <summary> Load four consecutive values of an integral image. </summary>
+static inline __m128i LoadSums(const unsigned int* sums) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums));
+}
+
+/// <summary> Get four consecutive window sums from the corners of the windows in an integral image. </summary>
+static inline __m128 GetWindowSumsSSE2(const unsigned int* beginRow, const unsigned int* endRow, int beginX, int endX) {
+    __m128i sums = _mm_sub_epi32(LoadSums(endRow + endX), LoadSums(beginRow + endX));
+    sums = _mm_add_epi32(_mm_sub_epi32(sums, LoadSums(endRow + beginX)), LoadSums(beginRow + beginX));
+    return _mm_cvtepi32_ps(sums);
+}
+
+/// <summary> Get the mean depths of four windows, zero where a window has no depths. </summary>
+static inline __m128 GetWindowMeansSSE2(__m128 sums, __m128 counts, __m128& hasDepths) {
+    hasDepths = _mm_cmpgt_ps(counts, _mm_setzero_ps());
+    return _mm_and_ps(hasDepths, _mm_div_ps(sums, _mm_max_ps(counts, _mm_set1_ps(1.0f))));
+}
+
+/// <summary> Pick the means of four windows, or the given means where a window has no depths (see EstimatePixel). </summary>
+static inline __m128 SelectMeansSSE2(__m128 means, __m128 hasDepths, __m128 otherMeans) {
+    return _mm_or_ps(_mm_and_ps(hasDepths, means), _mm_andnot_ps(hasDepths, otherMeans));
+}
+
+/// <summary>
+/// SSE2 version of EstimatePixel for pixels from beginX up to endX (a multiple of four pixels) of
+/// the given row, whose windows all lie inside the image.
+/// </summary>
+void DepthNormalEstimator::EstimateRowsTask::EstimateRowSSE2(int y, int beginX, int endX) {
+    const DepthNormalEstimator& estimator = this->estimator;
+    int radius = estimator.smoothingRadius;
+    const unsigned int* sumRows[4] = {
+        &estimator.depthSums[(y - radius) * estimator.integralWidth],
+        &estimator.depthSums[y * estimator.integralWidth],
+        &estimator.depthSums[(y + 1) * estimator.integralWidth],
+        &estimator.depthSums[(y + radius + 1) * estimator.integralWidth]
+    };
+    const unsigned int* countRows[4] = {
+        &estimator.depthCounts[(y - radius) * estimator.integralWidth],
+        &estimator.depthCounts[y * estimator.integralWidth],
+        &estimator.depthCounts[(y + 1) * estimator.integralWidth],
+        &estimator.depthCounts[(y + radius + 1) * estimator.integralWidth]
+    };
+    const USHORT* depthRow = this->depthInMm + y * estimator.width;
+    DWORD* normalRow = &this->normals->packedNormals[y * estimator.width];
+
+    const __m128i zero       = _mm_setzero_si128();
+    const __m128 one         = _mm_set1_ps(1.0f);
+    const __m128 distance    = _mm_set1_ps(0.5f * (radius + 1));
+    const __m128 invFocal    = _mm_set1_ps(estimator.invFocalLength);
+    const __m128 centreX     = _mm_set1_ps(0.5f * (estimator.width - 1));
+    const __m128 rayY        = _mm_set1_ps((0.5f * (estimator.height - 1) - y) * estimator.invFocalLength);
+    const __m128 packScale   = _mm_set1_ps(PACK_SCALE);
+    const __m128 packOffset  = _mm_set1_ps(PACK_OFFSET);
+    const __m128i validBits  = _mm_set1_epi32(static_cast<int>(PACKED_VALID_BITS));
+    const __m128 pixelOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (int x = beginX; x < endX; x += SSE2_PIXELS_PER_ITERATION) {
+        __m128 depths = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(depthRow + x)), zero));
+
+        // Left, right, upper and lower windows, then the pixels' columns and rows of the windows (see EstimatePixel)
+        __m128 hasLeft, hasRight, hasUpper, hasLower, hasColumn, hasRow;
+        __m128 leftMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[0], sumRows[3], x - radius, x),
+            GetWindowSumsSSE2(countRows[0], countRows[3], x - radius, x), hasLeft);
+        __m128 rightMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[0], sumRows[3], x + 1, x + radius + 1),
+            GetWindowSumsSSE2(countRows[0], countRows[3], x + 1, x + radius + 1), hasRight);
+        __m128 upperMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[0], sumRows[1], x - radius, x + radius + 1),
+            GetWindowSumsSSE2(countRows[0], countRows[1], x - radius, x + radius + 1), hasUpper);
+        __m128 lowerMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[2], sumRows[3], x - radius, x + radius + 1),
+            GetWindowSumsSSE2(countRows[2], countRows[3], x - radius, x + radius + 1), hasLower);
+        __m128 columnMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[0], sumRows[3], x, x + 1),
+            GetWindowSumsSSE2(countRows[0], countRows[3], x, x + 1), hasColumn);
+        __m128 rowMeans = GetWindowMeansSSE2(GetWindowSumsSSE2(sumRows[1], sumRows[2], x - radius, x + radius + 1),
+            GetWindowSumsSSE2(countRows[1], countRows[2], x - radius, x + radius + 1), hasRow);
+
+        __m128 distanceX = _mm_add_ps(_mm_and_ps(hasLeft, distance), _mm_and_ps(hasRight, distance));
+        __m128 distanceY = _mm_add_ps(_mm_and_ps(hasUpper, distance), _mm_and_ps(hasLower, distance));
+        leftMeans  = SelectMeansSSE2(leftMeans,  hasLeft,  columnMeans);
+        rightMeans = SelectMeansSSE2(rightMeans, hasRight, columnMeans);
+        upperMeans = SelectMeansSSE2(upperMeans, hasUpper, rowMeans);
+        lowerMeans = SelectMeansSSE2(lowerMeans, hasLower, rowMeans);
+
+        // Holes and pixels without depths on either side along an axis have no normal, the
+        // divisions by zero this gives are masked out
+        __m128 isValid = _mm_and_ps(_mm_cmpgt_ps(depths, _mm_setzero_ps()),
+            _mm_and_ps(_mm_cmpgt_ps(distanceX, _mm_setzero_ps()), _mm_cmpgt_ps(distanceY, _mm_setzero_ps())));
+        __m128 gradientX = _mm_div_ps(_mm_sub_ps(rightMeans, leftMeans), distanceX);
+        __m128 gradientY = _mm_div_ps(_mm_sub_ps(lowerMeans, upperMeans), distanceY);
+
+        // Cross product of the tangents (see EstimatePixel)
+        __m128 rayX = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets), centreX), invFocal);
+        __m128 depthScale = _mm_mul_ps(depths, invFocal);
+        __m128 normalX = gradientX;
+        __m128 normalY = _mm_sub_ps(_mm_setzero_ps(), gradientY);
+        __m128 normalZ = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(rayY, gradientY), _mm_mul_ps(rayX, gradientX)), depthScale);
+
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, normalX), _mm_mul_ps(normalY, normalY)),
+                                          _mm_mul_ps(normalZ, normalZ));
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+        __m128i packedX = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(normalX, invLength), packScale), packOffset));
+        __m128i packedY = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(normalY, invLength), packScale), packOffset));
+        __m128i packedZ = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(normalZ, invLength), packScale), packOffset));
+
+        __m128i packed = _mm_or_si128(_mm_or_si128(packedX, _mm_slli_epi32(packedY, 8)),
+                                      _mm_or_si128(_mm_slli_epi32(packedZ, 16), validBits));
+        packed = _mm_and_si128(packed, _mm_castps_si128(isValid));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(normalRow + x), packed);
+    }
+}
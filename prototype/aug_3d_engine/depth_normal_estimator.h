@@ -0,0 +1,178 @@
+#ifndef AUG3DENGINE_DEPTHNORMALESTIMATOR_H_
+#define AUG3DENGINE_DEPTHNORMALESTIMATOR_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+
+/// <summary>
+/// Surface normal of every pixel of a depth image (see DepthNormalEstimator), in the sensor's
+/// space (x right, y up, z away from the sensor) and facing the sensor. Each normal is packed into
+/// 32 bits, bytes x, y, z, valid from lowest to highest, with each component mapped from [-1, 1]
+/// to [0, 255], so the buffer can be uploaded as it is to a GL_RGBA8 texture (holes, and pixels
+/// without enough depths around them, are all zero). The normals are copied along with the frame
+/// they were estimated from.
+/// </summary>
+class DepthNormalMap {
+public:
+    DepthNormalMap() : width(0), height(0) {}
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+    const DWORD* GetPackedNormals() const;
+    DWORD GetPackedNormal(int x, int y) const;
+    bool GetNormal(int x, int y, Eigen::Vector3f& normal) const;
+
+    static bool UnpackNormal(DWORD packedNormal, Eigen::Vector3f& normal);
+
+private:
+    friend class DepthNormalEstimator;
+
+    int width, height;
+    std::vector<DWORD> packedNormals;   // Row by row
+};
+
+/// <summary>
+/// Estimates the surface normals of depth images (16-bit, in mm) on the CPU, once per image, so
+/// neither the shaders nor CPU-side consumers have to difference neighbouring depths themselves:
+///  - Integral images of the depths and of the number of non-hole pixels give the mean depth of
+///    any window in four lookups, whatever its size.
+///  - The depth gradient of a pixel is the difference between the mean depths of the windows on
+///    either side of it (radius pixels wide, 2 * radius + 1 pixels long), holes are left out of the
+///    means, so the normals are smoothed over the window without a separate blur.
+///  - The normal is the cross product of the surface's tangents along the rows and columns, from
+///    the gradients unprojected with the given focal length (from the centre of the image).
+/// The rows are split across a thread pool, and the gradients, cross products and normalization
+/// of four pixels are done at once with SSE2 (unless cpufeatures picked the scalar kernels).
+/// </summary>
+class DepthNormalEstimator {
+public:
+    static const int DEFAULT_SMOOTHING_RADIUS = 4;
+
+    DepthNormalEstimator(int width, int height, float focalLengthInPixels, ThreadPool* threadPool,
+                         int smoothingRadius = DEFAULT_SMOOTHING_RADIUS);
+    ~DepthNormalEstimator();
+
+    void SetSmoothingRadius(int smoothingRadius);
+    int GetSmoothingRadius() const;
+
+    void Estimate(const USHORT* depthInMm, DepthNormalMap& normals);
+    void Clear(DepthNormalMap& normals) const;
+
+private:
+    // Sums a range of rows of the depth image into the rows of the integral images
+    class SumRowsTask : public ParallelTask {
+    public:
+        SumRowsTask(DepthNormalEstimator& estimator) : estimator(estimator), depthInMm(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthNormalEstimator& estimator;
+        const USHORT* depthInMm;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(SumRowsTask);
+    };
+
+    // Sums a range of columns of the integral images down their rows
+    class SumColumnsTask : public ParallelTask {
+    public:
+        SumColumnsTask(DepthNormalEstimator& estimator) : estimator(estimator) {}
+        void Run(size_t beginColumn, size_t endColumn);
+
+        DepthNormalEstimator& estimator;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(SumColumnsTask);
+    };
+
+    // Estimates the normals of a range of rows
+    class EstimateRowsTask : public ParallelTask {
+    public:
+        EstimateRowsTask(DepthNormalEstimator& estimator) : estimator(estimator), depthInMm(NULL),
+            normals(NULL), useSSE2(false) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthNormalEstimator& estimator;
+        const USHORT* depthInMm;
+        DepthNormalMap* normals;
+        bool useSSE2;
+
+    private:
+        void EstimateRowSSE2(int y, int beginX, int endX);
+
+        DISALLOW_COPY_AND_ASSIGN(EstimateRowsTask);
+    };
+
+    int width, height;
+    int integralWidth;      // Width of the integral images, which have an extra zero row and column
+    float invFocalLength;
+    ThreadPool* threadPool; // Not owned by this
+    int smoothingRadius;
+
+    // Integral images (the sums of everything above and to the left of each pixel), they are
+    // allowed to wrap around since the sum of any window still comes out right
+    std::vector<unsigned int> depthSums;
+    std::vector<unsigned int> depthCounts;
+
+    SumRowsTask sumRowsTask;
+    SumColumnsTask sumColumnsTask;
+    EstimateRowsTask estimateRowsTask;
+
+    unsigned int GetWindowSum(const std::vector<unsigned int>& integral, int beginX, int beginY, int endX, int endY) const;
+    DWORD EstimatePixel(const USHORT* depthInMm, int x, int y) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthNormalEstimator);
+};
+
+inline int DepthNormalMap::GetWidth() const {
+    return this->width;
+}
+
+inline int DepthNormalMap::GetHeight() const {
+    return this->height;
+}
+
+inline const DWORD* DepthNormalMap::GetPackedNormals() const {
+    return this->packedNormals.empty() ? NULL : &this->packedNormals[0];
+}
+
+inline DWORD DepthNormalMap::GetPackedNormal(int x, int y) const {
+    assert(x >= 0 && x < this->width && y >= 0 && y < this->height);
+    return this->packedNormals[y * this->width + x];
+}
+
+/// <summary> Get the normal of the given pixel. </summary>
+/// <returns> true if the pixel has a normal, false (and the normal is untouched) otherwise. </returns>
+inline bool DepthNormalMap::GetNormal(int x, int y, Eigen::Vector3f& normal) const {
+    return DepthNormalMap::UnpackNormal(this->GetPackedNormal(x, y), normal);
+}
+
+/// <summary> Unpack the given normal (the packed normal is only approximately unit length). </summary>
+/// <returns> true if the normal is valid, false (and the normal is untouched) otherwise. </returns>
+inline bool DepthNormalMap::UnpackNormal(DWORD packedNormal, Eigen::Vector3f& normal) {
+    if ((packedNormal >> 24) == 0) {
+        return false;
+    }
+    normal = Eigen::Vector3f(static_cast<float>(packedNormal & 0xFF), static_cast<float>((packedNormal >> 8) & 0xFF),
+                             static_cast<float>((packedNormal >> 16) & 0xFF)) / 127.5f - Eigen::Vector3f::Ones();
+    return true;
+}
+
+inline void DepthNormalEstimator::SetSmoothingRadius(int smoothingRadius) {
+    assert(smoothingRadius > 0 && 2 * smoothingRadius < std::min<int>(this->width, this->height));
+    this->smoothingRadius = smoothingRadius;
+}
+
+inline int DepthNormalEstimator::GetSmoothingRadius() const {
+    return this->smoothingRadius;
+}
+
+/// <summary> Get the sum over the given window (from begin up to, but not including, end) of the given integral image. </summary>
+inline unsigned int DepthNormalEstimator::GetWindowSum(const std::vector<unsigned int>& integral,
+                                                       int beginX, int beginY, int endX, int endY) const {
+    return integral[endY * this->integralWidth + endX] - integral[beginY * this->integralWidth + endX] -
+           integral[endY * this->integralWidth + beginX] + integral[beginY * this->integralWidth + beginX];
+}
+
+#endif // AUG3DENGINE_DEPTHNORMALESTIMATOR_H_
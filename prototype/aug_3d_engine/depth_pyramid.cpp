@@ -0,0 +1,106 @@
+// AugEngine Includes
+#include "depth_pyramid.h"
+
+DepthPyramid::DepthPyramid() {
+}
+
+DepthPyramid::~DepthPyramid() {
+}
+
+/// <summary> Allocate all the levels of the pyramid for a depth image of the given size. </summary>
+void DepthPyramid::Resize(int width, int height) {
+    assert(width > 0 && height > 0);
+    this->levels.clear();
+
+    for (;;) {
+        this->levels.push_back(Level());
+        Level& level = this->levels.back();
+        level.width  = width;
+        level.height = height;
+        level.meanDepths.resize(width * height, 0);
+        if (this->levels.size() > 1) {
+            level.minDepths.resize(width * height, 0);
+            level.maxDepths.resize(width * height, 0);
+            level.counts.resize(width * height, 0);
+        }
+
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width  = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+/// <summary> Build every level of the pyramid from the given depth image (which must be the size of level 0). </summary>
+void DepthPyramid::Build(const USHORT* depthInMm) {
+    assert(depthInMm != NULL);
+    assert(!this->levels.empty());
+
+    Level& baseLevel = this->levels[0];
+    for (int y = 0; y < baseLevel.height; y++) {
+        memcpy(&baseLevel.meanDepths[y * baseLevel.width], &depthInMm[y * baseLevel.width],
+               baseLevel.width * sizeof(USHORT));
+
+        // Every second row of a level (or its last row) completes a row of the next level
+        int row = y;
+        for (int level = 1; level < this->GetNumLevels(); level++) {
+            if ((row & 1) == 0 && row != this->levels[level - 1].height - 1) {
+                break;
+            }
+            row /= 2;
+            this->ReduceRow(level, row);
+        }
+    }
+}
+
+/// <summary> Reduce the (up to) two rows of the previous level covered by the given row of the given level. </summary>
+void DepthPyramid::ReduceRow(int level, int y) {
+    assert(level > 0);
+    const Level& srcLevel = this->levels[level - 1];
+    Level& dstLevel = this->levels[level];
+
+    bool isSrcBase = (level == 1);
+    const USHORT* srcMinDepths  = this->GetMinDepths(level - 1);
+    const USHORT* srcMaxDepths  = this->GetMaxDepths(level - 1);
+    const USHORT* srcMeanDepths = this->GetMeanDepths(level - 1);
+
+    int srcBeginY = 2 * y;
+    int srcEndY   = std::min<int>(srcBeginY + 2, srcLevel.height);
+
+    for (int x = 0; x < dstLevel.width; x++) {
+        int srcBeginX = 2 * x;
+        int srcEndX   = std::min<int>(srcBeginX + 2, srcLevel.width);
+
+        USHORT minDepth = USHRT_MAX;
+        USHORT maxDepth = 0;
+        unsigned int depthSum = 0;
+        unsigned int count = 0;
+        for (int srcY = srcBeginY; srcY < srcEndY; srcY++) {
+            for (int srcX = srcBeginX; srcX < srcEndX; srcX++) {
+                int srcIdx = srcY * srcLevel.width + srcX;
+                unsigned int srcCount = isSrcBase ? (srcMeanDepths[srcIdx] != 0 ? 1 : 0) : srcLevel.counts[srcIdx];
+                if (srcCount == 0) {
+                    continue;
+                }
+                minDepth  = std::min<USHORT>(minDepth, srcMinDepths[srcIdx]);
+                maxDepth  = std::max<USHORT>(maxDepth, srcMaxDepths[srcIdx]);
+                depthSum += srcMeanDepths[srcIdx] * srcCount;
+                count    += srcCount;
+            }
+        }
+
+        int dstIdx = y * dstLevel.width + x;
+        dstLevel.counts[dstIdx] = count;
+        if (count == 0) {
+            dstLevel.minDepths[dstIdx]  = 0;
+            dstLevel.maxDepths[dstIdx]  = 0;
+            dstLevel.meanDepths[dstIdx] = 0;
+        }
+        else {
+            dstLevel.minDepths[dstIdx]  = minDepth;
+            dstLevel.maxDepths[dstIdx]  = maxDepth;
+            dstLevel.meanDepths[dstIdx] = static_cast<USHORT>((depthSum + count / 2) / count);
+        }
+    }
+}
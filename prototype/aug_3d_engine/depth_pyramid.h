@@ -0,0 +1,100 @@
+#ifndef AUG3DENGINE_DEPTHPYRAMID_H_
+#define AUG3DENGINE_DEPTHPYRAMID_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Multi-resolution view of a kinect depth image (16-bit, in mm). Level 0 is the depth image
+/// itself and every following level is half the size (rounded up) of the one before it, down to
+/// a single pixel. Every pixel of a coarser level holds the minimum, maximum and mean depth of the
+/// pixels it covers, ignoring holes (zero depth), or zero if they are all holes.
+///
+/// The levels are built in a single pass over the depth image: as soon as two rows of a level
+/// are done they are reduced into a row of the next level, so the rows being reduced are still
+/// in the cache. The pyramid is copied along with the frame it was built from.
+/// </summary>
+class DepthPyramid {
+public:
+    DepthPyramid();
+    ~DepthPyramid();
+
+    void Resize(int width, int height);
+    void Build(const USHORT* depthInMm);
+
+    int GetNumLevels() const;
+    int GetWidth(int level) const;
+    int GetHeight(int level) const;
+
+    const USHORT* GetMinDepths(int level) const;
+    const USHORT* GetMaxDepths(int level) const;
+    const USHORT* GetMeanDepths(int level) const;
+
+    USHORT GetMinDepth(int level, int x, int y) const;
+    USHORT GetMaxDepth(int level, int x, int y) const;
+    USHORT GetMeanDepth(int level, int x, int y) const;
+    unsigned int GetNumDepths(int level, int x, int y) const;
+
+private:
+    struct Level {
+        int width, height;
+        std::vector<USHORT> minDepths;      // Empty for level 0, which uses its mean depths
+        std::vector<USHORT> maxDepths;      // Empty for level 0, which uses its mean depths
+        std::vector<USHORT> meanDepths;
+        std::vector<unsigned int> counts;   // Number of non-hole level 0 pixels covered (empty for level 0)
+    };
+
+    std::vector<Level> levels;
+
+    void ReduceRow(int level, int y);
+};
+
+inline int DepthPyramid::GetNumLevels() const {
+    return static_cast<int>(this->levels.size());
+}
+
+inline int DepthPyramid::GetWidth(int level) const {
+    return this->levels[level].width;
+}
+
+inline int DepthPyramid::GetHeight(int level) const {
+    return this->levels[level].height;
+}
+
+inline const USHORT* DepthPyramid::GetMinDepths(int level) const {
+    return (level == 0) ? &this->levels[0].meanDepths[0] : &this->levels[level].minDepths[0];
+}
+
+inline const USHORT* DepthPyramid::GetMaxDepths(int level) const {
+    return (level == 0) ? &this->levels[0].meanDepths[0] : &this->levels[level].maxDepths[0];
+}
+
+inline const USHORT* DepthPyramid::GetMeanDepths(int level) const {
+    return &this->levels[level].meanDepths[0];
+}
+
+inline USHORT DepthPyramid::GetMinDepth(int level, int x, int y) const {
+    assert(x >= 0 && x < this->GetWidth(level) && y >= 0 && y < this->GetHeight(level));
+    return this->GetMinDepths(level)[y * this->GetWidth(level) + x];
+}
+
+inline USHORT DepthPyramid::GetMaxDepth(int level, int x, int y) const {
+    assert(x >= 0 && x < this->GetWidth(level) && y >= 0 && y < this->GetHeight(level));
+    return this->GetMaxDepths(level)[y * this->GetWidth(level) + x];
+}
+
+inline USHORT DepthPyramid::GetMeanDepth(int level, int x, int y) const {
+    assert(x >= 0 && x < this->GetWidth(level) && y >= 0 && y < this->GetHeight(level));
+    return this->GetMeanDepths(level)[y * this->GetWidth(level) + x];
+}
+
+/// <summary> Get the number of level 0 pixels covered by the given pixel that aren't holes. </summary>
+inline unsigned int DepthPyramid::GetNumDepths(int level, int x, int y) const {
+    assert(x >= 0 && x < this->GetWidth(level) && y >= 0 && y < this->GetHeight(level));
+    if (level == 0) {
+        return (this->GetMeanDepth(0, x, y) != 0) ? 1 : 0;
+    }
+    return this->levels[level].counts[y * this->GetWidth(level) + x];
+}
+
+#endif // AUG3DENGINE_DEPTHPYRAMID_H_
@@ -0,0 +1,331 @@
+// AugEngine Includes
+#include "depth_quadtree_mesh.h"
+#include "depth_grid_mesh.h"
+#include "depth_pyramid.h"
+#include "dirty_tile_tracker.h"
+
+const float DepthQuadtreeMesh::DEFAULT_MIN_ERROR_IN_MM = 10.0f;
+const float DepthQuadtreeMesh::DEFAULT_ERROR_FRACTION  = 0.01f;
+
+/// <summary> Get the base 2 logarithm of the given power of two. </summary>
+static int Log2(int powerOfTwo) {
+    assert(powerOfTwo > 0 && (powerOfTwo & (powerOfTwo - 1)) == 0);
+    int log = 0;
+    while ((1 << log) < powerOfTwo) {
+        log++;
+    }
+    return log;
+}
+
+DepthQuadtreeMesh::DepthQuadtreeMesh(const DepthGridMesh* grid, int tileSize, int minLeafSize) : grid(grid),
+width(grid->GetWidth()), height(grid->GetHeight()), tileSize(tileSize), minLeafSize(minLeafSize),
+numTilesX((width + tileSize - 1) / tileSize), numTilesY((height + tileSize - 1) / tileSize),
+numCellsX(numTilesX * tileSize / minLeafSize), numCellsY(numTilesY * tileSize / minLeafSize), hasLeaves(false),
+minErrorInMm(DEFAULT_MIN_ERROR_IN_MM), errorFraction(DEFAULT_ERROR_FRACTION),
+leafSizes(numCellsX * numCellsY, static_cast<BYTE>(Log2(minLeafSize))), tileIndices(numTilesX * numTilesY),
+tileFlags(numTilesX * numTilesY, STALE_LEAVES | STALE_TRIANGLES), indexBuffer(0), numRebuiltTiles(0) {
+    assert(grid != NULL);
+    assert(tileSize > 0 && (tileSize & (tileSize - 1)) == 0);
+    assert(minLeafSize > 0 && (minLeafSize & (minLeafSize - 1)) == 0 && minLeafSize <= tileSize);
+
+    glGenBuffers(1, &this->indexBuffer);
+    augengine::debug_opengl_state();
+}
+
+DepthQuadtreeMesh::~DepthQuadtreeMesh() {
+    if (this->indexBuffer != 0) {
+        glDeleteBuffers(1, &this->indexBuffer);
+        this->indexBuffer = 0;
+    }
+}
+
+/// <summary>
+/// Rebuild the leaves of the tiles that changed in the given depth pyramid (the pyramid of the depth
+/// image the grid is displaced by) and upload the new triangles. Every tile is rebuilt if the dirty
+/// tiles are NULL (e.g. frames were skipped) or don't match the mesh's tiles.
+/// </summary>
+void DepthQuadtreeMesh::Update(const DepthPyramid& depthPyramid, const DirtyTiles* dirtyTiles) {
+    assert(depthPyramid.GetWidth(0) == this->width && depthPyramid.GetHeight(0) == this->height);
+
+    bool rebuildAll = !this->hasLeaves || dirtyTiles == NULL || dirtyTiles->GetTileSize() != this->tileSize ||
+        dirtyTiles->GetNumTilesX() != this->numTilesX || dirtyTiles->GetNumTilesY() != this->numTilesY;
+
+    // A tile's leaves look at the depths along the edges of the tiles after it, and its triangles
+    // at the leaves of the tiles around it
+    for (int tileY = 0; tileY < this->numTilesY; tileY++) {
+        for (int tileX = 0; tileX < this->numTilesX; tileX++) {
+            if (!rebuildAll && !dirtyTiles->IsDirty(tileX, tileY)) {
+                continue;
+            }
+            this->MarkTile(tileX,     tileY,     STALE_LEAVES);
+            this->MarkTile(tileX - 1, tileY,     STALE_LEAVES);
+            this->MarkTile(tileX,     tileY - 1, STALE_LEAVES);
+            this->MarkTile(tileX - 1, tileY - 1, STALE_LEAVES);
+        }
+    }
+    for (int tileY = 0; tileY < this->numTilesY; tileY++) {
+        for (int tileX = 0; tileX < this->numTilesX; tileX++) {
+            if ((this->tileFlags[tileY * this->numTilesX + tileX] & STALE_LEAVES) == 0) {
+                continue;
+            }
+            this->BuildLeaves(depthPyramid, tileX * this->tileSize, tileY * this->tileSize, this->tileSize);
+            this->tileFlags[tileY * this->numTilesX + tileX] &= ~STALE_LEAVES;
+            this->MarkTile(tileX,     tileY,     STALE_TRIANGLES);
+            this->MarkTile(tileX - 1, tileY,     STALE_TRIANGLES);
+            this->MarkTile(tileX + 1, tileY,     STALE_TRIANGLES);
+            this->MarkTile(tileX,     tileY - 1, STALE_TRIANGLES);
+            this->MarkTile(tileX,     tileY + 1, STALE_TRIANGLES);
+        }
+    }
+    this->hasLeaves = true;
+
+    this->numRebuiltTiles = 0;
+    for (int tileY = 0; tileY < this->numTilesY; tileY++) {
+        for (int tileX = 0; tileX < this->numTilesX; tileX++) {
+            if ((this->tileFlags[tileY * this->numTilesX + tileX] & STALE_TRIANGLES) == 0) {
+                continue;
+            }
+            this->TriangulateTile(tileX, tileY);
+            this->tileFlags[tileY * this->numTilesX + tileX] &= ~STALE_TRIANGLES;
+            this->numRebuiltTiles++;
+        }
+    }
+    if (this->numRebuiltTiles == 0) {
+        return;
+    }
+
+    // The triangles change size with the tiles, so the whole (small) index buffer is replaced
+    this->indices.clear();
+    for (size_t i = 0; i < this->tileIndices.size(); i++) {
+        this->indices.insert(this->indices.end(), this->tileIndices[i].begin(), this->tileIndices[i].end());
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint),
+                 this->indices.empty() ? NULL : &this->indices[0], GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    augengine::debug_opengl_state();
+}
+
+/// <summary> Draw the leaves, with the same vertex arrays as the grid (see DepthGridMesh::Draw). </summary>
+void DepthQuadtreeMesh::Draw() const {
+    this->grid->DrawElements(GL_TRIANGLES, this->indexBuffer, static_cast<GLsizei>(this->indices.size()), false);
+}
+
+/// <summary> Flag the given tile (if there is one) as needing the given rebuilds. </summary>
+void DepthQuadtreeMesh::MarkTile(int tileX, int tileY, BYTE flags) {
+    if (tileX < 0 || tileX >= this->numTilesX || tileY < 0 || tileY >= this->numTilesY) {
+        return;
+    }
+    this->tileFlags[tileY * this->numTilesX + tileX] |= flags;
+}
+
+/// <summary> Split the given node (size x size grid points from x, y) until its leaves are flat enough. </summary>
+void DepthQuadtreeMesh::BuildLeaves(const DepthPyramid& depthPyramid, int x, int y, int size) {
+    if (size > this->minLeafSize && !this->IsFlat(depthPyramid, x, y, size)) {
+        int halfSize = size / 2;
+        this->BuildLeaves(depthPyramid, x,            y,            halfSize);
+        this->BuildLeaves(depthPyramid, x + halfSize, y,            halfSize);
+        this->BuildLeaves(depthPyramid, x,            y + halfSize, halfSize);
+        this->BuildLeaves(depthPyramid, x + halfSize, y + halfSize, halfSize);
+        return;
+    }
+
+    BYTE logSize = static_cast<BYTE>(Log2(size));
+    int numCells = size / this->minLeafSize;
+    int firstCellX = x / this->minLeafSize;
+    int firstCellY = y / this->minLeafSize;
+    for (int cellY = firstCellY; cellY < firstCellY + numCells; cellY++) {
+        std::fill_n(&this->leafSizes[cellY * this->numCellsX + firstCellX], numCells, logSize);
+    }
+}
+
+/// <summary>
+/// Check whether the surface under the given node (from its corners up to its far edges, which are
+/// clamped to the grid) stays within the error tolerance of the two triangles between its corners.
+/// </summary>
+bool DepthQuadtreeMesh::IsFlat(const DepthPyramid& depthPyramid, int x, int y, int size) const {
+    // Nodes hanging off the grid have no triangles
+    if (x >= this->width - 1 || y >= this->height - 1) {
+        return true;
+    }
+    int level = Log2(size);
+    if (level >= depthPyramid.GetNumLevels()) {
+        return false;
+    }
+
+    // Holes can't be interpolated over, but a node of nothing but holes is left whole
+    int levelX = x >> level;
+    int levelY = y >> level;
+    unsigned int numDepths = depthPyramid.GetNumDepths(level, levelX, levelY);
+    if (numDepths == 0) {
+        return true;
+    }
+    int endX = std::min<int>(x + size, this->width - 1);
+    int endY = std::min<int>(y + size, this->height - 1);
+    if (numDepths != static_cast<unsigned int>(std::min<int>(size, this->width - x) * std::min<int>(size, this->height - y))) {
+        return false;
+    }
+
+    float cornerDepth00 = depthPyramid.GetMeanDepth(0, x,    y);
+    float cornerDepth10 = depthPyramid.GetMeanDepth(0, endX, y);
+    float cornerDepth01 = depthPyramid.GetMeanDepth(0, x,    endY);
+    float cornerDepth11 = depthPyramid.GetMeanDepth(0, endX, endY);
+    if (cornerDepth00 == 0.0f || cornerDepth10 == 0.0f || cornerDepth01 == 0.0f || cornerDepth11 == 0.0f) {
+        return false;
+    }
+
+    // The pyramid only covers the node up to its far edges, which it shares with the next nodes, so
+    // the depths along them (unless they were clamped to the grid's last row or column) are added here
+    const USHORT* depths = depthPyramid.GetMeanDepths(0);
+    float minDepth = depthPyramid.GetMinDepth(level, levelX, levelY);
+    float maxDepth = depthPyramid.GetMaxDepth(level, levelX, levelY);
+    if (endY == y + size) {
+        const USHORT* edgeRow = &depths[endY * this->width];
+        for (int pixelX = x; pixelX <= endX; pixelX++) {
+            if (edgeRow[pixelX] == 0) {
+                return false;
+            }
+            minDepth = std::min<float>(minDepth, edgeRow[pixelX]);
+            maxDepth = std::max<float>(maxDepth, edgeRow[pixelX]);
+        }
+    }
+    if (endX == x + size) {
+        for (int pixelY = y; pixelY <= endY; pixelY++) {
+            USHORT depth = depths[pixelY * this->width + endX];
+            if (depth == 0) {
+                return false;
+            }
+            minDepth = std::min<float>(minDepth, depth);
+            maxDepth = std::max<float>(maxDepth, depth);
+        }
+    }
+
+    // Everything interpolated from the corners lies between them, so if the node's depths and its
+    // corners all fit in the tolerance so does the error
+    float maxError = std::max<float>(this->minErrorInMm, this->errorFraction * minDepth);
+    float minCornerDepth = std::min<float>(std::min<float>(cornerDepth00, cornerDepth10), std::min<float>(cornerDepth01, cornerDepth11));
+    float maxCornerDepth = std::max<float>(std::max<float>(cornerDepth00, cornerDepth10), std::max<float>(cornerDepth01, cornerDepth11));
+    if (std::max<float>(maxDepth, maxCornerDepth) - std::min<float>(minDepth, minCornerDepth) <= maxError) {
+        return true;
+    }
+    // The depths can't be that far from the corners if the node is flat
+    if (maxDepth - maxCornerDepth > maxError || minCornerDepth - minDepth > maxError) {
+        return false;
+    }
+
+    // Otherwise (e.g. a sloped floor) compare every depth to the plane of the triangle it falls in,
+    // the leaf is split along the diagonal from its first to its last corner (see TriangulateLeaf).
+    // Finer neighbours only add vertices along the edges (and the centre), which are depths tested
+    // here too, so the fan the leaf is drawn as then stays within the tolerance of the same planes.
+    float invWidth  = 1.0f / (endX - x);
+    float invHeight = 1.0f / (endY - y);
+    float upperStep = (cornerDepth10 - cornerDepth00) * invWidth;  // Along the rows of the 00, 10, 11 triangle
+    float lowerStep = (cornerDepth11 - cornerDepth01) * invWidth;  // Along the rows of the 00, 11, 01 triangle
+    for (int pixelY = y; pixelY <= endY; pixelY++) {
+        float weightY = (pixelY - y) * invHeight;
+        float upperDepth = cornerDepth00 + weightY * (cornerDepth11 - cornerDepth10);
+        float lowerDepth = cornerDepth00 + weightY * (cornerDepth01 - cornerDepth00);
+        const USHORT* depthRow = &depths[pixelY * this->width];
+
+        for (int pixelX = x; pixelX <= endX; pixelX++) {
+            float depth = depthRow[pixelX];
+            float weightX = (pixelX - x) * invWidth;
+            float triangleDepth = (weightX >= weightY) ? upperDepth + (pixelX - x) * upperStep
+                                                       : lowerDepth + (pixelX - x) * lowerStep;
+            if (depth == 0.0f || fabs(depth - triangleDepth) > maxError) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// <summary> Replace the triangles of the given tile with the triangles of its current leaves. </summary>
+void DepthQuadtreeMesh::TriangulateTile(int tileX, int tileY) {
+    std::vector<GLuint>& triangles = this->tileIndices[tileY * this->numTilesX + tileX];
+    triangles.clear();
+
+    int beginX = tileX * this->tileSize;
+    int beginY = tileY * this->tileSize;
+    for (int y = beginY; y < beginY + this->tileSize; y += this->minLeafSize) {
+        for (int x = beginX; x < beginX + this->tileSize; x += this->minLeafSize) {
+            // Only the corner cell of each leaf starts it
+            int size = this->GetLeafSize(x, y);
+            if ((x & (size - 1)) == 0 && (y & (size - 1)) == 0) {
+                this->TriangulateLeaf(x, y, size, triangles);
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Add the triangles of the given leaf: its boundary runs counter-clockwise (in grid space) through
+/// its corners and every corner of a smaller neighbouring leaf along its edges.
+/// </summary>
+void DepthQuadtreeMesh::TriangulateLeaf(int x, int y, int size, std::vector<GLuint>& triangles) {
+    if (x >= this->width - 1 || y >= this->height - 1) {
+        return;
+    }
+
+    // Neighbours smaller than the leaf start where the previous one ended, walking along each edge
+    this->boundary.clear();
+    for (int edgeX = x; edgeX < x + size; ) {
+        this->AddBoundaryPoint(edgeX, y);
+        edgeX += this->HasLeaf(edgeX, y - 1) ? std::min<int>(this->GetLeafSize(edgeX, y - 1), size) : size;
+    }
+    for (int edgeY = y; edgeY < y + size; ) {
+        this->AddBoundaryPoint(x + size, edgeY);
+        edgeY += this->HasLeaf(x + size, edgeY) ? std::min<int>(this->GetLeafSize(x + size, edgeY), size) : size;
+    }
+    for (int edgeX = x + size; edgeX > x; ) {
+        this->AddBoundaryPoint(edgeX, y + size);
+        edgeX -= this->HasLeaf(edgeX - 1, y + size) ? std::min<int>(this->GetLeafSize(edgeX - 1, y + size), size) : size;
+    }
+    for (int edgeY = y + size; edgeY > y; ) {
+        this->AddBoundaryPoint(x, edgeY);
+        edgeY -= this->HasLeaf(x - 1, edgeY - 1) ? std::min<int>(this->GetLeafSize(x - 1, edgeY - 1), size) : size;
+    }
+    // Clamping to the grid can fold the last point onto the first
+    while (this->boundary.size() > 1 && this->boundary.back().x == this->boundary.front().x &&
+           this->boundary.back().y == this->boundary.front().y) {
+        this->boundary.pop_back();
+    }
+
+    size_t numPoints = this->boundary.size();
+    if (numPoints < 3) {
+        return;
+    }
+    if (numPoints <= 4) {
+        this->AddTriangle(this->boundary[0], this->boundary[1], this->boundary[2], triangles);
+        if (numPoints == 4) {
+            this->AddTriangle(this->boundary[0], this->boundary[2], this->boundary[3], triangles);
+        }
+        return;
+    }
+
+    GridPoint centre(std::min<int>(x + size / 2, this->width - 1), std::min<int>(y + size / 2, this->height - 1));
+    for (size_t i = 0; i < numPoints; i++) {
+        this->AddTriangle(centre, this->boundary[i], this->boundary[(i + 1) % numPoints], triangles);
+    }
+}
+
+/// <summary> Add the given grid point (clamped to the grid) to the leaf's boundary, unless it is already the last point. </summary>
+void DepthQuadtreeMesh::AddBoundaryPoint(int x, int y) {
+    GridPoint point(std::min<int>(x, this->width - 1), std::min<int>(y, this->height - 1));
+    if (this->boundary.empty() || this->boundary.back().x != point.x || this->boundary.back().y != point.y) {
+        this->boundary.push_back(point);
+    }
+}
+
+/// <summary> Add the triangle between the given grid points, unless clamping to the grid flattened it. </summary>
+void DepthQuadtreeMesh::AddTriangle(const GridPoint& point0, const GridPoint& point1, const GridPoint& point2,
+                                    std::vector<GLuint>& triangles) const {
+    int area = (point1.x - point0.x) * (point2.y - point0.y) - (point1.y - point0.y) * (point2.x - point0.x);
+    if (area == 0) {
+        return;
+    }
+    assert(area > 0);
+    triangles.push_back(this->grid->GetVertexIndex(point0.x, point0.y));
+    triangles.push_back(this->grid->GetVertexIndex(point1.x, point1.y));
+    triangles.push_back(this->grid->GetVertexIndex(point2.x, point2.y));
+}
@@ -0,0 +1,113 @@
+#ifndef AUG3DENGINE_DEPTHQUADTREEMESH_H_
+#define AUG3DENGINE_DEPTHQUADTREEMESH_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "depth_displaced_mesh.h"
+
+class DepthGridMesh;
+class DepthPyramid;
+class DirtyTiles;
+
+/// <summary>
+/// Adaptive triangulation of a DepthGridMesh, so flat walls and floor take a few large triangles
+/// instead of two per depth pixel:
+///  - The image is split into square tiles, each the root of a quadtree. A node is a leaf if the
+///    surface under it stays within the error tolerance of the two triangles between its corners,
+///    which the depth pyramid's min/max depths settle for most nodes without looking at their
+///    pixels. Nodes with holes are split down to the smallest leaf size.
+///  - Every leaf is triangulated as a fan around its centre through all the corners of its
+///    neighbouring leaves that lie on its edges, so finer neighbours never leave T-junctions
+///    (cracks) along its edges. Leaves with no finer neighbours are just two triangles.
+///  - Only the tiles that changed are rebuilt (see DirtyTiles), along with their neighbours
+///    since the edges they share may have changed.
+/// The leaves use the grid's vertices, only the indices are built (on the CPU) and uploaded.
+/// </summary>
+class DepthQuadtreeMesh : public DepthDisplacedMesh {
+public:
+    static const int DEFAULT_TILE_SIZE = 32;
+    static const int DEFAULT_MIN_LEAF_SIZE = 2;
+    static const float DEFAULT_MIN_ERROR_IN_MM;
+    static const float DEFAULT_ERROR_FRACTION;
+
+    DepthQuadtreeMesh(const DepthGridMesh* grid, int tileSize = DEFAULT_TILE_SIZE,
+                      int minLeafSize = DEFAULT_MIN_LEAF_SIZE);
+    ~DepthQuadtreeMesh();
+
+    void SetErrorTolerance(float minErrorInMm, float errorFraction);
+
+    void Update(const DepthPyramid& depthPyramid, const DirtyTiles* dirtyTiles);
+
+    size_t GetNumTriangles() const;
+    size_t GetNumRebuiltTiles() const;
+    void Draw() const;
+
+private:
+    struct GridPoint {
+        GridPoint(int x, int y) : x(x), y(y) {}
+        int x, y;
+    };
+
+    const DepthGridMesh* grid;  // Not owned by this
+    int width, height;          // Size of the grid (and of the depth images), in vertices
+    int tileSize;
+    int minLeafSize;
+    int numTilesX, numTilesY;
+    int numCellsX, numCellsY;   // Size of the leaf size map, in smallest leaves
+    bool hasLeaves;             // Whether every tile's leaves have been built
+
+    float minErrorInMm;         // Smallest distance the surface may stray from a leaf
+    float errorFraction;        // Distance (as a fraction of the depth) the surface may stray from a leaf
+
+    std::vector<BYTE> leafSizes;                    // Per smallest leaf, log2 of the size of the leaf covering it
+    std::vector<std::vector<GLuint> > tileIndices;  // Per tile, the triangles of its leaves
+    std::vector<BYTE> tileFlags;                    // Per tile, whether its leaves/triangles need rebuilding
+    std::vector<GridPoint> boundary;                // Scratch list of the vertices around a leaf
+    std::vector<GLuint> indices;                    // Triangles of every tile
+    GLuint indexBuffer;
+    size_t numRebuiltTiles;                         // Number of tiles rebuilt by the last update
+
+    // Tile flags for what needs rebuilding
+    enum { STALE_LEAVES = 0x1, STALE_TRIANGLES = 0x2 };
+
+    void MarkTile(int tileX, int tileY, BYTE flags);
+    void BuildLeaves(const DepthPyramid& depthPyramid, int x, int y, int size);
+    bool IsFlat(const DepthPyramid& depthPyramid, int x, int y, int size) const;
+    void TriangulateTile(int tileX, int tileY);
+    void TriangulateLeaf(int x, int y, int size, std::vector<GLuint>& triangles);
+    void AddBoundaryPoint(int x, int y);
+    void AddTriangle(const GridPoint& point0, const GridPoint& point1, const GridPoint& point2,
+                     std::vector<GLuint>& triangles) const;
+    bool HasLeaf(int x, int y) const;
+    int GetLeafSize(int x, int y) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthQuadtreeMesh);
+};
+
+inline void DepthQuadtreeMesh::SetErrorTolerance(float minErrorInMm, float errorFraction) {
+    assert(minErrorInMm >= 0.0f && errorFraction >= 0.0f);
+    this->minErrorInMm  = minErrorInMm;
+    this->errorFraction = errorFraction;
+}
+
+inline size_t DepthQuadtreeMesh::GetNumTriangles() const {
+    return this->indices.size() / 3;
+}
+
+/// <summary> Get the number of tiles whose triangles were rebuilt by the last update. </summary>
+inline size_t DepthQuadtreeMesh::GetNumRebuiltTiles() const {
+    return this->numRebuiltTiles;
+}
+
+/// <summary> Check whether the given grid point is covered by a leaf (the tiles can overhang the grid). </summary>
+inline bool DepthQuadtreeMesh::HasLeaf(int x, int y) const {
+    return x >= 0 && x < this->numTilesX * this->tileSize && y >= 0 && y < this->numTilesY * this->tileSize;
+}
+
+/// <summary> Get the size of the leaf covering the given grid point. </summary>
+inline int DepthQuadtreeMesh::GetLeafSize(int x, int y) const {
+    assert(this->HasLeaf(x, y));
+    return 1 << this->leafSizes[(y / this->minLeafSize) * this->numCellsX + x / this->minLeafSize];
+}
+
+#endif // AUG3DENGINE_DEPTHQUADTREEMESH_H_
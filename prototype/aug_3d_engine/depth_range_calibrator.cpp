@@ -0,0 +1,91 @@
+// AugEngine Includes
+#include "depth_range_calibrator.h"
+
+const float DepthRangeCalibrator::DEFAULT_NEAR_PERCENTILE  = 0.01f;
+const float DepthRangeCalibrator::DEFAULT_FAR_PERCENTILE   = 0.99f;
+const float DepthRangeCalibrator::DEFAULT_HISTOGRAM_DECAY  = 0.95f;
+const float DepthRangeCalibrator::DEFAULT_SMOOTHING_FACTOR = 0.05f;
+const float DepthRangeCalibrator::DEFAULT_MARGIN_IN_MM     = 50.0f;
+const float DepthRangeCalibrator::BIN_SIZE_IN_MM           = 16.0f;
+
+// Smallest range the calibrated distances are allowed to shrink to
+static const float MIN_RANGE_IN_MM = 200.0f;
+
+DepthRangeCalibrator::DepthRangeCalibrator(float minDistanceInMm, float maxDistanceInMm) :
+minDistanceInMm(minDistanceInMm), maxDistanceInMm(maxDistanceInMm),
+nearPercentile(DEFAULT_NEAR_PERCENTILE), farPercentile(DEFAULT_FAR_PERCENTILE),
+histogramDecay(DEFAULT_HISTOGRAM_DECAY), smoothingFactor(DEFAULT_SMOOTHING_FACTOR), marginInMm(DEFAULT_MARGIN_IN_MM),
+histogram(static_cast<size_t>(std::ceil((maxDistanceInMm - minDistanceInMm) / BIN_SIZE_IN_MM)) + 1, 0.0f),
+numDepths(0.0f), nearDistanceInMm(minDistanceInMm), farDistanceInMm(maxDistanceInMm) {
+    assert(maxDistanceInMm - minDistanceInMm >= MIN_RANGE_IN_MM);
+}
+
+DepthRangeCalibrator::~DepthRangeCalibrator() {
+}
+
+/// <summary> Forget all the depths seen so far and go back to the sensor's whole range. </summary>
+void DepthRangeCalibrator::Reset() {
+    std::fill(this->histogram.begin(), this->histogram.end(), 0.0f);
+    this->numDepths = 0.0f;
+    this->nearDistanceInMm = this->minDistanceInMm;
+    this->farDistanceInMm  = this->maxDistanceInMm;
+}
+
+/// <summary>
+/// Count the given depths (a frame, or a coarser view of one) in the histogram and move the
+/// near and far distances towards the histogram's percentiles.
+/// </summary>
+void DepthRangeCalibrator::AddDepths(const USHORT* depthInMm, size_t count) {
+    assert(depthInMm != NULL);
+
+    for (size_t i = 0; i < this->histogram.size(); i++) {
+        this->histogram[i] *= this->histogramDecay;
+    }
+    this->numDepths *= this->histogramDecay;
+
+    const float invBinSize = 1.0f / BIN_SIZE_IN_MM;
+    const int lastBinIdx = static_cast<int>(this->histogram.size()) - 1;
+    for (size_t i = 0; i < count; i++) {
+        if (depthInMm[i] == 0) {
+            continue;
+        }
+        int binIdx = static_cast<int>((depthInMm[i] - this->minDistanceInMm) * invBinSize);
+        this->histogram[std::max<int>(0, std::min<int>(binIdx, lastBinIdx))] += 1.0f;
+        this->numDepths += 1.0f;
+    }
+    if (this->numDepths < 1.0f) {
+        // Nothing (recent) to calibrate against, e.g., the sensor is covered
+        return;
+    }
+
+    float targetNearInMm = std::max<float>(this->GetPercentileInMm(this->nearPercentile) - this->marginInMm,
+                                           this->minDistanceInMm);
+    float targetFarInMm  = std::min<float>(this->GetPercentileInMm(this->farPercentile) + this->marginInMm,
+                                           this->maxDistanceInMm);
+    this->nearDistanceInMm += this->smoothingFactor * (targetNearInMm - this->nearDistanceInMm);
+    this->farDistanceInMm  += this->smoothingFactor * (targetFarInMm  - this->farDistanceInMm);
+
+    // Keep the range from collapsing (e.g., a flat wall right in front of the sensor)
+    if (this->farDistanceInMm - this->nearDistanceInMm < MIN_RANGE_IN_MM) {
+        float centreInMm = 0.5f * (this->nearDistanceInMm + this->farDistanceInMm);
+        centreInMm = std::max<float>(this->minDistanceInMm + 0.5f * MIN_RANGE_IN_MM,
+                                     std::min<float>(centreInMm, this->maxDistanceInMm - 0.5f * MIN_RANGE_IN_MM));
+        this->nearDistanceInMm = centreInMm - 0.5f * MIN_RANGE_IN_MM;
+        this->farDistanceInMm  = centreInMm + 0.5f * MIN_RANGE_IN_MM;
+    }
+}
+
+/// <summary> Get the depth that the given fraction of the depths in the histogram are closer than. </summary>
+float DepthRangeCalibrator::GetPercentileInMm(float percentile) const {
+    float targetCount = percentile * this->numDepths;
+    float count = 0.0f;
+    for (size_t i = 0; i < this->histogram.size(); i++) {
+        count += this->histogram[i];
+        if (count >= targetCount) {
+            // Interpolate within the bin
+            float binFraction = (this->histogram[i] > 0.0f) ? 1.0f - (count - targetCount) / this->histogram[i] : 0.0f;
+            return this->minDistanceInMm + (i + binFraction) * BIN_SIZE_IN_MM;
+        }
+    }
+    return this->maxDistanceInMm;
+}
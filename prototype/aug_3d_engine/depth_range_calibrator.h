@@ -0,0 +1,89 @@
+#ifndef AUG3DENGINE_DEPTHRANGECALIBRATOR_H_
+#define AUG3DENGINE_DEPTHRANGECALIBRATOR_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Finds the range of depths (in mm) the scene actually occupies, so the depth textures don't
+/// waste their precision on empty space in front of or behind the scene:
+///  - Every frame's depths (ignoring holes) are counted in a histogram that decays over time,
+///    so the histogram covers the last few seconds and a single odd frame barely moves it.
+///  - The near and far distances are robust (low and high) percentiles of the histogram, widened
+///    by a margin and clamped to the sensor's range.
+///  - The calibrated distances move smoothly towards those targets instead of jumping.
+/// </summary>
+class DepthRangeCalibrator {
+public:
+    static const float DEFAULT_NEAR_PERCENTILE;
+    static const float DEFAULT_FAR_PERCENTILE;
+    static const float DEFAULT_HISTOGRAM_DECAY;
+    static const float DEFAULT_SMOOTHING_FACTOR;
+    static const float DEFAULT_MARGIN_IN_MM;
+    static const float BIN_SIZE_IN_MM;
+
+    DepthRangeCalibrator(float minDistanceInMm, float maxDistanceInMm);
+    ~DepthRangeCalibrator();
+
+    void SetPercentiles(float nearPercentile, float farPercentile);
+    void SetHistogramDecay(float histogramDecay);
+    void SetSmoothingFactor(float smoothingFactor);
+    void SetMarginInMm(float marginInMm);
+
+    void Reset();
+    void AddDepths(const USHORT* depthInMm, size_t count);
+
+    float GetNearDistanceInMm() const;
+    float GetFarDistanceInMm() const;
+
+private:
+    float minDistanceInMm;  // Closest distance the sensor can measure
+    float maxDistanceInMm;  // Furthest distance the sensor can measure
+
+    float nearPercentile;   // Fraction of the depths that are allowed to be closer than the near distance
+    float farPercentile;    // Fraction of the depths that are allowed to be closer than the far distance
+    float histogramDecay;   // How much (in [0,1)) of the histogram is kept every frame
+    float smoothingFactor;  // How far (in (0,1]) the distances move towards their targets every frame
+    float marginInMm;       // Extra distance the range is widened by on both ends
+
+    std::vector<float> histogram;   // Decayed counts of the depths in BIN_SIZE_IN_MM bins from the min distance
+    float numDepths;                // Decayed number of depths in the histogram
+
+    float nearDistanceInMm;
+    float farDistanceInMm;
+
+    float GetPercentileInMm(float percentile) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthRangeCalibrator);
+};
+
+inline void DepthRangeCalibrator::SetPercentiles(float nearPercentile, float farPercentile) {
+    assert(nearPercentile >= 0.0f && nearPercentile < farPercentile && farPercentile <= 1.0f);
+    this->nearPercentile = nearPercentile;
+    this->farPercentile  = farPercentile;
+}
+
+inline void DepthRangeCalibrator::SetHistogramDecay(float histogramDecay) {
+    assert(histogramDecay >= 0.0f && histogramDecay < 1.0f);
+    this->histogramDecay = histogramDecay;
+}
+
+inline void DepthRangeCalibrator::SetSmoothingFactor(float smoothingFactor) {
+    assert(smoothingFactor > 0.0f && smoothingFactor <= 1.0f);
+    this->smoothingFactor = smoothingFactor;
+}
+
+inline void DepthRangeCalibrator::SetMarginInMm(float marginInMm) {
+    assert(marginInMm >= 0.0f);
+    this->marginInMm = marginInMm;
+}
+
+inline float DepthRangeCalibrator::GetNearDistanceInMm() const {
+    return this->nearDistanceInMm;
+}
+
+inline float DepthRangeCalibrator::GetFarDistanceInMm() const {
+    return this->farDistanceInMm;
+}
+
+#endif // AUG3DENGINE_DEPTHRANGECALIBRATOR_H_
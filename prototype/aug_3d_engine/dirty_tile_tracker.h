@@ -0,0 +1,245 @@
+#ifndef AUG3DENGINE_DIRTYTILETRACKER_H_
+#define AUG3DENGINE_DIRTYTILETRACKER_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+
+/// <summary>
+/// Which square tiles of an image changed since the image was last looked at (see DirtyTileTracker).
+/// The tiles along the right and bottom edges are cut short by the edges of the image. The tiles
+/// are copied along with the frame they were found in.
+/// </summary>
+class DirtyTiles {
+public:
+    DirtyTiles() : tileSize(0), numTilesX(0), numTilesY(0) {}
+
+    void Resize(int width, int height, int tileSize);
+    void SetAll(bool isDirty);
+
+    int GetTileSize() const;
+    int GetNumTilesX() const;
+    int GetNumTilesY() const;
+    bool IsDirty(int tileX, int tileY) const;
+    void SetDirty(int tileX, int tileY, bool isDirty);
+    size_t CountDirty() const;
+
+    void DilateFrom(const DirtyTiles& dirtyTiles);
+
+private:
+    int tileSize;
+    int numTilesX, numTilesY;
+    std::vector<BYTE> isDirty;  // Per tile flag, row by row
+};
+
+/// <summary>
+/// Finds the tiles of a stream of images (of any number of components per pixel) that changed
+/// since they were last found dirty, so the stages that follow only redo (or re-upload) those tiles.
+/// A tile is dirty if any component differs from the tracker's reference image by more than the
+/// threshold, the reference is only updated for dirty tiles so slow drifts still add up to a change.
+/// The tiles are checked a row of tiles at a time in parallel on a thread pool.
+/// </summary>
+template <typename T>
+class DirtyTileTracker {
+public:
+    static const int DEFAULT_TILE_SIZE = 32;
+
+    DirtyTileTracker(int width, int height, int componentsPerPixel, ThreadPool* threadPool,
+                     int tileSize = DEFAULT_TILE_SIZE);
+    ~DirtyTileTracker() {}
+
+    void SetThreshold(T threshold);
+
+    void Reset();
+    void Update(const T* image, DirtyTiles& dirtyTiles);
+
+private:
+    // Checks a range of rows of tiles of the current image
+    class CheckTileRowsTask : public ParallelTask {
+    public:
+        CheckTileRowsTask(DirtyTileTracker& tracker) : tracker(tracker), image(NULL), dirtyTiles(NULL) {}
+        void Run(size_t beginTileRow, size_t endTileRow);
+
+        DirtyTileTracker& tracker;
+        const T* image;
+        DirtyTiles* dirtyTiles;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(CheckTileRowsTask);
+    };
+
+    int width, height;
+    int componentsPerPixel;
+    int tileSize;
+    ThreadPool* threadPool; // Not owned by this
+
+    T threshold;                // Largest difference in a component that doesn't make a tile dirty
+    bool hasReference;          // Whether the reference image holds an image yet
+    std::vector<T> reference;   // The image as of when each of its tiles was last dirty
+
+    CheckTileRowsTask checkTileRowsTask;
+
+    bool IsTileDirty(const T* image, int beginX, int beginY, int endX, int endY) const;
+
+    DISALLOW_COPY_AND_ASSIGN(DirtyTileTracker);
+};
+
+inline void DirtyTiles::Resize(int width, int height, int tileSize) {
+    assert(width > 0 && height > 0 && tileSize > 0);
+    this->tileSize  = tileSize;
+    this->numTilesX = (width  + tileSize - 1) / tileSize;
+    this->numTilesY = (height + tileSize - 1) / tileSize;
+    this->isDirty.assign(this->numTilesX * this->numTilesY, 1);
+}
+
+inline void DirtyTiles::SetAll(bool isDirty) {
+    std::fill(this->isDirty.begin(), this->isDirty.end(), isDirty ? 1 : 0);
+}
+
+inline int DirtyTiles::GetTileSize() const {
+    return this->tileSize;
+}
+
+inline int DirtyTiles::GetNumTilesX() const {
+    return this->numTilesX;
+}
+
+inline int DirtyTiles::GetNumTilesY() const {
+    return this->numTilesY;
+}
+
+inline bool DirtyTiles::IsDirty(int tileX, int tileY) const {
+    assert(tileX >= 0 && tileX < this->numTilesX && tileY >= 0 && tileY < this->numTilesY);
+    return this->isDirty[tileY * this->numTilesX + tileX] != 0;
+}
+
+inline void DirtyTiles::SetDirty(int tileX, int tileY, bool isDirty) {
+    assert(tileX >= 0 && tileX < this->numTilesX && tileY >= 0 && tileY < this->numTilesY);
+    this->isDirty[tileY * this->numTilesX + tileX] = isDirty ? 1 : 0;
+}
+
+inline size_t DirtyTiles::CountDirty() const {
+    return this->isDirty.size() - std::count(this->isDirty.begin(), this->isDirty.end(), 0);
+}
+
+/// <summary>
+/// Make these tiles the given tiles grown by a tile in every direction, for images derived from
+/// windows of pixels (smaller than a tile) that also change when the tiles next to them do.
+/// </summary>
+inline void DirtyTiles::DilateFrom(const DirtyTiles& dirtyTiles) {
+    this->tileSize  = dirtyTiles.tileSize;
+    this->numTilesX = dirtyTiles.numTilesX;
+    this->numTilesY = dirtyTiles.numTilesY;
+    this->isDirty.assign(dirtyTiles.isDirty.size(), 0);
+
+    for (int tileY = 0; tileY < this->numTilesY; tileY++) {
+        for (int tileX = 0; tileX < this->numTilesX; tileX++) {
+            if (!dirtyTiles.IsDirty(tileX, tileY)) {
+                continue;
+            }
+            for (int y = std::max<int>(tileY - 1, 0); y <= std::min<int>(tileY + 1, this->numTilesY - 1); y++) {
+                for (int x = std::max<int>(tileX - 1, 0); x <= std::min<int>(tileX + 1, this->numTilesX - 1); x++) {
+                    this->SetDirty(x, y, true);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+DirtyTileTracker<T>::DirtyTileTracker(int width, int height, int componentsPerPixel, ThreadPool* threadPool,
+                                      int tileSize) :
+width(width), height(height), componentsPerPixel(componentsPerPixel), tileSize(tileSize), threadPool(threadPool),
+threshold(0), hasReference(false), reference(width*height*componentsPerPixel, 0), checkTileRowsTask(*this) {
+    assert(width > 0 && height > 0 && componentsPerPixel > 0 && tileSize > 0);
+    assert(threadPool != NULL);
+}
+
+template <typename T>
+inline void DirtyTileTracker<T>::SetThreshold(T threshold) {
+    this->threshold = threshold;
+}
+
+/// <summary> Forget the reference image, every tile of the next image is dirty. </summary>
+template <typename T>
+inline void DirtyTileTracker<T>::Reset() {
+    this->hasReference = false;
+}
+
+/// <summary>
+/// Find the tiles of the given image (which must be the size of the tracker) that changed since
+/// they were last dirty and take them as the new reference.
+/// </summary>
+template <typename T>
+void DirtyTileTracker<T>::Update(const T* image, DirtyTiles& dirtyTiles) {
+    assert(image != NULL);
+    int numTilesX = (this->width  + this->tileSize - 1) / this->tileSize;
+    int numTilesY = (this->height + this->tileSize - 1) / this->tileSize;
+    if (dirtyTiles.GetTileSize() != this->tileSize || dirtyTiles.GetNumTilesX() != numTilesX ||
+        dirtyTiles.GetNumTilesY() != numTilesY) {
+        dirtyTiles.Resize(this->width, this->height, this->tileSize);
+    }
+
+    if (!this->hasReference) {
+        memcpy(&this->reference[0], image, this->reference.size() * sizeof(T));
+        dirtyTiles.SetAll(true);
+        this->hasReference = true;
+        return;
+    }
+
+    this->checkTileRowsTask.image = image;
+    this->checkTileRowsTask.dirtyTiles = &dirtyTiles;
+    this->threadPool->ParallelFor(this->checkTileRowsTask, dirtyTiles.GetNumTilesY(), 1);
+}
+
+/// <summary> Check whether any component in the given range of pixels differs from the reference by more than the threshold. </summary>
+template <typename T>
+bool DirtyTileTracker<T>::IsTileDirty(const T* image, int beginX, int beginY, int endX, int endY) const {
+    int rowLength = this->width * this->componentsPerPixel;
+    int beginComponent = beginX * this->componentsPerPixel;
+    int endComponent   = endX * this->componentsPerPixel;
+    int threshold = this->threshold;
+
+    for (int y = beginY; y < endY; y++) {
+        const T* imageRow     = image + y * rowLength;
+        const T* referenceRow = &this->reference[y * rowLength];
+        for (int i = beginComponent; i < endComponent; i++) {
+            int diff = static_cast<int>(imageRow[i]) - static_cast<int>(referenceRow[i]);
+            if (diff > threshold || diff < -threshold) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <typename T>
+void DirtyTileTracker<T>::CheckTileRowsTask::Run(size_t beginTileRow, size_t endTileRow) {
+    DirtyTileTracker& tracker = this->tracker;
+    int rowLength = tracker.width * tracker.componentsPerPixel;
+
+    for (int tileY = static_cast<int>(beginTileRow); tileY < static_cast<int>(endTileRow); tileY++) {
+        int beginY = tileY * tracker.tileSize;
+        int endY   = std::min<int>(beginY + tracker.tileSize, tracker.height);
+
+        for (int tileX = 0; tileX < this->dirtyTiles->GetNumTilesX(); tileX++) {
+            int beginX = tileX * tracker.tileSize;
+            int endX   = std::min<int>(beginX + tracker.tileSize, tracker.width);
+
+            bool isDirty = tracker.IsTileDirty(this->image, beginX, beginY, endX, endY);
+            this->dirtyTiles->SetDirty(tileX, tileY, isDirty);
+            if (!isDirty) {
+                continue;
+            }
+
+            // The tile is redone downstream, so it is the reference for the changes that follow
+            size_t tileRowSize = (endX - beginX) * tracker.componentsPerPixel * sizeof(T);
+            for (int y = beginY; y < endY; y++) {
+                size_t offset = y * rowLength + beginX * tracker.componentsPerPixel;
+                memcpy(&tracker.reference[offset], this->image + offset, tileRowSize);
+            }
+        }
+    }
+}
+
+#endif // AUG3DENGINE_DIRTYTILETRACKER_H_
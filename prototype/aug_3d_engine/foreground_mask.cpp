@@ -0,0 +1,31 @@
+// AugEngine Includes
+#include "foreground_mask.h"
+
+ForegroundMask::ForegroundMask() : width(0), height(0), wordsPerRow(0) {
+}
+
+ForegroundMask::~ForegroundMask() {
+}
+
+/// <summary> Resize the mask to cover an image of the given size, every pixel starts in the background. </summary>
+void ForegroundMask::Resize(int width, int height) {
+    assert(width > 0 && height > 0);
+    this->width  = width;
+    this->height = height;
+    this->wordsPerRow = (width + 31) / 32;
+    this->bits.assign(this->wordsPerRow * height, 0);
+}
+
+/// <summary> Put every pixel in the foreground (nothing can be skipped) or in the background. </summary>
+void ForegroundMask::SetAll(bool isForeground) {
+    std::fill(this->bits.begin(), this->bits.end(), isForeground ? 0xFFFFFFFFu : 0u);
+
+    // Keep the padding bits past the end of each row clear so counting can ignore them
+    int numPaddingBits = this->wordsPerRow * 32 - this->width;
+    if (isForeground && numPaddingBits > 0) {
+        UINT32 lastWordMask = 0xFFFFFFFFu >> numPaddingBits;
+        for (int y = 0; y < this->height; y++) {
+            this->GetRow(y)[this->wordsPerRow - 1] = lastWordMask;
+        }
+    }
+}
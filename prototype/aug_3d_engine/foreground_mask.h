@@ -0,0 +1,62 @@
+#ifndef AUG3DENGINE_FOREGROUNDMASK_H_
+#define AUG3DENGINE_FOREGROUNDMASK_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// One bit per pixel of an image saying whether the pixel is in the foreground (see DepthBackgroundModel).
+/// Every row starts on a new 32-bit word (bit x%32 of word x/32 is pixel x) so rows can be written
+/// in parallel and whole runs of 32 background pixels can be skipped with a single test. The mask
+/// is copied along with the frame it was built from.
+/// </summary>
+class ForegroundMask {
+public:
+    ForegroundMask();
+    ~ForegroundMask();
+
+    void Resize(int width, int height);
+    void SetAll(bool isForeground);
+
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetWordsPerRow() const;
+    UINT32* GetRow(int y);
+    const UINT32* GetRow(int y) const;
+
+    bool IsForeground(int x, int y) const;
+
+private:
+    int width, height;
+    int wordsPerRow;
+    std::vector<UINT32> bits;
+};
+
+inline int ForegroundMask::GetWidth() const {
+    return this->width;
+}
+
+inline int ForegroundMask::GetHeight() const {
+    return this->height;
+}
+
+inline int ForegroundMask::GetWordsPerRow() const {
+    return this->wordsPerRow;
+}
+
+inline UINT32* ForegroundMask::GetRow(int y) {
+    assert(y >= 0 && y < this->height);
+    return &this->bits[y * this->wordsPerRow];
+}
+
+inline const UINT32* ForegroundMask::GetRow(int y) const {
+    assert(y >= 0 && y < this->height);
+    return &this->bits[y * this->wordsPerRow];
+}
+
+inline bool ForegroundMask::IsForeground(int x, int y) const {
+    assert(x >= 0 && x < this->width);
+    return (this->GetRow(y)[x >> 5] & (1u << (x & 31))) != 0;
+}
+
+#endif // AUG3DENGINE_FOREGROUNDMASK_H_
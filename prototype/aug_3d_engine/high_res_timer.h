@@ -0,0 +1,26 @@
+#ifndef AUG3DENGINE_HIGHRESTIMER_H_
+#define AUG3DENGINE_HIGHRESTIMER_H_
+
+// AugEngine Includes
+#include "common.h"
+
+namespace augengine {
+
+/// <summary>
+/// Gets the current time of the high resolution performance counter in milliseconds.
+/// The value is only meaningful relative to other values returned by this function.
+/// </summary>
+inline double GetHighResTimeInMs() {
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return 1000.0 * static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+}
+
+}; // namespace augengine
+
+#endif // AUG3DENGINE_HIGHRESTIMER_H_
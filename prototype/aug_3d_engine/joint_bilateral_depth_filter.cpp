@@ -0,0 +1,144 @@
+// AugEngine Includes
+#include "joint_bilateral_depth_filter.h"
+
+const float JointBilateralDepthFilter::DEFAULT_SPATIAL_SIGMA = 2.0f;
+const float JointBilateralDepthFilter::DEFAULT_COLOUR_SIGMA  = 12.0f;
+
+// Smallest number of rows filtered horizontally by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK = 16;
+
+JointBilateralDepthFilter::JointBilateralDepthFilter(int width, int height, int guideWidth, int guideHeight,
+                                                     ThreadPool* threadPool) :
+width(width), height(height), guideWidth(guideWidth), guideHeight(guideHeight), threadPool(threadPool),
+radius(0), colourWeights(UCHAR_MAX + 1, 0.0f), guideColumns(width, 0), guideLuminance(width*height, 0),
+weightedDepthSums(width*height, 0.0f), weightSums(width*height, 0.0f),
+horizontalPassTask(*this), verticalPassTask(*this) {
+    assert(width > 0 && height > 0);
+    assert(guideWidth > 0 && guideHeight > 0);
+    assert(threadPool != NULL);
+
+    // The guide image may have a different resolution, use its nearest pixel
+    for (int x = 0; x < width; x++) {
+        this->guideColumns[x] = x * guideWidth / width;
+    }
+
+    this->SetKernel(DEFAULT_RADIUS, DEFAULT_SPATIAL_SIGMA, DEFAULT_COLOUR_SIGMA);
+}
+
+JointBilateralDepthFilter::~JointBilateralDepthFilter() {
+}
+
+/// <summary>
+/// Set the size of the filter: the radius (in pixels) of each pass, how quickly the weights fall off
+/// with distance (in pixels) and with difference in colour (in luminance levels out of 255).
+/// </summary>
+void JointBilateralDepthFilter::SetKernel(int radius, float spatialSigma, float colourSigma) {
+    assert(radius > 0 && radius < TILE_SIZE);
+    assert(spatialSigma > 0.0f && colourSigma > 0.0f);
+
+    this->radius = radius;
+    this->spatialWeights.resize(2*radius + 1);
+    for (int i = -radius; i <= radius; i++) {
+        this->spatialWeights[i + radius] = exp(-(i*i) / (2.0f * spatialSigma * spatialSigma));
+    }
+    for (size_t i = 0; i < this->colourWeights.size(); i++) {
+        float diff = static_cast<float>(i);
+        this->colourWeights[i] = exp(-(diff*diff) / (2.0f * colourSigma * colourSigma));
+    }
+}
+
+/// <summary>
+/// Filter the given depth image (which must be the size of the filter) in place, guided by the
+/// given BGRA colour image (which must be the guide size given to the filter).
+/// </summary>
+void JointBilateralDepthFilter::Apply(USHORT* depthInMm, const BYTE* guideBGRA) {
+    assert(depthInMm != NULL && guideBGRA != NULL);
+
+    this->horizontalPassTask.depthInMm = depthInMm;
+    this->horizontalPassTask.guideBGRA = guideBGRA;
+    this->threadPool->ParallelFor(this->horizontalPassTask, this->height, MIN_ROWS_PER_CHUNK);
+
+    this->verticalPassTask.depthInMm = depthInMm;
+    this->threadPool->ParallelFor(this->verticalPassTask, this->GetNumTilesX() * this->GetNumTilesY(), 1);
+}
+
+void JointBilateralDepthFilter::HorizontalPassTask::Run(size_t beginRow, size_t endRow) {
+    JointBilateralDepthFilter& filter = this->filter;
+    const int width  = filter.width;
+    const int radius = filter.radius;
+
+    for (size_t y = beginRow; y < endRow; y++) {
+        size_t rowIdx = y * width;
+        BYTE* luminance = &filter.guideLuminance[rowIdx];
+        const USHORT* depthInMm = &this->depthInMm[rowIdx];
+
+        // Rec. 601 luminance in 8-bit fixed point
+        const BYTE* guideRow = &this->guideBGRA[(y * filter.guideHeight / filter.height) * filter.guideWidth * 4];
+        for (int x = 0; x < width; x++) {
+            const BYTE* bgra = &guideRow[filter.guideColumns[x] * 4];
+            luminance[x] = static_cast<BYTE>((29*bgra[0] + 150*bgra[1] + 77*bgra[2]) >> 8);
+        }
+
+        for (int x = 0; x < width; x++) {
+            int beginX = std::max<int>(x - radius, 0);
+            int endX   = std::min<int>(x + radius, width - 1);
+            BYTE centreLuminance = luminance[x];
+
+            float weightedDepthSum = 0.0f;
+            float weightSum = 0.0f;
+            for (int i = beginX; i <= endX; i++) {
+                if (depthInMm[i] == 0) {
+                    continue;
+                }
+                float weight = filter.spatialWeights[i - x + radius] *
+                               filter.colourWeights[abs(luminance[i] - centreLuminance)];
+                weightedDepthSum += weight * depthInMm[i];
+                weightSum += weight;
+            }
+
+            filter.weightedDepthSums[rowIdx + x] = weightedDepthSum;
+            filter.weightSums[rowIdx + x] = weightSum;
+        }
+    }
+}
+
+void JointBilateralDepthFilter::VerticalPassTask::Run(size_t beginTile, size_t endTile) {
+    JointBilateralDepthFilter& filter = this->filter;
+    const int width  = filter.width;
+    const int height = filter.height;
+    const int radius = filter.radius;
+    const int numTilesX = filter.GetNumTilesX();
+
+    for (size_t tileIdx = beginTile; tileIdx < endTile; tileIdx++) {
+        int tileX = static_cast<int>(tileIdx) % numTilesX;
+        int tileY = static_cast<int>(tileIdx) / numTilesX;
+        int beginX = tileX * TILE_SIZE;
+        int endX   = std::min<int>(beginX + TILE_SIZE, width);
+        int beginY = tileY * TILE_SIZE;
+        int endY   = std::min<int>(beginY + TILE_SIZE, height);
+
+        for (int y = beginY; y < endY; y++) {
+            int beginTapY = std::max<int>(y - radius, 0);
+            int endTapY   = std::min<int>(y + radius, height - 1);
+
+            for (int x = beginX; x < endX; x++) {
+                size_t pixelIdx = y * width + x;
+                BYTE centreLuminance = filter.guideLuminance[pixelIdx];
+
+                // Each tap carries the total weight of its horizontal pass, so holes stay weightless
+                float weightedDepthSum = 0.0f;
+                float weightSum = 0.0f;
+                for (int i = beginTapY; i <= endTapY; i++) {
+                    size_t tapIdx = i * width + x;
+                    float weight = filter.spatialWeights[i - y + radius] *
+                                   filter.colourWeights[abs(filter.guideLuminance[tapIdx] - centreLuminance)];
+                    weightedDepthSum += weight * filter.weightedDepthSums[tapIdx];
+                    weightSum += weight * filter.weightSums[tapIdx];
+                }
+
+                this->depthInMm[pixelIdx] = (weightSum > 0.0f) ?
+                    static_cast<USHORT>(weightedDepthSum / weightSum + 0.5f) : 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef AUG3DENGINE_JOINTBILATERALDEPTHFILTER_H_
+#define AUG3DENGINE_JOINTBILATERALDEPTHFILTER_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+
+/// <summary>
+/// Joint (cross) bilateral filter over kinect depth images (16-bit, in mm) that is guided by the
+/// colour image: depths are only averaged with neighbours of a similar colour, which pulls the
+/// edges in the depth image onto the edges in the colour image and fills small holes from
+/// neighbours on the same surface. Holes (zero depth) never contribute to their neighbours.
+///
+/// The filter is approximated by a horizontal pass followed by a vertical pass. The horizontal
+/// pass runs over bands of rows and the vertical pass over square tiles so that each thread
+/// of the thread pool works on a cache-sized piece of the image.
+/// </summary>
+class JointBilateralDepthFilter {
+public:
+    static const int DEFAULT_RADIUS = 3;
+    static const float DEFAULT_SPATIAL_SIGMA;
+    static const float DEFAULT_COLOUR_SIGMA;
+
+    JointBilateralDepthFilter(int width, int height, int guideWidth, int guideHeight, ThreadPool* threadPool);
+    ~JointBilateralDepthFilter();
+
+    void SetKernel(int radius, float spatialSigma, float colourSigma);
+
+    void Apply(USHORT* depthInMm, const BYTE* guideBGRA);
+
+private:
+    // Size (in pixels) of the square tiles of the vertical pass
+    static const int TILE_SIZE = 64;
+
+    // Converts the guide to luminance and filters a band of rows horizontally
+    class HorizontalPassTask : public ParallelTask {
+    public:
+        HorizontalPassTask(JointBilateralDepthFilter& filter) : filter(filter), depthInMm(NULL), guideBGRA(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        JointBilateralDepthFilter& filter;
+        const USHORT* depthInMm;
+        const BYTE* guideBGRA;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(HorizontalPassTask);
+    };
+
+    // Filters a range of tiles vertically and writes the result
+    class VerticalPassTask : public ParallelTask {
+    public:
+        VerticalPassTask(JointBilateralDepthFilter& filter) : filter(filter), depthInMm(NULL) {}
+        void Run(size_t beginTile, size_t endTile);
+
+        JointBilateralDepthFilter& filter;
+        USHORT* depthInMm;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(VerticalPassTask);
+    };
+
+    int width, height;
+    int guideWidth, guideHeight;
+    ThreadPool* threadPool; // Not owned by this
+
+    int radius;
+    std::vector<float> spatialWeights;  // Weight of each tap in [-radius, radius] (indexed by offset + radius)
+    std::vector<float> colourWeights;   // Weight of each absolute difference in luminance [0, 255]
+
+    std::vector<int> guideColumns;          // Column of the guide image for each column of the depth image
+    std::vector<BYTE> guideLuminance;       // Luminance of the guide at every depth pixel
+    std::vector<float> weightedDepthSums;   // Sum of the weighted depths of the horizontal pass
+    std::vector<float> weightSums;          // Sum of the weights of the horizontal pass
+
+    HorizontalPassTask horizontalPassTask;
+    VerticalPassTask verticalPassTask;
+
+    int GetNumTilesX() const;
+    int GetNumTilesY() const;
+
+    DISALLOW_COPY_AND_ASSIGN(JointBilateralDepthFilter);
+};
+
+inline int JointBilateralDepthFilter::GetNumTilesX() const {
+    return (this->width + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+inline int JointBilateralDepthFilter::GetNumTilesY() const {
+    return (this->height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+#endif // AUG3DENGINE_JOINTBILATERALDEPTHFILTER_H_
@@ -0,0 +1,96 @@
+// AugEngine Includes
+#include "latency_histogram.h"
+
+const double LatencyHistogram::DEFAULT_BUCKET_SIZE_IN_MS = 0.5;
+
+LatencyHistogram::LatencyHistogram(const std::string& name, size_t windowSize,
+                                   size_t numBuckets, double bucketSizeInMs) :
+name(name), bucketSizeInMs(bucketSizeInMs), samples(windowSize, 0.0), nextSampleIdx(0), numSamples(0),
+buckets(numBuckets + 1, 0) {
+    assert(windowSize > 0);
+    assert(numBuckets > 0);
+    assert(bucketSizeInMs > 0.0);
+}
+
+LatencyHistogram::~LatencyHistogram() {
+}
+
+/// <summary> Add a sample to the window, replacing the oldest sample if the window is full. </summary>
+void LatencyHistogram::AddSample(double latencyInMs) {
+    if (this->numSamples == this->samples.size()) {
+        double oldestLatencyInMs = this->samples[this->nextSampleIdx];
+        this->buckets[this->GetBucketIndex(oldestLatencyInMs)]--;
+    }
+    else {
+        this->numSamples++;
+    }
+
+    this->samples[this->nextSampleIdx] = latencyInMs;
+    this->buckets[this->GetBucketIndex(latencyInMs)]++;
+    this->nextSampleIdx = (this->nextSampleIdx + 1) % this->samples.size();
+}
+
+void LatencyHistogram::Clear() {
+    std::fill(this->buckets.begin(), this->buckets.end(), 0);
+    this->nextSampleIdx = 0;
+    this->numSamples = 0;
+}
+
+/// <summary> Get the given percentile (in [0, 100]) of the samples in the window. </summary>
+/// <returns> The upper edge of the bucket the percentile falls in, in ms. Zero if there are no samples. </returns>
+double LatencyHistogram::GetPercentileInMs(double percentile) const {
+    assert(percentile >= 0.0 && percentile <= 100.0);
+    if (this->numSamples == 0) {
+        return 0.0;
+    }
+
+    // Number of samples that must be at or below the percentile
+    unsigned int rank = static_cast<unsigned int>(ceil(percentile / 100.0 * this->numSamples));
+    rank = std::max<unsigned int>(rank, 1);
+
+    unsigned int cumulativeCount = 0;
+    for (size_t i = 0; i < this->buckets.size() - 1; i++) {
+        cumulativeCount += this->buckets[i];
+        if (cumulativeCount >= rank) {
+            return (i + 1) * this->bucketSizeInMs;
+        }
+    }
+
+    // The percentile is in the overflow bucket, the largest sample is the best we can do
+    return this->GetMaxInMs();
+}
+
+/// <summary> Get the largest sample in the window. </summary>
+double LatencyHistogram::GetMaxInMs() const {
+    double maxInMs = 0.0;
+    for (size_t i = 0; i < this->numSamples; i++) {
+        maxInMs = std::max<double>(maxInMs, this->samples[i]);
+    }
+    return maxInMs;
+}
+
+/// <summary> Print a one line summary (p50/p95/p99/max) of the samples in the window. </summary>
+void LatencyHistogram::Print(std::ostream& out) const {
+    out << this->name << ": " << this->numSamples << " samples, p50 " << this->GetPercentileInMs(50.0)
+        << " ms, p95 " << this->GetPercentileInMs(95.0) << " ms, p99 " << this->GetPercentileInMs(99.0)
+        << " ms, max " << this->GetMaxInMs() << " ms" << std::endl;
+}
+
+/// <summary>
+/// Write the summary followed by every non-empty bucket of the histogram, one bucket per line as
+/// "<bucket start in ms>, <bucket end in ms>, <count>". The overflow bucket has no end.
+/// </summary>
+void LatencyHistogram::WriteBuckets(std::ostream& out) const {
+    this->Print(out);
+    for (size_t i = 0; i < this->buckets.size(); i++) {
+        if (this->buckets[i] == 0) {
+            continue;
+        }
+
+        out << i * this->bucketSizeInMs << ", ";
+        if (i < this->buckets.size() - 1) {
+            out << (i + 1) * this->bucketSizeInMs;
+        }
+        out << ", " << this->buckets[i] << std::endl;
+    }
+}
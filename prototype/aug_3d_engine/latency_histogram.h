@@ -0,0 +1,61 @@
+#ifndef AUG3DENGINE_LATENCYHISTOGRAM_H_
+#define AUG3DENGINE_LATENCYHISTOGRAM_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Rolling histogram of latencies: only the most recent samples (the window) are counted, older
+/// samples fall out of the histogram as new ones are added. Latencies are counted in fixed size
+/// buckets, anything past the last bucket is counted in an overflow bucket, so percentiles are
+/// accurate to within a bucket.
+/// </summary>
+class LatencyHistogram {
+public:
+    static const size_t DEFAULT_WINDOW_SIZE = 1024;
+    static const size_t DEFAULT_NUM_BUCKETS = 500;
+    static const double DEFAULT_BUCKET_SIZE_IN_MS;
+
+    LatencyHistogram(const std::string& name, size_t windowSize = DEFAULT_WINDOW_SIZE,
+                     size_t numBuckets = DEFAULT_NUM_BUCKETS, double bucketSizeInMs = DEFAULT_BUCKET_SIZE_IN_MS);
+    ~LatencyHistogram();
+
+    void AddSample(double latencyInMs);
+    void Clear();
+
+    const std::string& GetName() const;
+    size_t GetNumSamples() const;
+    double GetPercentileInMs(double percentile) const;
+    double GetMaxInMs() const;
+
+    void Print(std::ostream& out) const;
+    void WriteBuckets(std::ostream& out) const;
+
+private:
+    std::string name;
+    double bucketSizeInMs;
+
+    std::vector<double> samples;        // Ring of the samples in the window
+    size_t nextSampleIdx;               // Where the next sample goes in the ring
+    size_t numSamples;                  // Number of samples in the window
+    std::vector<unsigned int> buckets;  // Counts of the samples in the window, the last bucket is the overflow bucket
+
+    size_t GetBucketIndex(double latencyInMs) const;
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+inline const std::string& LatencyHistogram::GetName() const {
+    return this->name;
+}
+
+inline size_t LatencyHistogram::GetNumSamples() const {
+    return this->numSamples;
+}
+
+inline size_t LatencyHistogram::GetBucketIndex(double latencyInMs) const {
+    size_t bucketIdx = static_cast<size_t>(std::max<double>(latencyInMs, 0.0) / this->bucketSizeInMs);
+    return std::min<size_t>(bucketIdx, this->buckets.size() - 1);
+}
+
+#endif // AUG3DENGINE_LATENCYHISTOGRAM_H_
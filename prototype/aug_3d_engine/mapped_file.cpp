@@ -0,0 +1,97 @@
+// AugEngine Includes
+#include "mapped_file.h"
+
+MappedFile::MappedFile(size_t numViews, size_t viewSize) : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL),
+fileSize(0), viewSize(viewSize), viewAlignment(0), views(numViews) {
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    this->viewAlignment = systemInfo.dwAllocationGranularity;
+}
+
+MappedFile::~MappedFile() {
+    for (size_t i = 0; i < this->views.size(); i++) {
+        this->UnmapView(this->views[i]);
+    }
+    if (this->mappingHandle != NULL) {
+        CloseHandle(this->mappingHandle);
+        this->mappingHandle = NULL;
+    }
+    if (this->fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(this->fileHandle);
+        this->fileHandle = INVALID_HANDLE_VALUE;
+    }
+}
+
+/// <summary> Build a memory mapped file for reading the given (non-empty) file through the given number of views. </summary>
+/// <returns> The new mapped file, NULL if the file could not be opened or mapped. </returns>
+MappedFile* MappedFile::Build(const std::string& filepath, size_t numViews, size_t viewSize) {
+    assert(numViews > 0 && viewSize > 0);
+    std::auto_ptr<MappedFile> newFile(new MappedFile(numViews, viewSize));
+
+    newFile->fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, NULL);
+    if (newFile->fileHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open file " << filepath << std::endl;
+        return NULL;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(newFile->fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        std::cerr << "Failed to get the size of (or empty) file " << filepath << std::endl;
+        return NULL;
+    }
+    newFile->fileSize = static_cast<ULONGLONG>(fileSize.QuadPart);
+
+    newFile->mappingHandle = CreateFileMappingA(newFile->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (newFile->mappingHandle == NULL) {
+        std::cerr << "Failed to map file " << filepath << std::endl;
+        return NULL;
+    }
+
+    return newFile.release();
+}
+
+/// <summary>
+/// Map the given range of the file through the given view, the range stays mapped until the
+/// view is asked for a range outside of its window (or the file is destroyed).
+/// </summary>
+/// <returns> The start of the range in memory, NULL if the range is past the end of the file or can't be mapped. </returns>
+const BYTE* MappedFile::Map(size_t viewIdx, ULONGLONG offset, size_t size) {
+    assert(viewIdx < this->views.size());
+    if (offset > this->fileSize || size > this->fileSize - offset) {
+        return NULL;
+    }
+
+    View& view = this->views[viewIdx];
+    if (view.data != NULL && offset >= view.offset && offset + size <= view.offset + view.size) {
+        return view.data + (offset - view.offset);
+    }
+
+    // Map a whole window from the aligned start of the range, so the ranges that follow are likely mapped already
+    this->UnmapView(view);
+    ULONGLONG viewOffset = offset - (offset % this->viewAlignment);
+    ULONGLONG viewEnd = std::min<ULONGLONG>(std::max<ULONGLONG>(offset + size, viewOffset + this->viewSize), this->fileSize);
+    size_t mappedSize = static_cast<size_t>(viewEnd - viewOffset);
+
+    void* viewData = MapViewOfFile(this->mappingHandle, FILE_MAP_READ, static_cast<DWORD>(viewOffset >> 32),
+                                   static_cast<DWORD>(viewOffset & 0xFFFFFFFF), mappedSize);
+    if (viewData == NULL) {
+        debug_output("Failed to map a view of " << mappedSize << " bytes at " << viewOffset);
+        return NULL;
+    }
+
+    view.data   = static_cast<const BYTE*>(viewData);
+    view.offset = viewOffset;
+    view.size   = mappedSize;
+    return view.data + (offset - view.offset);
+}
+
+void MappedFile::UnmapView(View& view) {
+    if (view.data == NULL) {
+        return;
+    }
+    UnmapViewOfFile(view.data);
+    view.data = NULL;
+    view.offset = 0;
+    view.size = 0;
+}
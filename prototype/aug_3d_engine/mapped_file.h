@@ -0,0 +1,52 @@
+#ifndef AUG3DENGINE_MAPPEDFILE_H_
+#define AUG3DENGINE_MAPPEDFILE_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Read-only memory mapped file. Files can be far larger than the address space (e.g., long
+/// recordings in a 32-bit process), so the file is only mapped through a fixed number of views:
+/// each view maps a window of the file around the last range asked of it and is only remapped
+/// when a range outside of that window is asked for. Ranges are never copied.
+/// </summary>
+class MappedFile {
+public:
+    static const size_t DEFAULT_VIEW_SIZE = 64 * 1024 * 1024;
+
+    static MappedFile* Build(const std::string& filepath, size_t numViews, size_t viewSize = DEFAULT_VIEW_SIZE);
+    ~MappedFile();
+
+    ULONGLONG GetSize() const;
+    const BYTE* Map(size_t viewIdx, ULONGLONG offset, size_t size);
+
+private:
+    // A window of the file that is mapped into memory
+    struct View {
+        View() : data(NULL), offset(0), size(0) {}
+
+        const BYTE* data;   // NULL if nothing is mapped
+        ULONGLONG offset;   // Offset of the window in the file
+        size_t size;        // Number of bytes in the window
+    };
+
+    MappedFile(size_t numViews, size_t viewSize);
+
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    ULONGLONG fileSize;
+
+    size_t viewSize;            // Smallest number of bytes mapped by a view (unless the file is smaller)
+    DWORD viewAlignment;        // Views must start at multiples of the allocation granularity
+    std::vector<View> views;
+
+    void UnmapView(View& view);
+
+    DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+inline ULONGLONG MappedFile::GetSize() const {
+    return this->fileSize;
+}
+
+#endif // AUG3DENGINE_MAPPEDFILE_H_
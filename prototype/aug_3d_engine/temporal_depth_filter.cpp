@@ -0,0 +1,105 @@
+// AugEngine Includes
+#include "temporal_depth_filter.h"
+
+const float TemporalDepthFilter::DEFAULT_SMOOTHING_FACTOR       = 0.3f;
+const float TemporalDepthFilter::DEFAULT_MIN_OUTLIER_DIST_IN_MM = 30.0f;
+const float TemporalDepthFilter::DEFAULT_OUTLIER_DIST_FRACTION  = 0.03f;
+
+// Smallest number of rows filtered by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK = 16;
+
+TemporalDepthFilter::TemporalDepthFilter(int width, int height, ThreadPool* threadPool, size_t historyLength) :
+width(width), height(height), threadPool(threadPool), smoothingFactor(DEFAULT_SMOOTHING_FACTOR),
+minOutlierDistInMm(DEFAULT_MIN_OUTLIER_DIST_IN_MM), outlierDistFraction(DEFAULT_OUTLIER_DIST_FRACTION),
+maxHoleAge(DEFAULT_MAX_HOLE_AGE), minAgreeingFrames(DEFAULT_MIN_AGREEING_FRAMES),
+history(historyLength, std::vector<USHORT>(width*height, 0)), currHistoryIdx(0), numHistoryFrames(0),
+smoothedDepthInMm(width*height, 0.0f), holeAge(width*height, 0), filterRowsTask(*this) {
+    assert(width > 0 && height > 0);
+    assert(threadPool != NULL);
+    assert(historyLength > DEFAULT_MIN_AGREEING_FRAMES);
+}
+
+TemporalDepthFilter::~TemporalDepthFilter() {
+}
+
+/// <summary> Forget all previous frames, the next frame passes through the filter unchanged. </summary>
+void TemporalDepthFilter::Reset() {
+    std::fill(this->smoothedDepthInMm.begin(), this->smoothedDepthInMm.end(), 0.0f);
+    std::fill(this->holeAge.begin(), this->holeAge.end(), 0);
+    this->numHistoryFrames = 0;
+}
+
+/// <summary> Filter the given depth image (which must be the size of the filter) in place. </summary>
+void TemporalDepthFilter::Apply(USHORT* depthInMm) {
+    assert(depthInMm != NULL);
+
+    this->currHistoryIdx = (this->currHistoryIdx + 1) % this->history.size();
+    this->numHistoryFrames = std::min<size_t>(this->numHistoryFrames + 1, this->history.size());
+
+    this->filterRowsTask.depthInMm = depthInMm;
+    this->threadPool->ParallelFor(this->filterRowsTask, this->height, MIN_ROWS_PER_CHUNK);
+}
+
+/// <summary>
+/// Check whether enough of the previous (unfiltered) frames have a depth close to the given
+/// depth at the given pixel, i.e., whether a jump to the given depth has been seen before.
+/// </summary>
+bool TemporalDepthFilter::HistoryAgreesWith(size_t pixelIdx, USHORT depthInMm) const {
+    float outlierDistInMm = this->GetOutlierDist(depthInMm);
+    size_t numAgreeingFrames = 0;
+
+    size_t historyIdx = this->currHistoryIdx;
+    for (size_t i = 1; i < this->numHistoryFrames; i++) {
+        historyIdx = (historyIdx + this->history.size() - 1) % this->history.size();
+        float prevDepthInMm = this->history[historyIdx][pixelIdx];
+        if (fabs(prevDepthInMm - depthInMm) <= outlierDistInMm) {
+            numAgreeingFrames++;
+            if (numAgreeingFrames >= this->minAgreeingFrames) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void TemporalDepthFilter::FilterRowsTask::Run(size_t beginRow, size_t endRow) {
+    TemporalDepthFilter& filter = this->filter;
+    USHORT* currHistory = &filter.history[filter.currHistoryIdx][0];
+
+    size_t endIdx = endRow * filter.width;
+    for (size_t i = beginRow * filter.width; i < endIdx; i++) {
+        USHORT depthInMm = this->depthInMm[i];
+        currHistory[i] = depthInMm;
+        float& smoothedDepthInMm = filter.smoothedDepthInMm[i];
+
+        if (depthInMm == 0) {
+            // Fill the hole with the smoothed depth until the hole has been around for too long
+            if (smoothedDepthInMm > 0.0f && filter.holeAge[i] < filter.maxHoleAge) {
+                filter.holeAge[i]++;
+                this->depthInMm[i] = static_cast<USHORT>(smoothedDepthInMm + 0.5f);
+            }
+            else {
+                smoothedDepthInMm = 0.0f;
+            }
+            continue;
+        }
+        filter.holeAge[i] = 0;
+
+        if (smoothedDepthInMm == 0.0f) {
+            smoothedDepthInMm = depthInMm;
+        }
+        else if (fabs(depthInMm - smoothedDepthInMm) > filter.GetOutlierDist(smoothedDepthInMm)) {
+            if (filter.HistoryAgreesWith(i, depthInMm)) {
+                // The surface really moved, stop smoothing towards where it was
+                smoothedDepthInMm = depthInMm;
+            }
+            // Otherwise the depth is an outlier and the smoothed depth is kept
+        }
+        else {
+            smoothedDepthInMm += filter.smoothingFactor * (depthInMm - smoothedDepthInMm);
+        }
+
+        this->depthInMm[i] = static_cast<USHORT>(smoothedDepthInMm + 0.5f);
+    }
+}
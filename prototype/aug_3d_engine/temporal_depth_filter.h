@@ -0,0 +1,101 @@
+#ifndef AUG3DENGINE_TEMPORALDEPTHFILTER_H_
+#define AUG3DENGINE_TEMPORALDEPTHFILTER_H_
+
+// AugEngine Includes
+#include "common.h"
+#include "thread_pool.h"
+
+/// <summary>
+/// Filters kinect depth images (16-bit, in mm) over time to get rid of the flicker and holes:
+///  - Every pixel is exponentially smoothed towards the depths that come in.
+///  - Depths that jump away from the smoothed depth are rejected as outliers, unless the last few
+///    frames (kept in a ring buffer) agree with the jump, in which case the surface really moved
+///    and the pixel snaps to the new depth.
+///  - Holes (zero depth) are filled with the smoothed depth for a limited number of frames.
+/// The image is split into rows that are filtered in parallel on a thread pool.
+/// </summary>
+class TemporalDepthFilter {
+public:
+    static const size_t DEFAULT_HISTORY_LENGTH = 4;
+    static const float DEFAULT_SMOOTHING_FACTOR;
+    static const float DEFAULT_MIN_OUTLIER_DIST_IN_MM;
+    static const float DEFAULT_OUTLIER_DIST_FRACTION;
+    static const unsigned int DEFAULT_MAX_HOLE_AGE = 5;
+    static const size_t DEFAULT_MIN_AGREEING_FRAMES = 1;
+
+    TemporalDepthFilter(int width, int height, ThreadPool* threadPool, size_t historyLength = DEFAULT_HISTORY_LENGTH);
+    ~TemporalDepthFilter();
+
+    void SetSmoothingFactor(float smoothingFactor);
+    void SetOutlierDistance(float minOutlierDistInMm, float outlierDistFraction);
+    void SetMaxHoleAge(unsigned int maxHoleAge);
+    void SetMinAgreeingFrames(size_t minAgreeingFrames);
+
+    void Reset();
+    void Apply(USHORT* depthInMm);
+
+private:
+    // Filters a range of rows of the current frame
+    class FilterRowsTask : public ParallelTask {
+    public:
+        FilterRowsTask(TemporalDepthFilter& filter) : filter(filter), depthInMm(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        TemporalDepthFilter& filter;
+        USHORT* depthInMm;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(FilterRowsTask);
+    };
+
+    int width, height;
+    ThreadPool* threadPool; // Not owned by this
+
+    float smoothingFactor;      // How far (in [0,1]) the smoothed depth moves towards each new depth
+    float minOutlierDistInMm;   // Smallest jump in depth that is considered an outlier
+    float outlierDistFraction;  // Jump in depth (as a fraction of the depth) that is considered an outlier
+    unsigned int maxHoleAge;    // Number of frames that holes are filled with the smoothed depth
+    size_t minAgreeingFrames;   // Number of previous frames that must agree with a jump in depth for it not to be an outlier
+
+    std::vector<std::vector<USHORT> > history;  // Ring of the most recent unfiltered frames
+    size_t currHistoryIdx;                      // Index of the current frame in the history ring
+    size_t numHistoryFrames;                    // Number of frames in the history ring
+
+    std::vector<float> smoothedDepthInMm;       // Per pixel smoothed depth, zero if there is none
+    std::vector<BYTE> holeAge;                  // Per pixel number of frames the pixel has been a hole
+
+    FilterRowsTask filterRowsTask;
+
+    float GetOutlierDist(float depthInMm) const;
+    bool HistoryAgreesWith(size_t pixelIdx, USHORT depthInMm) const;
+
+    DISALLOW_COPY_AND_ASSIGN(TemporalDepthFilter);
+};
+
+inline void TemporalDepthFilter::SetSmoothingFactor(float smoothingFactor) {
+    assert(smoothingFactor > 0.0f && smoothingFactor <= 1.0f);
+    this->smoothingFactor = smoothingFactor;
+}
+
+inline void TemporalDepthFilter::SetOutlierDistance(float minOutlierDistInMm, float outlierDistFraction) {
+    assert(minOutlierDistInMm >= 0.0f && outlierDistFraction >= 0.0f);
+    this->minOutlierDistInMm  = minOutlierDistInMm;
+    this->outlierDistFraction = outlierDistFraction;
+}
+
+inline void TemporalDepthFilter::SetMaxHoleAge(unsigned int maxHoleAge) {
+    assert(maxHoleAge < UCHAR_MAX);
+    this->maxHoleAge = maxHoleAge;
+}
+
+inline void TemporalDepthFilter::SetMinAgreeingFrames(size_t minAgreeingFrames) {
+    assert(minAgreeingFrames > 0 && minAgreeingFrames < this->history.size());
+    this->minAgreeingFrames = minAgreeingFrames;
+}
+
+/// <summary> Get the distance a depth has to jump by to be an outlier (noise grows with depth). </summary>
+inline float TemporalDepthFilter::GetOutlierDist(float depthInMm) const {
+    return std::max<float>(this->minOutlierDistInMm, this->outlierDistFraction * depthInMm);
+}
+
+#endif // AUG3DENGINE_TEMPORALDEPTHFILTER_H_
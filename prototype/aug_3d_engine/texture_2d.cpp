@@ -1,27 +1,245 @@
 
 // AugEngine Includes
 #include "texture_2d.h"
+#include "high_res_timer.h"
 
 using namespace augengine;
 
 // Default constructor for 2D textures
-Texture2D::Texture2D(TextureFilterType texFilter) : Texture(texFilter, GL_TEXTURE_2D) {
+Texture2D::Texture2D(TextureFilterType texFilter) : Texture(texFilter, GL_TEXTURE_2D), currPixelBufferIdx(0) {
 }
 
 Texture2D::~Texture2D() {
+    this->StopStreaming();
 }
 
+/// <summary>
+/// Replace the whole image of this texture with the given buffer (which must match the texture's
+/// dimensions). The texture's storage is kept, only its contents are updated. When streaming, the
+/// buffer is copied into the next pixel buffer object and the driver copies it into the texture
+/// asynchronously, otherwise the upload happens synchronously.
+/// </summary>
 void Texture2D::SetBuffer(const GLenum& format, const GLenum& type, const GLvoid* buffer) {
+    double startTimeInMs = GetHighResTimeInMs();
+
     this->BindTexture();
-    glTexImage2D(this->textureType, 0, this->internalFormat, this->width, this->height,
-                 0, format, type, buffer);
+    if (this->IsStreaming()) {
+        this->StreamBuffer(format, type, buffer);
+    }
+    else {
+        glTexSubImage2D(this->textureType, 0, 0, 0, this->width, this->height, format, type, buffer);
+    }
     if (this->IsMipmappedFilter(this->texFilter)) {
         this->GenerateMipmaps();
     }
     this->UnbindTexture();
+
+    this->AddUploadSample(GetHighResTimeInMs() - startTimeInMs, this->width * this->height);
+    augengine::debug_opengl_state();
+}
+
+/// <summary>
+/// Replace the given rectangles of this texture's image with the same rectangles of the given
+/// buffer (which holds a whole image matching the texture's dimensions), the rest of the texture
+/// is left as it is. This is for images where only parts change from one upload to the next, see
+/// SetBuffer for how the rectangles are uploaded.
+/// </summary>
+void Texture2D::SetSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer,
+                              const std::vector<SubRect>& rects) {
+    double startTimeInMs = GetHighResTimeInMs();
+
+    // The rectangles are picked out of the whole image's rows
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, this->width);
+
+    this->BindTexture();
+    if (this->IsStreaming()) {
+        this->StreamSubBuffers(format, type, buffer, rects);
+    }
+    else {
+        this->UploadSubBuffers(format, type, buffer, rects);
+    }
+    if (!rects.empty() && this->IsMipmappedFilter(this->texFilter)) {
+        this->GenerateMipmaps();
+    }
+    this->UnbindTexture();
+    glPopClientAttrib();
+
+    size_t numTexelsUploaded = 0;
+    for (size_t i = 0; i < rects.size(); i++) {
+        numTexelsUploaded += rects[i].width * rects[i].height;
+    }
+    this->AddUploadSample(GetHighResTimeInMs() - startTimeInMs, numTexelsUploaded);
     augengine::debug_opengl_state();
 }
 
+void Texture2D::AddUploadSample(double stallTimeInMs, size_t numTexelsUploaded) {
+    this->uploadStats.numUploads++;
+    this->uploadStats.totalStallTimeInMs += stallTimeInMs;
+    this->uploadStats.maxStallTimeInMs = std::max<double>(this->uploadStats.maxStallTimeInMs, stallTimeInMs);
+    this->uploadStats.numTexelsUploaded += numTexelsUploaded;
+    this->uploadStats.numTexelsReplaced += this->width * this->height;
+}
+
+/// <summary>
+/// Start streaming the uploads of this texture through a ring of pixel buffer objects, so that the
+/// CPU can fill the next buffer while the driver is still copying the previous one into the texture.
+/// </summary>
+/// <returns> true on success, false if pixel buffer objects aren't supported. </returns>
+bool Texture2D::StartStreaming(int numPixelBuffers) {
+    assert(numPixelBuffers > 0);
+    if (!GLEW_VERSION_2_1 && !GLEW_ARB_pixel_buffer_object) {
+        return false;
+    }
+
+    this->StopStreaming();
+    this->pixelBuffers.resize(numPixelBuffers, 0);
+    glGenBuffers(numPixelBuffers, &this->pixelBuffers[0]);
+    this->currPixelBufferIdx = 0;
+
+    debug_opengl_state();
+    return true;
+}
+
+void Texture2D::StopStreaming() {
+    if (this->pixelBuffers.empty()) {
+        return;
+    }
+
+    glDeleteBuffers(static_cast<GLsizei>(this->pixelBuffers.size()), &this->pixelBuffers[0]);
+    this->pixelBuffers.clear();
+    this->currPixelBufferIdx = 0;
+}
+
+/// <summary> Upload the given buffer to the (bound) texture through the next pixel buffer object. </summary>
+void Texture2D::StreamBuffer(const GLenum& format, const GLenum& type, const GLvoid* buffer) {
+    size_t bufferSize = this->width * this->height * Texture2D::GetBytesPerPixel(format, type);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffers[this->currPixelBufferIdx]);
+    this->currPixelBufferIdx = (this->currPixelBufferIdx + 1) % this->pixelBuffers.size();
+
+    // Orphan the buffer's previous storage so that mapping it doesn't wait on the copy
+    // the driver may still be doing out of it
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+    GLvoid* pixelBufferData = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (pixelBufferData != NULL) {
+        memcpy(pixelBufferData, buffer, bufferSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // With a pixel unpack buffer bound the data pointer is an offset into that buffer
+        glTexSubImage2D(this->textureType, 0, 0, 0, this->width, this->height, format, type, BUFFER_OFFSET(0));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else {
+        debug_output("Failed to map pixel buffer, uploading the texture synchronously.");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(this->textureType, 0, 0, 0, this->width, this->height, format, type, buffer);
+    }
+}
+
+/// <summary>
+/// Upload the given rectangles of the given whole-image buffer to the (bound) texture through the
+/// next pixel buffer object, only the rectangles are copied into it (at their offsets in the image).
+/// </summary>
+void Texture2D::StreamSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer,
+                                 const std::vector<SubRect>& rects) {
+    if (rects.empty()) {
+        return;
+    }
+    size_t bytesPerPixel = Texture2D::GetBytesPerPixel(format, type);
+    size_t rowSize = this->width * bytesPerPixel;
+    size_t bufferSize = this->height * rowSize;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffers[this->currPixelBufferIdx]);
+    this->currPixelBufferIdx = (this->currPixelBufferIdx + 1) % this->pixelBuffers.size();
+
+    // Orphaned like in StreamBuffer, the parts of the new storage outside of the rectangles are never read
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+    BYTE* pixelBufferData = static_cast<BYTE*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
+    if (pixelBufferData == NULL) {
+        debug_output("Failed to map pixel buffer, uploading the texture synchronously.");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        this->UploadSubBuffers(format, type, buffer, rects);
+        return;
+    }
+
+    const BYTE* bufferBytes = static_cast<const BYTE*>(buffer);
+    for (size_t i = 0; i < rects.size(); i++) {
+        const SubRect& rect = rects[i];
+        size_t rectRowSize = rect.width * bytesPerPixel;
+        for (int y = rect.y; y < rect.y + rect.height; y++) {
+            size_t offset = y * rowSize + rect.x * bytesPerPixel;
+            memcpy(pixelBufferData + offset, bufferBytes + offset, rectRowSize);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With a pixel unpack buffer bound the data pointer is an offset into that buffer
+    for (size_t i = 0; i < rects.size(); i++) {
+        const SubRect& rect = rects[i];
+        size_t offset = rect.y * rowSize + rect.x * bytesPerPixel;
+        glTexSubImage2D(this->textureType, 0, rect.x, rect.y, rect.width, rect.height, format, type, BUFFER_OFFSET(offset));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/// <summary> Upload the given rectangles of the given whole-image buffer to the (bound) texture synchronously. </summary>
+void Texture2D::UploadSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer,
+                                 const std::vector<SubRect>& rects) {
+    size_t bytesPerPixel = Texture2D::GetBytesPerPixel(format, type);
+    const BYTE* bufferBytes = static_cast<const BYTE*>(buffer);
+    for (size_t i = 0; i < rects.size(); i++) {
+        const SubRect& rect = rects[i];
+        size_t offset = (rect.y * this->width + rect.x) * bytesPerPixel;
+        glTexSubImage2D(this->textureType, 0, rect.x, rect.y, rect.width, rect.height, format, type, bufferBytes + offset);
+    }
+}
+
+size_t Texture2D::GetBytesPerPixel(const GLenum& format, const GLenum& type) {
+    size_t numComponents = 0;
+    switch (format) {
+        case GL_RED:
+        case GL_GREEN:
+        case GL_BLUE:
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+        case GL_DEPTH_COMPONENT:
+            numComponents = 1;
+            break;
+        case GL_LUMINANCE_ALPHA:
+            numComponents = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+            numComponents = 3;
+            break;
+        case GL_RGBA:
+        case GL_BGRA:
+            numComponents = 4;
+            break;
+        default:
+            assert(false);
+            break;
+    }
+
+    switch (type) {
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:
+            return numComponents;
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+            return 2 * numComponents;
+        case GL_UNSIGNED_INT:
+        case GL_INT:
+        case GL_FLOAT:
+            return 4 * numComponents;
+        default:
+            assert(false);
+            return 0;
+    }
+}
+
 Texture2D* Texture2D::CreateEmptyTexture(int width, int height, 
                                          Texture::TextureFilterType filter,
                                          GLint internalFormat) {
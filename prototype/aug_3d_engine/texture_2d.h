@@ -10,11 +10,43 @@
 // Wraps a OpenGL 2D texture, takes care of texture ID and stuff like that
 class Texture2D : public Texture {
 public:
+    // CPU time spent blocked in the calls that upload the texture's buffer (see SetBuffer)
+    struct UploadStats {
+        UploadStats() : numUploads(0), totalStallTimeInMs(0.0), maxStallTimeInMs(0.0),
+            numTexelsUploaded(0), numTexelsReplaced(0) {}
+        double GetAverageStallTimeInMs() const;
+        double GetUploadedFraction() const;
+
+        unsigned int numUploads;
+        double totalStallTimeInMs;
+        double maxStallTimeInMs;
+        ULONGLONG numTexelsUploaded;    // Texels actually uploaded
+        ULONGLONG numTexelsReplaced;    // Texels of the whole texture, for every upload
+    };
+
+    // Part of the texture's image that is uploaded on its own (see SetSubBuffers)
+    struct SubRect {
+        SubRect(int x, int y, int width, int height) : x(x), y(y), width(width), height(height) {}
+        int x, y;
+        int width, height;
+    };
+
+    static const int DEFAULT_NUM_STREAMING_BUFFERS = 2;
+
 	virtual ~Texture2D();
 	
 	void RenderToFullscreenQuad() const;
     void RenderToSubscreenQuad(int x, int y, int width, int height) const;
     void SetBuffer(const GLenum& format, const GLenum& type, const GLvoid* buffer);
+    void SetSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer, const std::vector<SubRect>& rects);
+
+    // Streaming uploads through a ring of pixel buffer objects (for textures that are replaced every frame)
+    bool StartStreaming(int numPixelBuffers = DEFAULT_NUM_STREAMING_BUFFERS);
+    void StopStreaming();
+    bool IsStreaming() const;
+
+    const UploadStats& GetUploadStats() const;
+    void ResetUploadStats();
 
     void SetWrapMode(GLint sWrapMode, GLint tWrapMode);
 
@@ -25,9 +57,46 @@ public:
 
 private:
 	Texture2D(TextureFilterType texFilter);
+
+    std::vector<GLuint> pixelBuffers;   // Ring of pixel unpack buffers used when streaming
+    size_t currPixelBufferIdx;          // Index of the pixel buffer used for the next upload
+    UploadStats uploadStats;
+
+    void StreamBuffer(const GLenum& format, const GLenum& type, const GLvoid* buffer);
+    void StreamSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer, const std::vector<SubRect>& rects);
+    void UploadSubBuffers(const GLenum& format, const GLenum& type, const GLvoid* buffer, const std::vector<SubRect>& rects);
+    void AddUploadSample(double stallTimeInMs, size_t numTexelsUploaded);
+    static size_t GetBytesPerPixel(const GLenum& format, const GLenum& type);
+
     DISALLOW_COPY_AND_ASSIGN(Texture2D);
 };
 
+inline double Texture2D::UploadStats::GetAverageStallTimeInMs() const {
+    if (this->numUploads == 0) {
+        return 0.0;
+    }
+    return this->totalStallTimeInMs / this->numUploads;
+}
+
+inline double Texture2D::UploadStats::GetUploadedFraction() const {
+    if (this->numTexelsReplaced == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(this->numTexelsUploaded) / static_cast<double>(this->numTexelsReplaced);
+}
+
+inline bool Texture2D::IsStreaming() const {
+    return !this->pixelBuffers.empty();
+}
+
+inline const Texture2D::UploadStats& Texture2D::GetUploadStats() const {
+    return this->uploadStats;
+}
+
+inline void Texture2D::ResetUploadStats() {
+    this->uploadStats = UploadStats();
+}
+
 inline void Texture2D::RenderToFullscreenQuad() const {
 	this->BindTexture();
     CommonGeometryHelper::GetInstance()->DrawFullscreenQuad();
@@ -0,0 +1,133 @@
+// AugEngine Includes
+#include "thread_pool.h"
+
+// C Runtime Includes
+#include <process.h>
+
+ThreadPool::ThreadPool() : workSemaphore(NULL), workDoneEvent(NULL), stopWorkers(0),
+currTask(NULL), currNumItems(0), currItemsPerChunk(0), currNumChunks(0), nextChunkIdx(0), numBusyWorkers(0) {
+    InitializeCriticalSection(&this->parallelForLock);
+}
+
+ThreadPool::~ThreadPool() {
+    // Wake up all the workers and wait for them to see that they need to stop
+    InterlockedExchange(&this->stopWorkers, 1);
+    if (!this->workerThreads.empty()) {
+        ReleaseSemaphore(this->workSemaphore, static_cast<LONG>(this->workerThreads.size()), NULL);
+        WaitForMultipleObjects(static_cast<DWORD>(this->workerThreads.size()), &this->workerThreads[0], TRUE, INFINITE);
+    }
+    for (size_t i = 0; i < this->workerThreads.size(); i++) {
+        CloseHandle(this->workerThreads[i]);
+    }
+    this->workerThreads.clear();
+
+    if (this->workSemaphore != NULL) {
+        CloseHandle(this->workSemaphore);
+        this->workSemaphore = NULL;
+    }
+    if (this->workDoneEvent != NULL) {
+        CloseHandle(this->workDoneEvent);
+        this->workDoneEvent = NULL;
+    }
+
+    DeleteCriticalSection(&this->parallelForLock);
+}
+
+/// <summary> Build a thread pool with one worker thread per processor, besides the calling thread. </summary>
+ThreadPool* ThreadPool::Build() {
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return ThreadPool::Build(std::max<size_t>(systemInfo.dwNumberOfProcessors, 1) - 1);
+}
+
+/// <summary> Build a thread pool with the given number of worker threads (zero runs everything on the calling thread). </summary>
+/// <returns> The new thread pool, NULL on failure. </returns>
+ThreadPool* ThreadPool::Build(size_t numWorkerThreads) {
+    std::auto_ptr<ThreadPool> newPool(new ThreadPool());
+
+    newPool->workSemaphore = CreateSemaphore(NULL, 0, std::max<LONG>(static_cast<LONG>(numWorkerThreads), 1), NULL);
+    newPool->workDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (newPool->workSemaphore == NULL || newPool->workDoneEvent == NULL) {
+        std::cerr << "Failed to create the thread pool's synchronization objects." << std::endl;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < numWorkerThreads; i++) {
+        HANDLE workerThread = reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, &ThreadPool::WorkerThreadMain,
+                                                                      newPool.get(), 0, NULL));
+        if (workerThread == NULL) {
+            std::cerr << "Failed to start thread pool worker thread." << std::endl;
+            return NULL;
+        }
+        newPool->workerThreads.push_back(workerThread);
+    }
+
+    return newPool.release();
+}
+
+/// <summary>
+/// Run the given task over the given number of items, split into chunks of at least the given
+/// number of items that are spread over all the threads. Returns once the whole task is done.
+/// </summary>
+void ThreadPool::ParallelFor(ParallelTask& task, size_t numItems, size_t minItemsPerChunk) {
+    if (numItems == 0) {
+        return;
+    }
+    minItemsPerChunk = std::max<size_t>(minItemsPerChunk, 1);
+
+    size_t numChunks = std::min<size_t>(this->GetNumThreads() * CHUNKS_PER_THREAD, numItems / minItemsPerChunk);
+    if (this->workerThreads.empty() || numChunks <= 1) {
+        task.Run(0, numItems);
+        return;
+    }
+
+    EnterCriticalSection(&this->parallelForLock);
+
+    this->currTask          = &task;
+    this->currNumItems      = numItems;
+    this->currItemsPerChunk = (numItems + numChunks - 1) / numChunks;
+    this->currNumChunks     = static_cast<LONG>((numItems + this->currItemsPerChunk - 1) / this->currItemsPerChunk);
+    this->nextChunkIdx      = 0;
+    this->numBusyWorkers    = static_cast<LONG>(this->workerThreads.size());
+
+    // The semaphore release publishes the task to the workers
+    ReleaseSemaphore(this->workSemaphore, static_cast<LONG>(this->workerThreads.size()), NULL);
+    this->RunChunks();
+    WaitForSingleObject(this->workDoneEvent, INFINITE);
+
+    this->currTask = NULL;
+    LeaveCriticalSection(&this->parallelForLock);
+}
+
+unsigned int __stdcall ThreadPool::WorkerThreadMain(void* threadPool) {
+    static_cast<ThreadPool*>(threadPool)->RunWorker();
+    return 0;
+}
+
+void ThreadPool::RunWorker() {
+    for (;;) {
+        WaitForSingleObject(this->workSemaphore, INFINITE);
+        if (this->stopWorkers != 0) {
+            break;
+        }
+
+        this->RunChunks();
+        if (InterlockedDecrement(&this->numBusyWorkers) == 0) {
+            SetEvent(this->workDoneEvent);
+        }
+    }
+}
+
+/// <summary> Keep taking chunks of the current task and running them until there are none left. </summary>
+void ThreadPool::RunChunks() {
+    for (;;) {
+        LONG chunkIdx = InterlockedIncrement(&this->nextChunkIdx) - 1;
+        if (chunkIdx >= this->currNumChunks) {
+            break;
+        }
+
+        size_t beginIdx = chunkIdx * this->currItemsPerChunk;
+        size_t endIdx   = std::min<size_t>(beginIdx + this->currItemsPerChunk, this->currNumItems);
+        this->currTask->Run(beginIdx, endIdx);
+    }
+}
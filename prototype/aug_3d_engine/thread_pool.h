@@ -0,0 +1,63 @@
+#ifndef AUG3DENGINE_THREADPOOL_H_
+#define AUG3DENGINE_THREADPOOL_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// A piece of work that can be split into independent ranges of items and run in parallel
+/// by a ThreadPool. Run may be called from several threads at once (with different ranges).
+/// </summary>
+class ParallelTask {
+public:
+    virtual ~ParallelTask() {}
+    virtual void Run(size_t beginIdx, size_t endIdx) = 0;
+};
+
+/// <summary>
+/// Fixed set of worker threads for running ParallelTasks. The thread calling ParallelFor works
+/// on the task as well and only returns once all of the task is done. Calls to ParallelFor from
+/// different threads are serialized.
+/// </summary>
+class ThreadPool {
+public:
+    static ThreadPool* Build(size_t numWorkerThreads);
+    static ThreadPool* Build();
+    ~ThreadPool();
+
+    size_t GetNumThreads() const;
+    void ParallelFor(ParallelTask& task, size_t numItems, size_t minItemsPerChunk);
+
+private:
+    // Number of chunks the items are split into per thread, more chunks balance the load better
+    static const size_t CHUNKS_PER_THREAD = 4;
+
+    ThreadPool();
+
+    std::vector<HANDLE> workerThreads;
+    HANDLE workSemaphore;   // Released once per worker for every task
+    HANDLE workDoneEvent;   // Signalled by the last worker to finish a task
+    volatile LONG stopWorkers;
+    CRITICAL_SECTION parallelForLock;
+
+    // The task currently being run
+    ParallelTask* currTask;
+    size_t currNumItems;
+    size_t currItemsPerChunk;
+    LONG currNumChunks;
+    volatile LONG nextChunkIdx;
+    volatile LONG numBusyWorkers;
+
+    static unsigned int __stdcall WorkerThreadMain(void* threadPool);
+    void RunWorker();
+    void RunChunks();
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+/// <summary> Get the number of threads that work on tasks, including the thread calling ParallelFor. </summary>
+inline size_t ThreadPool::GetNumThreads() const {
+    return this->workerThreads.size() + 1;
+}
+
+#endif // AUG3DENGINE_THREADPOOL_H_
@@ -0,0 +1,94 @@
+#ifndef AUG3DENGINE_TRIPLEBUFFER_H_
+#define AUG3DENGINE_TRIPLEBUFFER_H_
+
+// AugEngine Includes
+#include "common.h"
+
+/// <summary>
+/// Wait-free single-producer/single-consumer triple buffer. The producer always owns a
+/// write buffer and the consumer always owns a read buffer, the third (middle) buffer holds
+/// the most recently published data and is swapped atomically by either side, so neither
+/// side ever blocks and the consumer always gets the newest complete buffer.
+/// </summary>
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer();
+
+    // Direct access to all the buffers, ONLY for initializing them before the producer/consumer start
+    T& GetBuffer(size_t idx);
+
+    // Producer methods
+    T& GetWriteBuffer();
+    const T& GetLastPublishedBuffer() const;
+    void Publish();
+
+    // Consumer methods
+    bool Acquire();
+    const T& GetReadBuffer() const;
+
+private:
+    static const LONG INDEX_MASK    = 0x3;
+    static const LONG NEW_DATA_FLAG = 0x4;
+
+    T buffers[3];
+
+    int writeIdx;           // Index of the buffer owned by the producer
+    int lastPublishedIdx;   // Index of the buffer the producer last published (it may now be owned by the consumer)
+    int readIdx;            // Index of the buffer owned by the consumer
+    volatile LONG middleState; // Index of the middle buffer, OR'd with NEW_DATA_FLAG if it hasn't been acquired yet
+
+    DISALLOW_COPY_AND_ASSIGN(TripleBuffer);
+};
+
+template <typename T>
+inline TripleBuffer<T>::TripleBuffer() : writeIdx(0), lastPublishedIdx(1), readIdx(2), middleState(1) {
+}
+
+template <typename T>
+inline T& TripleBuffer<T>::GetBuffer(size_t idx) {
+    assert(idx < 3);
+    return this->buffers[idx];
+}
+
+template <typename T>
+inline T& TripleBuffer<T>::GetWriteBuffer() {
+    return this->buffers[this->writeIdx];
+}
+
+/// <summary>
+/// Gets the buffer the producer published last. This buffer is never written to by either side
+/// until the producer gets it back, so the producer can safely read it (e.g., to carry data forward).
+/// </summary>
+template <typename T>
+inline const T& TripleBuffer<T>::GetLastPublishedBuffer() const {
+    return this->buffers[this->lastPublishedIdx];
+}
+
+/// <summary> Publish the write buffer to the consumer and take the middle buffer as the new write buffer. </summary>
+template <typename T>
+inline void TripleBuffer<T>::Publish() {
+    LONG prevMiddleState = InterlockedExchange(&this->middleState, this->writeIdx | NEW_DATA_FLAG);
+    this->lastPublishedIdx = this->writeIdx;
+    this->writeIdx = prevMiddleState & INDEX_MASK;
+}
+
+/// <summary> Swap the newest published buffer into the read buffer, if there is one. </summary>
+/// <returns> true if the read buffer now holds newly published data, false if it is unchanged. </returns>
+template <typename T>
+inline bool TripleBuffer<T>::Acquire() {
+    if ((this->middleState & NEW_DATA_FLAG) == 0) {
+        return false;
+    }
+
+    LONG prevMiddleState = InterlockedExchange(&this->middleState, this->readIdx);
+    this->readIdx = prevMiddleState & INDEX_MASK;
+    return true;
+}
+
+template <typename T>
+inline const T& TripleBuffer<T>::GetReadBuffer() const {
+    return this->buffers[this->readIdx];
+}
+
+#endif // AUG3DENGINE_TRIPLEBUFFER_H_
@@ -0,0 +1,114 @@
+// Augmented Gallery Includes
+#include <depth_colour_registration.h>
+#include <kinect_frame_source.h>
+
+// Smallest number of rows resampled by a thread at once
+static const size_t MIN_ROWS_PER_CHUNK = 16;
+
+DepthColourRegistration::DepthColourRegistration(int width, int height, ThreadPool* threadPool) :
+width(width), height(height), gridWidth((width + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE),
+gridHeight((height + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE), threadPool(threadPool),
+offsets(gridWidth * gridHeight * NUM_DEPTH_BINS), depthBins(MAX_LOOKUP_DEPTH_IN_MM + 1, 0),
+registerRowsTask(*this) {
+}
+
+DepthColourRegistration::~DepthColourRegistration() {
+}
+
+/// <summary>
+/// Build the registration for the given frame source, sampling its depth to colour mapping
+/// between the given near and far distances. The colour and depth images must be the same size.
+/// </summary>
+/// <returns> The new registration, NULL if the frame source can't map depth pixels to colour pixels. </returns>
+DepthColourRegistration* DepthColourRegistration::Build(const KinectFrameSource& frameSource, float nearDistInMm,
+                                                        float farDistInMm, ThreadPool* threadPool) {
+    assert(nearDistInMm > 0.0f && nearDistInMm < farDistInMm);
+    assert(threadPool != NULL);
+
+    int colourWidth, colourHeight;
+    int depthWidth, depthHeight;
+    frameSource.GetColourResolution(colourWidth, colourHeight);
+    frameSource.GetDepthResolution(depthWidth, depthHeight);
+    if (colourWidth != depthWidth || colourHeight != depthHeight) {
+        std::cerr << "Depth to colour registration requires the colour and depth images to be the same size." << std::endl;
+        return NULL;
+    }
+
+    std::auto_ptr<DepthColourRegistration> newRegistration(
+        new DepthColourRegistration(depthWidth, depthHeight, threadPool));
+
+    // The bins are spaced evenly in inverse depth, holes and anything beyond the far
+    // distance go into the furthest bin
+    float invNearDist = 1.0f / nearDistInMm;
+    float invDistDiff = 1.0f / farDistInMm - invNearDist;
+    for (int depth = 1; depth <= MAX_LOOKUP_DEPTH_IN_MM; depth++) {
+        int bin = static_cast<int>((1.0f / depth - invNearDist) / invDistDiff * NUM_DEPTH_BINS);
+        newRegistration->depthBins[depth] = static_cast<BYTE>(std::max<int>(0, std::min<int>(bin, NUM_DEPTH_BINS - 1)));
+    }
+    newRegistration->depthBins[0] = NUM_DEPTH_BINS - 1;
+
+    // Sample the mapping at the centre of every cell and bin
+    PixelOffset* offset = &newRegistration->offsets[0];
+    for (int gridY = 0; gridY < newRegistration->gridHeight; gridY++) {
+        int depthY = std::min<int>(gridY * GRID_CELL_SIZE + GRID_CELL_SIZE / 2, depthHeight - 1);
+        for (int gridX = 0; gridX < newRegistration->gridWidth; gridX++) {
+            int depthX = std::min<int>(gridX * GRID_CELL_SIZE + GRID_CELL_SIZE / 2, depthWidth - 1);
+            for (int bin = 0; bin < NUM_DEPTH_BINS; bin++, offset++) {
+                float invDepth = invNearDist + (bin + 0.5f) / NUM_DEPTH_BINS * invDistDiff;
+                USHORT depth = static_cast<USHORT>(1.0f / invDepth + 0.5f);
+
+                int colourX, colourY;
+                if (!frameSource.GetColourPixelFromDepthPixel(depthX, depthY, depth, colourX, colourY)) {
+                    return NULL;
+                }
+                offset->x = static_cast<signed char>(std::max<int>(SCHAR_MIN, std::min<int>(colourX - depthX, SCHAR_MAX)));
+                offset->y = static_cast<signed char>(std::max<int>(SCHAR_MIN, std::min<int>(colourY - depthY, SCHAR_MAX)));
+            }
+        }
+    }
+
+    return newRegistration.release();
+}
+
+/// <summary>
+/// Resample the given BGRA colour image into the given BGRA image so that every pixel has the colour
+/// seen by the given depth image's pixel. Pixels that map outside of the colour image are black.
+/// </summary>
+void DepthColourRegistration::Apply(const USHORT* depthInMm, const BYTE* colourBGRA, BYTE* registeredBGRA) {
+    assert(depthInMm != NULL && colourBGRA != NULL && registeredBGRA != NULL);
+    assert(colourBGRA != registeredBGRA);
+
+    this->registerRowsTask.depthInMm      = depthInMm;
+    this->registerRowsTask.colourBGRA     = colourBGRA;
+    this->registerRowsTask.registeredBGRA = registeredBGRA;
+    this->threadPool->ParallelFor(this->registerRowsTask, this->height, MIN_ROWS_PER_CHUNK);
+}
+
+void DepthColourRegistration::RegisterRowsTask::Run(size_t beginRow, size_t endRow) {
+    const DepthColourRegistration& registration = this->registration;
+    const int width  = registration.width;
+    const int height = registration.height;
+
+    // Whole pixels are copied at once
+    const DWORD* colour = reinterpret_cast<const DWORD*>(this->colourBGRA);
+    DWORD* registered   = reinterpret_cast<DWORD*>(this->registeredBGRA);
+
+    for (int y = static_cast<int>(beginRow); y < static_cast<int>(endRow); y++) {
+        const PixelOffset* cellOffsets = &registration.offsets[(y / GRID_CELL_SIZE) * registration.gridWidth * NUM_DEPTH_BINS];
+        size_t rowIdx = y * width;
+
+        for (int x = 0; x < width; x++) {
+            int depth = std::min<int>(this->depthInMm[rowIdx + x], MAX_LOOKUP_DEPTH_IN_MM);
+            const PixelOffset& offset = cellOffsets[(x / GRID_CELL_SIZE) * NUM_DEPTH_BINS + registration.depthBins[depth]];
+
+            int colourX = x + offset.x;
+            int colourY = y + offset.y;
+            if (colourX < 0 || colourX >= width || colourY < 0 || colourY >= height) {
+                registered[rowIdx + x] = 0;
+            }
+            else {
+                registered[rowIdx + x] = colour[colourY * width + colourX];
+            }
+        }
+    }
+}
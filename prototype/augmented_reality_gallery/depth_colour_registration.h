@@ -0,0 +1,75 @@
+#ifndef DEPTH_COLOUR_REGISTRATION_H_
+#define DEPTH_COLOUR_REGISTRATION_H_
+
+// AugEngine Includes
+#include <common.h>
+#include <aug_3d_engine/thread_pool.h>
+
+class KinectFrameSource;
+
+/// <summary>
+/// Precomputed mapping from depth pixels to colour pixels, used to resample the colour image
+/// so that it lines up with the depth image (the two cameras are side by side, so the mapping
+/// shifts with depth). The mapping is sampled from the frame source once, on a grid of cells
+/// and at a number of depths spaced evenly in inverse depth (the shift is linear in inverse
+/// depth), and is stored as small pixel offsets. Resampling a frame is then just a lookup and
+/// a copy per pixel.
+/// </summary>
+class DepthColourRegistration {
+public:
+    static const int GRID_CELL_SIZE = 4;    // Width and height (in depth pixels) of each cell of the table
+    static const int NUM_DEPTH_BINS = 32;   // Number of depths each cell of the table is sampled at
+
+    static DepthColourRegistration* Build(const KinectFrameSource& frameSource, float nearDistInMm,
+                                          float farDistInMm, ThreadPool* threadPool);
+    ~DepthColourRegistration();
+
+    size_t GetTableSizeInBytes() const;
+
+    void Apply(const USHORT* depthInMm, const BYTE* colourBGRA, BYTE* registeredBGRA);
+
+private:
+    // Largest depth (in mm) that has its own entry in the depth to bin lookup
+    static const int MAX_LOOKUP_DEPTH_IN_MM = 4095;
+
+    // Offset from a depth pixel to its colour pixel
+    struct PixelOffset {
+        signed char x, y;
+    };
+
+    // Resamples a range of rows of the colour image
+    class RegisterRowsTask : public ParallelTask {
+    public:
+        RegisterRowsTask(DepthColourRegistration& registration) : registration(registration),
+            depthInMm(NULL), colourBGRA(NULL), registeredBGRA(NULL) {}
+        void Run(size_t beginRow, size_t endRow);
+
+        DepthColourRegistration& registration;
+        const USHORT* depthInMm;
+        const BYTE* colourBGRA;
+        BYTE* registeredBGRA;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(RegisterRowsTask);
+    };
+
+    DepthColourRegistration(int width, int height, ThreadPool* threadPool);
+
+    int width, height;
+    int gridWidth, gridHeight;
+    ThreadPool* threadPool; // Not owned by this
+
+    std::vector<PixelOffset> offsets;   // Offset for every depth bin of every cell, indexed by [cell][bin]
+    std::vector<BYTE> depthBins;        // Depth bin of every depth in [0, MAX_LOOKUP_DEPTH_IN_MM]
+
+    RegisterRowsTask registerRowsTask;
+
+    DISALLOW_COPY_AND_ASSIGN(DepthColourRegistration);
+};
+
+/// <summary> Get the memory used by the mapping, for diagnostics. </summary>
+inline size_t DepthColourRegistration::GetTableSizeInBytes() const {
+    return this->offsets.size() * sizeof(PixelOffset) + this->depthBins.size() * sizeof(BYTE);
+}
+
+#endif // DEPTH_COLOUR_REGISTRATION_H_
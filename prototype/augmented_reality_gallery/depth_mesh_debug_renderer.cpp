@@ -0,0 +1,115 @@
+// Augmented Gallery Includes
+#include <depth_mesh_debug_renderer.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/depth_mesh_generator.h>
+
+static const GLubyte WIREFRAME_COLOUR[4] = { 0, 255, 255, 255 };
+
+DepthMeshDebugRenderer::DepthMeshDebugRenderer() : vertexBuffer(0), indexBuffer(0), vertexBufferSize(0),
+indexBufferSize(0), numIndices(0) {
+}
+
+DepthMeshDebugRenderer::~DepthMeshDebugRenderer() {
+    if (this->vertexBuffer != 0) {
+        glDeleteBuffers(1, &this->vertexBuffer);
+        this->vertexBuffer = 0;
+    }
+    if (this->indexBuffer != 0) {
+        glDeleteBuffers(1, &this->indexBuffer);
+        this->indexBuffer = 0;
+    }
+}
+
+/// <summary> Build the renderer and its (empty) vertex and index buffers. </summary>
+/// <returns> The new renderer, NULL if vertex buffer objects aren't supported. </returns>
+DepthMeshDebugRenderer* DepthMeshDebugRenderer::Build() {
+    if (!GLEW_VERSION_1_5 && !GLEW_ARB_vertex_buffer_object) {
+        std::cerr << "Vertex buffer objects aren't supported, can't draw the depth mesh." << std::endl;
+        return NULL;
+    }
+
+    std::auto_ptr<DepthMeshDebugRenderer> newRenderer(new DepthMeshDebugRenderer());
+    glGenBuffers(1, &newRenderer->vertexBuffer);
+    glGenBuffers(1, &newRenderer->indexBuffer);
+
+    augengine::debug_opengl_state();
+    return newRenderer.release();
+}
+
+/// <summary> Copy the given mesh into the buffers, only growing them if it doesn't fit. </summary>
+void DepthMeshDebugRenderer::Update(const DepthMesh& mesh) {
+    const std::vector<DepthMesh::Vertex>& vertices = mesh.GetVertices();
+    size_t verticesSize = vertices.size() * sizeof(DepthMesh::Vertex);
+    size_t indicesSize  = mesh.GetNumIndices() * sizeof(GLuint);
+    this->numIndices = static_cast<GLsizei>(mesh.GetNumIndices());
+    if (this->numIndices == 0) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+    if (verticesSize > this->vertexBufferSize) {
+        glBufferData(GL_ARRAY_BUFFER, verticesSize, &vertices[0], GL_DYNAMIC_DRAW);
+        this->vertexBufferSize = verticesSize;
+    }
+    else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, verticesSize, &vertices[0]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+    if (indicesSize > this->indexBufferSize) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, mesh.GetIndices(), GL_DYNAMIC_DRAW);
+        this->indexBufferSize = indicesSize;
+    }
+    else {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indicesSize, mesh.GetIndices());
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    augengine::debug_opengl_state();
+}
+
+/// <summary>
+/// Draw the last mesh uploaded as a wireframe over the whole window, projected with the intrinsics
+/// of the depth images it was generated from (so every vertex lands on its depth pixel). This
+/// changes the projection and modelview matrices.
+/// </summary>
+void DepthMeshDebugRenderer::Draw(int depthWidth, int depthHeight, float focalLengthInPixels,
+                                  float nearDistInMm, float farDistInMm) const {
+    if (this->numIndices == 0) {
+        return;
+    }
+
+    // The sensor looks down +z, the view down -z
+    float halfWidth  = 0.5f * depthWidth  * nearDistInMm / focalLengthInPixels;
+    float halfHeight = 0.5f * depthHeight * nearDistInMm / focalLengthInPixels;
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-halfWidth, halfWidth, -halfHeight, halfHeight, nearDistInMm, farDistInMm);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glScalef(1.0f, 1.0f, -1.0f);
+
+    glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    glColor4ubv(WIREFRAME_COLOUR);
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(DepthMesh::Vertex), reinterpret_cast<const GLvoid*>(offsetof(DepthMesh::Vertex, x)));
+
+    glDrawElements(GL_TRIANGLES, this->numIndices, GL_UNSIGNED_INT, NULL);
+
+    glPopClientAttrib();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPopAttrib();
+
+    augengine::debug_opengl_state();
+}
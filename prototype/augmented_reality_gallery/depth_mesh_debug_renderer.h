@@ -0,0 +1,34 @@
+#ifndef DEPTH_MESH_DEBUG_RENDERER_H_
+#define DEPTH_MESH_DEBUG_RENDERER_H_
+
+// AugEngine Includes
+#include <common.h>
+
+class DepthMesh;
+
+/// <summary>
+/// Draws a DepthMesh (see DepthMeshGenerator) as a wireframe seen from the sensor, laid over the
+/// whole window. The mesh is copied into one persistent vertex buffer and one index buffer when it
+/// changes, they only grow (the vertices never do after the first mesh), so drawing never allocates.
+/// </summary>
+class DepthMeshDebugRenderer {
+public:
+    static DepthMeshDebugRenderer* Build();
+    ~DepthMeshDebugRenderer();
+
+    void Update(const DepthMesh& mesh);
+    void Draw(int depthWidth, int depthHeight, float focalLengthInPixels, float nearDistInMm, float farDistInMm) const;
+
+private:
+    DepthMeshDebugRenderer();
+
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    size_t vertexBufferSize;    // In bytes
+    size_t indexBufferSize;     // In bytes
+    GLsizei numIndices;         // Of the last mesh uploaded
+
+    DISALLOW_COPY_AND_ASSIGN(DepthMeshDebugRenderer);
+};
+
+#endif // DEPTH_MESH_DEBUG_RENDERER_H_
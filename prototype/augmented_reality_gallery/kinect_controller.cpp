@@ -1,38 +1,70 @@
 
 // Augemented Gallery Includes
 #include <kinect_controller.h>
+#include <nui_kinect_frame_source.h>
+#include <depth_colour_registration.h>
+#include <skeleton_debug_renderer.h>
+#include <kinect_depth_merger.h>
 
 // AugEngine Includes
 #include <aug_3d_engine/camera.h>
 #include <aug_3d_engine/texture_2d.h>
 #include <aug_3d_engine/cgfx_kinect_colour_to_texture.h>
 #include <aug_3d_engine/cgfx_kinect_depth_to_texture.h>
+#include <aug_3d_engine/high_res_timer.h>
+#include <aug_3d_engine/thread_pool.h>
+#include <aug_3d_engine/temporal_depth_filter.h>
+#include <aug_3d_engine/joint_bilateral_depth_filter.h>
+#include <aug_3d_engine/depth_range_calibrator.h>
+#include <aug_3d_engine/depth_background_model.h>
+#include <aug_3d_engine/depth_mesh_generator.h>
+#include <aug_3d_engine/depth_normal_estimator.h>
 
 // OpenCV Includes
 #include <opencv/cv.h>
 
-static int BUILD_COUNT = 0;
+// C Runtime Includes
+#include <process.h>
 
 static const float MIN_DISTANCE = 801;
 static const float MAX_DISTANCE = 3975;
 static const float DISTANCE_DIFF = MAX_DISTANCE - MIN_DISTANCE;
 
-KinectController::KinectController() : depthStreamHandle(NULL), colourStreamHandle(NULL),
-colourImageFrame(NULL), depthImageFrame(NULL), depthTexture(NULL), colourTexture(NULL),
-depthFBO(NULL), colourFBO(NULL), skeletonFBO(NULL), colourConverter(NULL), depthConverter(NULL),
-nearDistanceInMm(MIN_DISTANCE), farDistanceInMm(MAX_DISTANCE), isCalibrating(false) {
+// Largest change in a depth (in mm) and in a colour component that leaves a tile unchanged, small
+// enough to be lost in the sensor noise
+static const USHORT DIRTY_DEPTH_THRESHOLD_IN_MM = 2;
+static const BYTE DIRTY_COLOUR_THRESHOLD = 4;
+
+// Distance in pixels between the vertices of the generated depth meshes
+static const int MESH_VERTEX_STEP = 2;
+
+// Pyramid level the depth range is calibrated from, coarse enough to be cheap but fine enough to see a hand
+static const int RANGE_CALIBRATION_PYRAMID_LEVEL = 2;
+
+// Longest time the capture thread waits for the frame source before checking whether it should stop
+static const DWORD CAPTURE_WAIT_TIMEOUT_IN_MS = 100;
+
+KinectController::KinectController() : frameSource(NULL), framePairer(NULL), captureThread(NULL), stopCapture(0),
+threadPool(NULL), temporalDepthFilter(NULL), isTemporalDepthFilterEnabled(1), wasTemporalDepthFilterEnabled(false),
+bilateralDepthFilter(NULL), isBilateralDepthFilterEnabled(0), colourRegistration(NULL), isColourRegistrationEnabled(1),
+backgroundModel(NULL), isBackgroundModelEnabled(0), wasBackgroundModelEnabled(false),
+meshGenerator(NULL), isMeshGenerationEnabled(0), normalEstimator(NULL),
+isNormalEstimationEnabled(1), wasNormalEstimationEnabled(true), depthFocalLengthInPixels(0.0f),
+depthTileTracker(NULL), colourTileTracker(NULL),
+depthMerger(NULL), sensorIdx(0), rangeCalibrator(NULL), isRangeCalibrationEnabled(0), wasRangeCalibrationEnabled(false),
+processingTimes("Frame processing"),
+lastColourFrameId(0), lastDepthFrameId(0), lastSkeletonFrameId(0), isColourFrameNext(false), isDepthFrameNext(false),
+frameCaptureTimeInMs(0.0),
+depthTexture(NULL), colourTexture(NULL), normalTexture(NULL), uploadDirtyTilesOnly(true),
+depthFBO(NULL), colourFBO(NULL), skeletonFBO(NULL), skeletonDebugRenderer(NULL), isSkeletonDebugTextureStale(true),
+colourConverter(NULL), depthConverter(NULL),
+nearDistanceInMm(MIN_DISTANCE), farDistanceInMm(MAX_DISTANCE) {
+    memset(&this->skeletonFrame, 0, sizeof(this->skeletonFrame));
 }
 
 KinectController::~KinectController() {
-    // Clean up any allocated frames
-    if (this->colourImageFrame != NULL) {
-        NuiImageStreamReleaseFrame(this->colourStreamHandle, this->colourImageFrame);
-        this->colourImageFrame = NULL;
-    }
-    if (this->depthImageFrame != NULL) {
-        NuiImageStreamReleaseFrame(this->depthStreamHandle, this->depthImageFrame);
-        this->depthImageFrame = NULL;
-    }
+    // The capture thread must be stopped before anything it uses is cleaned up
+    this->StopCaptureThread();
 
     // Clean up textures
     if (this->colourTexture != NULL) {
@@ -43,6 +75,10 @@ KinectController::~KinectController() {
         delete this->depthTexture;
         this->depthTexture = NULL;
     }
+    if (this->normalTexture != NULL) {
+        delete this->normalTexture;
+        this->normalTexture = NULL;
+    }
 
     // Clean up FBOs
     if (this->depthFBO != NULL) {
@@ -57,6 +93,10 @@ KinectController::~KinectController() {
         delete this->skeletonFBO;
         this->skeletonFBO = NULL;
     }
+    if (this->skeletonDebugRenderer != NULL) {
+        delete this->skeletonDebugRenderer;
+        this->skeletonDebugRenderer = NULL;
+    }
 
     // Clean up converter shaders
     if (this->colourConverter != NULL) {
@@ -68,202 +108,630 @@ KinectController::~KinectController() {
         this->depthConverter = NULL;
     }
 
-    // Shutdown the kinect API
-    NuiShutdown();
-}
+    if (this->framePairer != NULL) {
+        delete this->framePairer;
+        this->framePairer = NULL;
+    }
+    if (this->temporalDepthFilter != NULL) {
+        delete this->temporalDepthFilter;
+        this->temporalDepthFilter = NULL;
+    }
+    if (this->bilateralDepthFilter != NULL) {
+        delete this->bilateralDepthFilter;
+        this->bilateralDepthFilter = NULL;
+    }
+    if (this->colourRegistration != NULL) {
+        delete this->colourRegistration;
+        this->colourRegistration = NULL;
+    }
+    if (this->meshGenerator != NULL) {
+        delete this->meshGenerator;
+        this->meshGenerator = NULL;
+    }
+    if (this->normalEstimator != NULL) {
+        delete this->normalEstimator;
+        this->normalEstimator = NULL;
+    }
+    if (this->depthTileTracker != NULL) {
+        delete this->depthTileTracker;
+        this->depthTileTracker = NULL;
+    }
+    if (this->colourTileTracker != NULL) {
+        delete this->colourTileTracker;
+        this->colourTileTracker = NULL;
+    }
+    if (this->backgroundModel != NULL) {
+        delete this->backgroundModel;
+        this->backgroundModel = NULL;
+    }
+    if (this->rangeCalibrator != NULL) {
+        delete this->rangeCalibrator;
+        this->rangeCalibrator = NULL;
+    }
 
-KinectController* KinectController::Build() {
-    // Currently we only allow one controller to ever be built,
-    // code refactoring is required otherwise!
-    if (BUILD_COUNT != 0) {
-        assert(false);
-        return NULL;
+    // Clean up the frame source (this will shutdown the kinect API for live sensors)
+    if (this->frameSource != NULL) {
+        delete this->frameSource;
+        this->frameSource = NULL;
     }
+}
 
-    HRESULT result = -1;
+/// <summary> Build a controller for the live kinect sensor, processing its frames on the given thread pool. </summary>
+KinectController* KinectController::Build(ThreadPool* threadPool) {
+    return KinectController::Build(NuiKinectFrameSource::Build(), threadPool);
+}
 
-    // Attempt to initialize the kinect API
-    result = NuiInitialize(NUI_INITIALIZE_FLAG_USES_COLOR | NUI_INITIALIZE_FLAG_USES_DEPTH | 
-                           NUI_INITIALIZE_FLAG_USES_SKELETON);
-    if (FAILED(result)) {
+/// <summary>
+/// Build a controller that reads its frames from the given source, takes ownership of
+/// the source (it is deleted if the controller can't be built). When there are several
+/// sensors, each gets its own controller (and capture thread) and they all share a depth
+/// merger, the depth of every sensor is then merged into the reference sensor's frames.
+/// The frames are processed on the given thread pool, which is shared by every sensor's
+/// controller and has to outlive them. Only the reference sensor's controller has textures and
+/// processes its frames, the others just hand their depth to the merger.
+/// </summary>
+/// <returns> The new controller, NULL on failure. </returns>
+KinectController* KinectController::Build(KinectFrameSource* frameSource, ThreadPool* threadPool,
+                                          KinectDepthMerger* depthMerger, int sensorIdx) {
+    assert(threadPool != NULL);
+    if (frameSource == NULL) {
         return NULL;
     }
 
-    // NOTE: for more than one sensor this app will need to use...
-    // NuiDeviceCount, NuiCreateInstanceByIndex, ...
-    
     std::auto_ptr<KinectController> newKinect(new KinectController());
-    
-    // Initialize the colour and depth buffers for the controller
-    result = NuiImageStreamOpen(NUI_IMAGE_TYPE_COLOR,               // RGB32
-                                NUI_IMAGE_RESOLUTION_640x480,
-                                0, 2,
-                                NULL,
-                                &newKinect->colourStreamHandle);
-    if (FAILED(result)) {
-        std::cerr << "Failed to open colour image stream" << std::endl;
-        return NULL;
+    newKinect->frameSource = frameSource;
+    newKinect->threadPool  = threadPool;
+    newKinect->depthMerger = depthMerger;
+    newKinect->sensorIdx   = sensorIdx;
+    assert(depthMerger == NULL || (sensorIdx >= 0 && sensorIdx < depthMerger->GetNumSensors()));
+
+    int colourWidth, colourHeight;
+    int depthWidth, depthHeight;
+    frameSource->GetColourResolution(colourWidth, colourHeight);
+    frameSource->GetDepthResolution(depthWidth, depthHeight);
+
+    // Allocate all the frame buffers up front so the capture thread never has to
+    size_t colourBufferSize = colourWidth*colourHeight*4;
+    size_t depthBufferSize  = depthWidth*depthHeight;
+    for (size_t i = 0; i < 3; i++) {
+        KinectFrame& frame = newKinect->frames.GetBuffer(i);
+        frame.colourBuffer.resize(colourBufferSize);
+        frame.depthBuffer.resize(depthBufferSize);
+        frame.nearDistanceInMm = MIN_DISTANCE;
+        frame.farDistanceInMm  = MAX_DISTANCE;
     }
+    newKinect->framePairer = new KinectFramePairer(colourBufferSize, depthBufferSize, frameSource->HasSkeletonFrames());
 
-    static const NUI_IMAGE_RESOLUTION DEPTH_RESOLUTION = NUI_IMAGE_RESOLUTION_640x480;
-    result = NuiImageStreamOpen(NUI_IMAGE_TYPE_DEPTH,
-                                DEPTH_RESOLUTION,
-                                0, 2,
-                                NULL,
-                                &newKinect->depthStreamHandle);
-    if (FAILED(result)) {
-        std::cerr << "Failed to open depth image stream" << std::endl;
+    // The other sensors only hand their depth to the depth merger (see ProcessFrame), so only the
+    // reference sensor gets the frame processing and the textures
+    if (newKinect->IsReferenceSensor() &&
+        (!newKinect->InitFrameProcessing(colourWidth, colourHeight, depthWidth, depthHeight) ||
+         !newKinect->InitTextures(colourWidth, colourHeight, depthWidth, depthHeight))) {
         return NULL;
     }
 
-    // Initialize the skeleton tracking
-    result = NuiSkeletonTrackingEnable(NULL, 0);
-    if (FAILED(result)) {
-        std::cerr << "Failed to enable skeletal tracking" << std::endl;
+    // Everything is setup, start capturing frames
+    if (!newKinect->StartCaptureThread()) {
+        std::cerr << "Failed to start the kinect capture thread." << std::endl;
         return NULL;
     }
 
+    return newKinect.release();
+}
+
+/// <summary> Set up the depth filters, colour registration and the rest of the reference sensor's frame processing. </summary>
+/// <returns> true on success. </returns>
+bool KinectController::InitFrameProcessing(int colourWidth, int colourHeight, int depthWidth, int depthHeight) {
+    for (size_t i = 0; i < 3; i++) {
+        KinectFrame& frame = this->frames.GetBuffer(i);
+        frame.depthPyramid.Resize(depthWidth, depthHeight);
+        frame.foregroundMask.Resize(depthWidth, depthHeight);
+        frame.foregroundMask.SetAll(true);
+    }
+
+    // Setup the depth filters and the colour registration, they share the thread pool
+    this->temporalDepthFilter = new TemporalDepthFilter(depthWidth, depthHeight, this->threadPool);
+    this->bilateralDepthFilter = new JointBilateralDepthFilter(depthWidth, depthHeight,
+        colourWidth, colourHeight, this->threadPool);
+
+    this->backgroundModel = new DepthBackgroundModel(depthWidth, depthHeight, this->threadPool);
+    // The nominal focal length is for a 320x240 depth image
+    float focalLengthInPixels = NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS * depthWidth / 320.0f;
+    this->depthFocalLengthInPixels = focalLengthInPixels;
+    this->meshGenerator = new DepthMeshGenerator(depthWidth, depthHeight, focalLengthInPixels,
+                                                 this->threadPool, MESH_VERTEX_STEP);
+    this->normalEstimator = new DepthNormalEstimator(depthWidth, depthHeight, focalLengthInPixels,
+                                                     this->threadPool);
+    this->depthTileTracker  = new DirtyTileTracker<USHORT>(depthWidth, depthHeight, 1, this->threadPool);
+    this->depthTileTracker->SetThreshold(DIRTY_DEPTH_THRESHOLD_IN_MM);
+    this->colourTileTracker = new DirtyTileTracker<BYTE>(colourWidth, colourHeight, 4, this->threadPool);
+    this->colourTileTracker->SetThreshold(DIRTY_COLOUR_THRESHOLD);
+    this->rangeCalibrator = new DepthRangeCalibrator(MIN_DISTANCE, MAX_DISTANCE);
+
+    // Not every frame source can line up the colour and depth images, the colour is shown unregistered then
+    this->colourRegistration = DepthColourRegistration::Build(*this->frameSource, MIN_DISTANCE, MAX_DISTANCE,
+                                                              this->threadPool);
+    if (this->colourRegistration != NULL) {
+        this->registeredColourBuffer.resize(colourWidth*colourHeight*4);
+        debug_output("Colour registration table: " << this->colourRegistration->GetTableSizeInBytes() << " bytes");
+    }
+    else {
+        debug_output("Colour registration is unavailable for this frame source.");
+    }
 
-    DWORD depthWidth, depthHeight;
-    NuiImageResolutionToSize(DEPTH_RESOLUTION, depthWidth, depthHeight);
-    newKinect->depthBuffer.resize(depthWidth*depthHeight);
+    return true;
+}
 
+/// <summary> Set up the reference sensor's colour, depth and normal textures and the FBOs and shaders that convert them. </summary>
+/// <returns> true on success. </returns>
+bool KinectController::InitTextures(int colourWidth, int colourHeight, int depthWidth, int depthHeight) {
     // Setup the textures that will hold the the images for depth and colour in the kinect
     // controller object...
-    newKinect->colourTexture = Texture2D::CreateEmptyTexture(640, 480, Texture::Nearest, GL_RGBA8);
-    newKinect->depthTexture  = Texture2D::CreateEmptyTexture(depthWidth, depthHeight, Texture::Nearest, GL_LUMINANCE);
-    if (newKinect->colourTexture == NULL || newKinect->depthTexture == NULL) {
-        std::cerr << "Failed to create colour/depth texture." << std::endl;
-        return NULL;
+    this->colourTexture = Texture2D::CreateEmptyTexture(colourWidth, colourHeight, Texture::Nearest, GL_RGBA8);
+    this->depthTexture  = Texture2D::CreateEmptyTexture(depthWidth, depthHeight, Texture::Nearest, GL_LUMINANCE16);
+    this->normalTexture = Texture2D::CreateEmptyTexture(depthWidth, depthHeight, Texture::Nearest, GL_RGBA8);
+    if (this->colourTexture == NULL || this->depthTexture == NULL || this->normalTexture == NULL) {
+        std::cerr << "Failed to create colour/depth/normal texture." << std::endl;
+        return false;
     }
 
 
     // Setup the FBOs, these are used to convert the hardware buffers into something
     // that looks correct in OpenGL
-    newKinect->colourFBO    = FBO::Build(640, 480, FBO::NoAttachment, Texture::Bilinear, GL_RGBA8);
-    newKinect->depthFBO     = FBO::Build(depthWidth, depthHeight, FBO::NoAttachment, Texture::Bilinear, GL_LUMINANCE);
-    newKinect->skeletonFBO  = FBO::Build(640, 480, FBO::DepthAttachment, Texture::Bilinear, GL_RGBA8);
-    if (newKinect->colourFBO == NULL || newKinect->depthFBO == NULL) {
+    this->colourFBO    = FBO::Build(colourWidth, colourHeight, FBO::NoAttachment, Texture::Bilinear, GL_RGBA8);
+    this->depthFBO     = FBO::Build(depthWidth, depthHeight, FBO::NoAttachment, Texture::Bilinear, GL_RGBA16);
+    this->skeletonFBO  = FBO::Build(640, 480, FBO::DepthAttachment, Texture::Bilinear, GL_RGBA8);
+    if (this->colourFBO == NULL || this->depthFBO == NULL) {
         std::cerr << "Failed to create colour/depth frame buffer objects." << std::endl;
-        return NULL;
+        return false;
     }
+    this->skeletonDebugRenderer = SkeletonDebugRenderer::Build();
+    if (this->skeletonDebugRenderer == NULL) {
+        return false;
+    }
+
+    // The colour and depth textures are replaced with every frame, stream them by default
+    this->SetStreamingTextureUploads(true);
 
     // Setup the conversion effects/shaders
-    newKinect->colourConverter = new CgFxKinectColourToTexture(newKinect->colourFBO, newKinect->colourTexture);
-    newKinect->depthConverter  = new CgFxKinectDepthToTexture(newKinect->depthFBO, newKinect->depthTexture);
+    this->colourConverter = new CgFxKinectColourToTexture(this->colourFBO, this->colourTexture);
+    this->depthConverter  = new CgFxKinectDepthToTexture(this->depthFBO, this->depthTexture);
+    this->depthConverter->SetDistanceRangeInMm(this->nearDistanceInMm, this->farDistanceInMm);
 
-    BUILD_COUNT++;
-    return newKinect.release();
+    return true;
 }
 
-/// <summary> Poll the kinect device for an available colour frame. </summary>
-void KinectController::PollForColourFrameEvent() {
-    if (this->colourImageFrame != NULL) {
-        NuiImageStreamReleaseFrame(this->colourStreamHandle, this->colourImageFrame);
-        this->colourImageFrame = NULL;
+/// <summary>
+/// Update the colour/depth textures and skeleton with the newest frame handed over by the
+/// capture thread (if there is one). This never blocks on the capture thread or the kinect.
+/// The frames of sensors other than the reference sensor only carry processing stats, their
+/// depth goes to the depth merger, so their textures are never updated.
+/// </summary>
+/// <returns> true if a new frame was handed over, false if the textures and skeleton are unchanged. </returns>
+bool KinectController::PollController() {
+    if (!this->frames.Acquire()) {
+        return false;
+    }
+
+    const KinectFrame& frame = this->frames.GetReadBuffer();
+    if (frame.processingTimeInMs > 0.0) {
+        this->processingTimes.AddSample(frame.processingTimeInMs);
+    }
+    if (!this->IsReferenceSensor()) {
+        return true;
     }
 
-    HRESULT result = NuiImageStreamGetNextFrame(this->colourStreamHandle, 0, &this->colourImageFrame);
-    if (FAILED(result)) {
+    if (frame.colourFrameId != this->lastColourFrameId) {
+        this->UpdateColourTexture(frame);
+    }
+    if (frame.depthFrameId != this->lastDepthFrameId) {
+        this->UpdateDepthTexture(frame);
+    }
+    if (frame.skeletonFrameId != this->lastSkeletonFrameId) {
+        this->UpdateSkeleton(frame);
+    }
+    this->frameCaptureTimeInMs = frame.captureTimeInMs;
+
+    return true;
+}
+
+/// <summary>
+/// Set whether the colour, depth and normal textures are uploaded asynchronously through pixel buffer
+/// objects (see Texture2D::StartStreaming) or synchronously. This also resets the upload stats.
+/// </summary>
+void KinectController::SetStreamingTextureUploads(bool streamUploads) {
+    // Only the reference sensor has textures
+    if (!this->IsReferenceSensor()) {
+        return;
+    }
+
+    if (streamUploads) {
+        if (!this->colourTexture->StartStreaming() || !this->depthTexture->StartStreaming() ||
+            !this->normalTexture->StartStreaming()) {
+            debug_output("Pixel buffer objects aren't supported, kinect textures will be uploaded synchronously.");
+        }
+    }
+    else {
+        this->colourTexture->StopStreaming();
+        this->depthTexture->StopStreaming();
+        this->normalTexture->StopStreaming();
+    }
+
+    this->colourTexture->ResetUploadStats();
+    this->depthTexture->ResetUploadStats();
+    this->normalTexture->ResetUploadStats();
+}
+
+/// <summary> Print how long the render thread was stalled uploading the colour, depth and normal textures. </summary>
+void KinectController::PrintUploadStats(std::ostream& out) const {
+    if (!this->IsReferenceSensor()) {
         return;
     }
 
-    NuiImageBuffer* colourImageBuffer = this->colourImageFrame->pFrameTexture;
-    KINECT_LOCKED_RECT lockedRect;
-    colourImageBuffer->LockRect(0, &lockedRect, NULL, 0);
-    if (lockedRect.Pitch != 0) {
+    const Texture2D* textures[] = { this->colourTexture, this->depthTexture, this->normalTexture };
+    const char* textureNames[]  = { "Colour", "Depth", "Normal" };
 
-        // The data from the buffer will be in the BGRA format and the image will be flipped
-        this->colourTexture->SetBuffer(GL_BGRA, GL_UNSIGNED_BYTE, static_cast<BYTE*>(lockedRect.pBits));
-        this->colourConverter->Draw();
+    for (size_t i = 0; i < 3; i++) {
+        const Texture2D::UploadStats& stats = textures[i]->GetUploadStats();
+        out << textureNames[i] << " texture uploads (" << (textures[i]->IsStreaming() ? "streamed" : "synchronous") << "): "
+            << stats.numUploads << " uploads, average stall " << stats.GetAverageStallTimeInMs()
+            << " ms, max stall " << stats.maxStallTimeInMs << " ms, "
+            << (this->uploadDirtyTilesOnly ? "dirty tiles only, " : "whole images, ")
+            << 100.0 * stats.GetUploadedFraction() << "% of texels uploaded" << std::endl;
+    }
+}
+
+/// <summary> Print how many captured frames were matched up, dropped or had no matching skeleton. </summary>
+void KinectController::PrintPairingStats(std::ostream& out) const {
+    const KinectFramePairer::Stats& stats = this->framePairer->GetStats();
+    out << "Frame pairing (max skew " << this->framePairer->GetMaxSkewInMs() << " ms): "
+        << stats.numMatchedFrames << " matched, "
+        << stats.numUnmatchedSkeletons << " without a skeleton, dropped "
+        << stats.numSupersededFrames << " superseded matches, "
+        << stats.numDroppedColourFrames << " colour, "
+        << stats.numDroppedDepthFrames << " depth, "
+        << stats.numDroppedSkeletonFrames << " skeleton" << std::endl;
+}
+
+/// <summary> Print how long the capture thread is spending filtering and registering each frame. </summary>
+void KinectController::PrintProcessingStats(std::ostream& out) const {
+    if (this->depthMerger != NULL) {
+        out << "Sensor " << this->sensorIdx << " of " << this->depthMerger->GetNumSensors()
+            << (this->sensorIdx == KinectDepthMerger::REFERENCE_SENSOR_IDX ? " (reference)" : "") << ": ";
+    }
+    out << "Frame processing on " << this->threadPool->GetNumThreads() << " threads (temporal filter "
+        << (this->isTemporalDepthFilterEnabled != 0 ? "on" : "off") << ", bilateral filter "
+        << (this->isBilateralDepthFilterEnabled != 0 ? "on" : "off") << ", colour registration "
+        << (this->colourRegistration == NULL ? "unavailable" : (this->isColourRegistrationEnabled != 0 ? "on" : "off"))
+        << ", background model " << (this->isBackgroundModelEnabled != 0 ? "on" : "off")
+        << ", mesh generation " << (this->isMeshGenerationEnabled != 0 ? "on" : "off")
+        << ", normal estimation " << (this->isNormalEstimationEnabled != 0 ? "on" : "off") << ")" << std::endl;
+    this->processingTimes.Print(out);
+}
+
+unsigned int __stdcall KinectController::CaptureThreadMain(void* kinectController) {
+    static_cast<KinectController*>(kinectController)->CaptureFrames();
+    return 0;
+}
+
+bool KinectController::StartCaptureThread() {
+    assert(this->captureThread == NULL);
+    this->stopCapture = 0;
+    this->captureThread = reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, &KinectController::CaptureThreadMain,
+                                                                  this, 0, NULL));
+    return this->captureThread != NULL;
+}
+
+void KinectController::StopCaptureThread() {
+    if (this->captureThread == NULL) {
+        return;
+    }
+
+    InterlockedExchange(&this->stopCapture, 1);
+    WaitForSingleObject(this->captureThread, INFINITE);
+    CloseHandle(this->captureThread);
+    this->captureThread = NULL;
+}
+
+/// <summary>
+/// Main loop of the capture thread: wait for the frame source, queue any new frames for pairing
+/// and publish the newest matched colour/depth/skeleton frames to the render thread.
+/// </summary>
+void KinectController::CaptureFrames() {
+    while (this->stopCapture == 0) {
+        this->frameSource->WaitForNextFrame(CAPTURE_WAIT_TIMEOUT_IN_MS);
+
+        // Non-short-circuit OR, every stream must be polled
+        bool newFrameCaptured = this->PollForColourFrameEvent();
+        newFrameCaptured |= this->PollForDepthFrameEvent();
+        newFrameCaptured |= this->PollForSkeletonFrameEvent();
+        if (!newFrameCaptured) {
+            continue;
+        }
+
+        KinectFrame& frame = this->frames.GetWriteBuffer();
+        const KinectFrame& lastFrame = this->frames.GetLastPublishedBuffer();
+
+        // Only the newest matched frames are published, older matches have already been superseded
+        bool matchedFrameFound = false;
+        bool hasSkeleton = false;
+        while (this->framePairer->PopMatchedFrame(frame, hasSkeleton)) {
+            if (matchedFrameFound) {
+                this->framePairer->DropSupersededFrame();
+            }
+            frame.colourFrameId = lastFrame.colourFrameId + 1;
+            frame.depthFrameId  = lastFrame.depthFrameId + 1;
+            if (hasSkeleton) {
+                frame.skeletonFrameId = lastFrame.skeletonFrameId + 1;
+            }
+            matchedFrameFound = true;
+        }
+        if (!matchedFrameFound) {
+            continue;
+        }
+        this->ProcessFrame(frame);
+
+        // Bring the skeleton up-to-date if it wasn't matched before handing the frame off
+        frame.CopyStaleStreamsFrom(lastFrame);
+        this->frames.Publish();
+    }
+}
+
+/// <summary> Poll the frame source for an available colour frame and queue it for pairing. </summary>
+/// <returns> true if a new colour frame was captured. </returns>
+bool KinectController::PollForColourFrameEvent() {
+    KinectImageFrame colourFrame;
+    if (!this->frameSource->AcquireColourFrame(colourFrame)) {
+        return false;
+    }
+
+    bool captured = false;
+    if (colourFrame.pitch != 0) {
+        std::vector<BYTE>& colourBuffer = this->framePairer->PushColourFrame(colourFrame.timestamp, colourFrame.captureTimeInMs);
+        assert(colourBuffer.size() == static_cast<size_t>(colourFrame.pitch * colourFrame.height));
+        memcpy(&colourBuffer[0], colourFrame.data, colourBuffer.size());
+        captured = true;
     }
     else {
         debug_output("Colour buffer length of received texture is bogus.");
     }
-    colourImageBuffer->UnlockRect(0);
+    this->frameSource->ReleaseColourFrame();
 
     //std::cout << "Colour frame accquired." << std::endl;
+    return captured;
+}
+
+/// <summary> Poll the frame source for an available depth frame and queue it for pairing. </summary>
+/// <returns> true if a new depth frame was captured. </returns>
+bool KinectController::PollForDepthFrameEvent() {
+    KinectImageFrame depthFrame;
+    if (!this->frameSource->AcquireDepthFrame(depthFrame)) {
+        return false;
+    }
+
+    bool captured = false;
+    if (depthFrame.pitch != 0) {
+        // The raw depths are uploaded untouched, they get normalized by the depth converter shader
+        std::vector<USHORT>& depthBuffer = this->framePairer->PushDepthFrame(depthFrame.timestamp, depthFrame.captureTimeInMs);
+        assert(depthBuffer.size() * sizeof(USHORT) == static_cast<size_t>(depthFrame.pitch * depthFrame.height));
+        memcpy(&depthBuffer[0], depthFrame.data, depthBuffer.size() * sizeof(USHORT));
+        captured = true;
+    }
+    else {
+        debug_output("Depth buffer length of received texture is bogus.");
+    }
+    this->frameSource->ReleaseDepthFrame();
+
+    //std::cout << "Depth frame accquired." << std::endl; 
+    return captured;
 }
 
-/// <summary> Poll the kinect device for an available depth frame. </summary>
-void KinectController::PollForDepthFrameEvent() {
-    if (this->depthImageFrame != NULL) {
-        NuiImageStreamReleaseFrame(this->depthStreamHandle, this->depthImageFrame);
-        this->depthImageFrame = NULL;
+/// <summary> Poll the frame source for an available skeleton frame and queue it for pairing. </summary>
+/// <returns> true if a new skeleton frame was captured. </returns>
+bool KinectController::PollForSkeletonFrameEvent() {
+    NUI_SKELETON_FRAME skeletonFrame;
+    if (!this->frameSource->GetNextSkeletonFrame(skeletonFrame)) {
+        return false;
     }
 
-    HRESULT result = NuiImageStreamGetNextFrame(this->depthStreamHandle, 0, &this->depthImageFrame);
-    if (FAILED(result)) {
+    this->framePairer->PushSkeletonFrame(skeletonFrame);
+    return true;
+}
+
+/// <summary>
+/// Run the enabled depth filters over the depth image of the given (newly captured) frame, line
+/// its colour image up with the depth image, build the depth pyramid and estimate the normals. With
+/// several sensors, the other sensors only hand their depth over to be merged into the reference
+/// sensor's frame, everything else is done once, on the merged depth.
+/// </summary>
+void KinectController::ProcessFrame(KinectFrame& frame) {
+    double startTimeInMs = augengine::GetHighResTimeInMs();
+
+    if (!this->IsReferenceSensor()) {
+        this->depthMerger->SubmitDepth(this->sensorIdx, &frame.depthBuffer[0]);
+        frame.processingTimeInMs = augengine::GetHighResTimeInMs() - startTimeInMs;
         return;
     }
 
-    NuiImageBuffer* depthImageBuffer = this->depthImageFrame->pFrameTexture;
-    KINECT_LOCKED_RECT lockedRect;
-    depthImageBuffer->LockRect(0, &lockedRect, NULL, 0);
-    if (lockedRect.Pitch != 0) {
-        
-        //int largestDistance  = INT_MIN; 
-        //int smallestDistance = INT_MAX; 
-
-        float distanceDiffInMm = this->farDistanceInMm - this->nearDistanceInMm;
-
-        assert(!this->depthBuffer.empty());
-        float* currDepthPtr = &this->depthBuffer[0];
-        BYTE* buffer = (BYTE*)(lockedRect.pBits);
-        BYTE b0, b1;
-        for (size_t i = 0; i < this->depthBuffer.size(); i++) {
-         
-            b0 = *buffer;
-            buffer++;
-            b1 = *buffer;
-            buffer++;
-
-            int distance = (b0 | b1 << 8);
-            //if (distance < 65535) {
-            //    largestDistance = std::max<int>(largestDistance, distance);
-            //}
-            //if (distance > 0) {
-            //    smallestDistance = std::min<int>(smallestDistance, distance);
-            //}
-
-            *currDepthPtr = static_cast<float>((BYTE)((255 * std::max<float>(distance - this->nearDistanceInMm, 0.0f) / distanceDiffInMm))) / 255.0f;
-            currDepthPtr++;
+    // The reference sensor's holes are filled in by the other sensors before anything else sees the depth
+    if (this->depthMerger != NULL) {
+        this->depthMerger->Merge(&frame.depthBuffer[0]);
+    }
+
+    bool isTemporalDepthFilterEnabled = (this->isTemporalDepthFilterEnabled != 0);
+    if (isTemporalDepthFilterEnabled) {
+        // Anything the filter remembers from before it was disabled is stale
+        if (!this->wasTemporalDepthFilterEnabled) {
+            this->temporalDepthFilter->Reset();
         }
-        //std::cout << "Largest Distance:  " << largestDistance << std::endl;
-        //std::cout << "Smallest Distnace: " << smallestDistance << std::endl;
+        this->temporalDepthFilter->Apply(&frame.depthBuffer[0]);
+    }
+    this->wasTemporalDepthFilterEnabled = isTemporalDepthFilterEnabled;
 
-        this->depthTexture->SetBuffer(GL_LUMINANCE, GL_FLOAT, &this->depthBuffer[0]);
-        this->depthConverter->Draw();
+    // The registered colour replaces the frame's colour (the frame's buffer becomes the next scratch buffer)
+    if (this->colourRegistration != NULL && this->isColourRegistrationEnabled != 0) {
+        this->colourRegistration->Apply(&frame.depthBuffer[0], &frame.colourBuffer[0], &this->registeredColourBuffer[0]);
+        frame.colourBuffer.swap(this->registeredColourBuffer);
+    }
+
+    // Line the (denoised) depth edges up with the colour edges
+    if (this->isBilateralDepthFilterEnabled != 0) {
+        this->bilateralDepthFilter->Apply(&frame.depthBuffer[0], &frame.colourBuffer[0]);
+    }
+
+    // Mark what is in front of the static scene, so later stages can skip the rest
+    bool isBackgroundModelEnabled = (this->isBackgroundModelEnabled != 0);
+    if (isBackgroundModelEnabled) {
+        if (!this->wasBackgroundModelEnabled) {
+            this->backgroundModel->Reset();
+        }
+        this->backgroundModel->Apply(&frame.depthBuffer[0], frame.foregroundMask);
     }
     else {
-        debug_output("Depth buffer length of received texture is bogus.");
+        frame.foregroundMask.SetAll(true);
     }
-    depthImageBuffer->UnlockRect(0);
+    this->wasBackgroundModelEnabled = isBackgroundModelEnabled;
 
-    //std::cout << "Depth frame accquired." << std::endl; 
+    // Consumers that only need a coarse view of the depth (hands, occlusion, LOD) use the pyramid
+    frame.depthPyramid.Build(&frame.depthBuffer[0]);
+
+    // Fit the range the depth texture holds to the scene, from a coarse view of the depth
+    bool isRangeCalibrationEnabled = (this->isRangeCalibrationEnabled != 0);
+    if (isRangeCalibrationEnabled) {
+        if (!this->wasRangeCalibrationEnabled) {
+            this->rangeCalibrator->Reset();
+        }
+        int level = std::min<int>(RANGE_CALIBRATION_PYRAMID_LEVEL, frame.depthPyramid.GetNumLevels() - 1);
+        this->rangeCalibrator->AddDepths(frame.depthPyramid.GetMeanDepths(level),
+            frame.depthPyramid.GetWidth(level) * frame.depthPyramid.GetHeight(level));
+    }
+    this->wasRangeCalibrationEnabled = isRangeCalibrationEnabled;
+    frame.nearDistanceInMm = this->rangeCalibrator->GetNearDistanceInMm();
+    frame.farDistanceInMm  = this->rangeCalibrator->GetFarDistanceInMm();
+
+    if (this->isMeshGenerationEnabled != 0) {
+        this->meshGenerator->Generate(&frame.depthBuffer[0], frame.depthMesh);
+    }
+    else {
+        frame.depthMesh.Clear();
+    }
+
+    // Every depth frame gets its normals here, once, rather than every vertex differencing its neighbours
+    bool isNormalEstimationEnabled = (this->isNormalEstimationEnabled != 0);
+    if (isNormalEstimationEnabled) {
+        this->normalEstimator->Estimate(&frame.depthBuffer[0], frame.depthNormals);
+    }
+    else {
+        this->normalEstimator->Clear(frame.depthNormals);
+    }
+
+    // Let the render thread (and anything else downstream) skip the parts of the images that didn't change,
+    // a normal is smoothed over less than a tile so it only changes if a depth in its tile or the next did
+    // (every normal changes when the estimation is switched on or off)
+    this->depthTileTracker->Update(&frame.depthBuffer[0], frame.dirtyDepthTiles);
+    frame.dirtyNormalTiles.DilateFrom(frame.dirtyDepthTiles);
+    if (isNormalEstimationEnabled != this->wasNormalEstimationEnabled) {
+        frame.dirtyNormalTiles.SetAll(true);
+    }
+    else if (!isNormalEstimationEnabled) {
+        frame.dirtyNormalTiles.SetAll(false);
+    }
+    this->wasNormalEstimationEnabled = isNormalEstimationEnabled;
+    this->colourTileTracker->Update(&frame.colourBuffer[0], frame.dirtyColourTiles);
+
+    frame.processingTimeInMs = augengine::GetHighResTimeInMs() - startTimeInMs;
 }
 
-void KinectController::PollForSkeletonFrameEvent() {
+/// <summary> Check whether this controller's frames are shown, rather than only merged into the reference sensor's. </summary>
+bool KinectController::IsReferenceSensor() const {
+    return this->depthMerger == NULL || this->sensorIdx == KinectDepthMerger::REFERENCE_SENSOR_IDX;
+}
 
-    HRESULT result = NuiSkeletonGetNextFrame(0, &this->skeletonFrame);
-    if (FAILED(result)) {
+void KinectController::UpdateColourTexture(const KinectFrame& frame) {
+    // The data from the buffer will be in the BGRA format and the image will be flipped
+    this->isColourFrameNext = (frame.colourFrameId == this->lastColourFrameId + 1);
+    this->UploadImage(this->colourTexture, GL_BGRA, GL_UNSIGNED_BYTE, &frame.colourBuffer[0],
+                      frame.dirtyColourTiles, this->isColourFrameNext);
+    this->colourConverter->Draw();
+    this->lastColourFrameId = frame.colourFrameId;
+}
+
+void KinectController::UpdateDepthTexture(const KinectFrame& frame) {
+    this->isDepthFrameNext = (frame.depthFrameId == this->lastDepthFrameId + 1);
+    this->UploadImage(this->depthTexture, GL_LUMINANCE, GL_UNSIGNED_SHORT, &frame.depthBuffer[0],
+                      frame.dirtyDepthTiles, this->isDepthFrameNext);
+    this->UploadImage(this->normalTexture, GL_RGBA, GL_UNSIGNED_BYTE, frame.depthNormals.GetPackedNormals(),
+                      frame.dirtyNormalTiles, this->isDepthFrameNext);
+    this->nearDistanceInMm = frame.nearDistanceInMm;
+    this->farDistanceInMm  = frame.farDistanceInMm;
+    this->depthConverter->SetDistanceRangeInMm(this->nearDistanceInMm, this->farDistanceInMm);
+    this->depthConverter->Draw();
+    this->lastDepthFrameId = frame.depthFrameId;
+}
+
+/// <summary>
+/// Upload the given image to the given texture. The dirty tiles only say what changed since the
+/// previous frame, so only they are uploaded if the texture holds the previous frame.
+/// </summary>
+void KinectController::UploadImage(Texture2D* texture, GLenum format, GLenum type, const GLvoid* image,
+                                   const DirtyTiles& dirtyTiles, bool isNextFrame) {
+    if (!this->uploadDirtyTilesOnly || !isNextFrame || dirtyTiles.GetTileSize() == 0) {
+        texture->SetBuffer(format, type, image);
         return;
     }
 
-    NuiTransformSmooth(&this->skeletonFrame, NULL);
+    // Runs of dirty tiles along each row of tiles are uploaded as one rectangle
+    int tileSize = dirtyTiles.GetTileSize();
+    int textureWidth  = static_cast<int>(texture->GetWidth());
+    int textureHeight = static_cast<int>(texture->GetHeight());
+    this->dirtyRects.clear();
+    for (int tileY = 0; tileY < dirtyTiles.GetNumTilesY(); tileY++) {
+        int y = tileY * tileSize;
+        int height = std::min<int>(tileSize, textureHeight - y);
+        for (int tileX = 0; tileX < dirtyTiles.GetNumTilesX(); tileX++) {
+            if (!dirtyTiles.IsDirty(tileX, tileY)) {
+                continue;
+            }
+            int endTileX = tileX + 1;
+            while (endTileX < dirtyTiles.GetNumTilesX() && dirtyTiles.IsDirty(endTileX, tileY)) {
+                endTileX++;
+            }
+            int x = tileX * tileSize;
+            int width = std::min<int>(endTileX * tileSize, textureWidth) - x;
+            this->dirtyRects.push_back(Texture2D::SubRect(x, y, width, height));
+            tileX = endTileX;
+        }
+    }
+    texture->SetSubBuffers(format, type, image, this->dirtyRects);
+}
+
+void KinectController::UpdateSkeleton(const KinectFrame& frame) {
+    this->skeletonFrame = frame.skeletonFrame;
+    this->lastSkeletonFrameId = frame.skeletonFrameId;
+    this->skeletonHistory.AddFrame(frame.skeletonFrame, frame.captureTimeInMs);
+    this->isSkeletonDebugTextureStale = true;
+}
+
+/// <summary>
+/// Redraw the skeleton debug texture if the skeleton frame has changed since it was last drawn, this
+/// should only be called when the texture is about to be shown.
+/// </summary>
+void KinectController::UpdateSkeletalDebugTexture() {
+    if (!this->isSkeletonDebugTextureStale) {
+        return;
+    }
     this->DrawSkeletonDebugTexture();
+    this->isSkeletonDebugTextureStale = false;
 }
 
 void KinectController::DrawSkeletonDebugTexture() {
-    glPushAttrib(GL_POLYGON_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT | GL_VIEWPORT_BIT | GL_POINT_BIT);
+    glPushAttrib(GL_POLYGON_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT | GL_VIEWPORT_BIT);
 
     glDisable(GL_LIGHTING);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glPolygonMode(GL_FRONT, GL_FILL);
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glDisable(GL_TEXTURE_2D);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    glDisable(GL_DEPTH_TEST);
 
     this->skeletonFBO->BindFBO();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -284,11 +752,9 @@ void KinectController::DrawSkeletonDebugTexture() {
     glRotatef(180, 0, 0, 1);
     glTranslatef(-width/2, -height/2, 0);
 
-    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
-        if (this->skeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED) {
-            this->DrawSkeleton(this->skeletonFrame.SkeletonData[i]);
-        }
-    }
+    this->skeletonDebugJoints.Build(this->skeletonFrame);
+    this->skeletonDebugRenderer->Draw(this->skeletonDebugJoints, width, height);
+
     glPopMatrix();
 
     Camera::PopWindowCoords();
@@ -297,50 +763,3 @@ void KinectController::DrawSkeletonDebugTexture() {
 
     glPopAttrib();
 }
-
-void KinectController::DrawSkeleton(const NUI_SKELETON_DATA& skeleton) {
-
-    std::vector<Eigen::Vector2f> skeletonPts;
-    skeletonPts.reserve(NUI_SKELETON_POSITION_COUNT);
-
-    float scaleX = static_cast<float>(this->depthFBO->GetFBOTexture()->GetWidth());
-    float scaleY = static_cast<float>(this->depthFBO->GetFBOTexture()->GetHeight());
-    float xPos, yPos;
-    for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++) {
-        NuiTransformSkeletonToDepthImageF(skeleton.SkeletonPositions[i], &xPos, &yPos);
-        skeletonPts.push_back(Eigen::Vector2f(xPos*scaleX, yPos*scaleY));
-    }
-
-    // Draw the joints of the skeleton
-    glPointSize(15.0f);
-    glColor4f(1, 0, 0, 1);
-    glBegin(GL_POINTS);
-    for (size_t i = 0; i < skeletonPts.size(); i++) {
-        const Eigen::Vector2f& currPt = skeletonPts[i];
-        glVertex2f(currPt.x(), currPt.y());
-    }
-    glEnd();
-
-    // Draw the lines connecting the various joints of the skeleton
-    this->DrawSkeletonSegments(skeleton, skeletonPts, 4, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD);
-    this->DrawSkeletonSegments(skeleton, skeletonPts, 5, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT);
-    this->DrawSkeletonSegments(skeleton, skeletonPts, 5, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT);
-    this->DrawSkeletonSegments(skeleton, skeletonPts, 5, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT);
-    this->DrawSkeletonSegments(skeleton, skeletonPts, 5, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT);
-}
-
-void KinectController::DrawSkeletonSegments(const NUI_SKELETON_DATA& skeleton,
-                                            const std::vector<Eigen::Vector2f>& skeletonPts,
-                                            int numJoints, ...) {
-    va_list vl;
-    va_start(vl, numJoints);
-
-    glColor4f(0,1,0,1);
-    glBegin(GL_LINE_STRIP);
-    for (int i = 0; i < numJoints; i++) {
-        NUI_SKELETON_POSITION_INDEX jointIndex = va_arg(vl,NUI_SKELETON_POSITION_INDEX);
-        const Eigen::Vector2f& currPt = skeletonPts[jointIndex];
-        glVertex2f(currPt.x(), currPt.y());
-    }
-    glEnd();
-}
\ No newline at end of file
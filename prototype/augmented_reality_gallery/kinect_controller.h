@@ -2,103 +2,199 @@
 #ifndef KINECT_CONTROLLER_H_
 #define KINECT_CONTROLLER_H_
 
+// Augmented Gallery Includes
+#include <kinect_frame.h>
+#include <kinect_frame_pairer.h>
+#include <skeleton_history.h>
+#include <skeleton_joint_batch.h>
+
 // AugEngine Includes
 #include <common.h>
 #include <aug_3d_engine/fbo.h>
+#include <aug_3d_engine/triple_buffer.h>
+#include <aug_3d_engine/latency_histogram.h>
+#include <aug_3d_engine/dirty_tile_tracker.h>
+#include <aug_3d_engine/texture_2d.h>
 
 // AugEngine Forward Declarations
-class Texture2D;
 class FBO;
+class KinectFrameSource;
+class ThreadPool;
+class TemporalDepthFilter;
+class JointBilateralDepthFilter;
+class DepthColourRegistration;
 class CgFxKinectColourToTexture;
+class SkeletonDebugRenderer;
 class CgFxKinectDepthToTexture;
+class KinectDepthMerger;
+class DepthRangeCalibrator;
+class DepthBackgroundModel;
+class DepthMeshGenerator;
+class DepthNormalEstimator;
 
 class KinectController {
 public:
-    static KinectController* Build();
+    static KinectController* Build(ThreadPool* threadPool);
+    static KinectController* Build(KinectFrameSource* frameSource, ThreadPool* threadPool,
+                                   KinectDepthMerger* depthMerger = NULL, int sensorIdx = 0);
     ~KinectController();
 
-    void PollController();
+    bool PollController();
+    double GetFrameCaptureTimeInMs() const;
+    unsigned int GetDepthFrameId() const;
+
+    // Texture upload methods
+    void SetStreamingTextureUploads(bool streamUploads);
+    void SetDirtyTileUploads(bool dirtyTilesOnly);
+    void PrintUploadStats(std::ostream& out) const;
+
+    // Frame pairing methods
+    void SetMaxFrameSkewInMs(LONG maxSkewInMs);
+    void PrintPairingStats(std::ostream& out) const;
+
+    // Frame processing (depth filtering and colour registration) methods
+    void SetTemporalDepthFiltering(bool isEnabled);
+    void SetBilateralDepthFiltering(bool isEnabled);
+    void SetColourRegistration(bool isEnabled);
+    void SetBackgroundModelling(bool isEnabled);
+    void SetMeshGeneration(bool isEnabled);
+    void SetNormalEstimation(bool isEnabled);
+    void PrintProcessingStats(std::ostream& out) const;
 
     // Colour and depth query methods
     const Texture2D* GetDepthTexture() const;
     const Texture2D* GetColourTexture() const;
-
+    const DepthPyramid& GetDepthPyramid() const;
+    const ForegroundMask& GetForegroundMask() const;
+    const DirtyTiles* GetDirtyDepthTiles() const;
+    const DirtyTiles* GetDirtyColourTiles() const;
+    const DepthMesh& GetDepthMesh() const;
+    const Texture2D* GetNormalTexture() const;
+    const DepthNormalMap& GetDepthNormals() const;
+    float GetDepthFocalLengthInPixels() const;
+
+    // Depth range methods
+    void SetRangeCalibration(bool isEnabled);
     float GetNearDistanceInMillimeters() const;
     float GetFarDistanceInMillimeters() const;
 
     // Skeletal data query methods
+    void UpdateSkeletalDebugTexture();
     const Texture2D* GetSkeletalDebugTexture() const;
+    const SkeletonHistory& GetSkeletonHistory() const;
+    void UpdateJoints(double displayTimeInMs);
+    const SkeletonJointBatch& GetJoints() const;
     bool GetHandPos(float scaleX, float scaleY, Eigen::Vector3f& pos) const {
-
-        for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
-            if (this->skeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED) {
-                float xPos, yPos;
-
-                Vector4 handPos = this->skeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
-                
-                // For some reason there are hiccups in the data, and occasionally a really odd number comes through where
-                // the z value of the hand is around zero
-                if (handPos.z <= FLT_EPSILON) {
-                    return false;
-                }
-                NuiTransformSkeletonToDepthImageF(handPos, &xPos, &yPos);
-
-                pos[0] = std::max<float>(0, std::min<float>(xPos*scaleX, scaleX));
-                pos[1] = std::max<float>(0, std::min<float>(yPos*scaleY, scaleY));
-                pos[2] = handPos.z * 100;
-
-                return true;
-            }
+        // The right hand of the first tracked skeleton, as of the last call to UpdateJoints
+        if (this->joints.GetNumSkeletons() == 0) {
+            return false;
         }
+        int handIdx = SkeletonJointBatch::GetJointIndex(0, NUI_SKELETON_POSITION_HAND_RIGHT);
+        if (!this->joints.GetIsValid()[handIdx]) {
+            return false;
+        }
+
+        pos[0] = std::max<float>(0, std::min<float>(this->joints.GetDepthXs()[handIdx]*scaleX, scaleX));
+        pos[1] = std::max<float>(0, std::min<float>(this->joints.GetDepthYs()[handIdx]*scaleY, scaleY));
+        pos[2] = this->joints.GetZs()[handIdx] * 100;
 
-        return false;
+        return true;
     }
 
 private:
     KinectController();
 
-    const NUI_IMAGE_FRAME* colourImageFrame;
-    const NUI_IMAGE_FRAME* depthImageFrame;
+    KinectFrameSource* frameSource; // Where the colour, depth and skeleton frames come from (owned by this)
+
+    // Frames are captured and paired up on the capture thread and handed off to the render thread
+    KinectFramePairer* framePairer;
+    TripleBuffer<KinectFrame> frames;
+    HANDLE captureThread;
+    volatile LONG stopCapture;
+
+    // Frame processing done on the capture thread
+    ThreadPool* threadPool;                 // Shared by every sensor's controller (not owned by this)
+    TemporalDepthFilter* temporalDepthFilter;
+    volatile LONG isTemporalDepthFilterEnabled;
+    bool wasTemporalDepthFilterEnabled;     // Only used on the capture thread
+    JointBilateralDepthFilter* bilateralDepthFilter;
+    volatile LONG isBilateralDepthFilterEnabled;
+    DepthColourRegistration* colourRegistration;    // NULL if the frame source can't register colour to depth
+    volatile LONG isColourRegistrationEnabled;
+    std::vector<BYTE> registeredColourBuffer;       // Only used on the capture thread
+    DepthBackgroundModel* backgroundModel;
+    volatile LONG isBackgroundModelEnabled;
+    bool wasBackgroundModelEnabled;                 // Only used on the capture thread
+    DepthMeshGenerator* meshGenerator;              // Only used on the capture thread
+    volatile LONG isMeshGenerationEnabled;
+    DepthNormalEstimator* normalEstimator;          // Only used on the capture thread
+    volatile LONG isNormalEstimationEnabled;
+    bool wasNormalEstimationEnabled;                // Only used on the capture thread, starts on so the normals are cleared if they're off from the start
+    float depthFocalLengthInPixels;
+    DirtyTileTracker<USHORT>* depthTileTracker;     // Only used on the capture thread
+    DirtyTileTracker<BYTE>* colourTileTracker;      // Only used on the capture thread
+    KinectDepthMerger* depthMerger;                 // Fuses the depth of several sensors (not owned by this), NULL for a single sensor
+    int sensorIdx;                                  // Index of this controller's sensor in the depth merger
+    DepthRangeCalibrator* rangeCalibrator;          // Only used on the capture thread
+    volatile LONG isRangeCalibrationEnabled;
+    bool wasRangeCalibrationEnabled;                // Only used on the capture thread
+    LatencyHistogram processingTimes;               // Only used on the render thread
+
+    // Ids of the last frame of each stream that was uploaded/copied on the render thread
+    unsigned int lastColourFrameId;
+    unsigned int lastDepthFrameId;
+    unsigned int lastSkeletonFrameId;
+    bool isColourFrameNext;         // Whether the colour frame in the texture directly follows the one uploaded before it
+    bool isDepthFrameNext;          // Whether the depth frame in the texture directly follows the one uploaded before it
     NUI_SKELETON_FRAME skeletonFrame;
-
-    HANDLE depthStreamHandle;
-    HANDLE colourStreamHandle;
+    SkeletonHistory skeletonHistory;
+    SkeletonJointBatch joints;      // Joints of the tracked skeletons, predicted for the frame being rendered
+    double frameCaptureTimeInMs;    // When the frame in the textures/skeleton was acquired
 
     Texture2D* depthTexture;
     Texture2D* colourTexture;
+    Texture2D* normalTexture;                   // Packed normals of the depth image (see DepthNormalMap)
+    bool uploadDirtyTilesOnly;                  // Whether only the changed tiles of the colour/depth images are uploaded
+    std::vector<Texture2D::SubRect> dirtyRects; // Rectangles of the texture being uploaded, only used on the render thread
 
     FBO* depthFBO;
     FBO* colourFBO;
     FBO* skeletonFBO;
-
-    std::vector<float> depthBuffer;
+    SkeletonDebugRenderer* skeletonDebugRenderer;
+    SkeletonJointBatch skeletonDebugJoints;     // Joints of the newest skeleton frame, only built when drawn
+    bool isSkeletonDebugTextureStale;           // Whether the skeleton frame changed since it was last drawn
 
     CgFxKinectColourToTexture* colourConverter;
     CgFxKinectDepthToTexture* depthConverter;
 
-    float nearDistanceInMm; // The closest distance in mm that the kinect can record in its depth buffer
-    float farDistanceInMm;  // The furthest distance in mm that the kinect can record in its depth buffer
-
-    bool isCalibrating; // Whether or not we are currently calibrating the kinect
-
-    void PollForColourFrameEvent();
-    void PollForDepthFrameEvent();
-    void PollForSkeletonFrameEvent();
+    float nearDistanceInMm; // The closest distance in mm the depth texture holds, as of the last depth frame uploaded
+    float farDistanceInMm;  // The furthest distance in mm the depth texture holds, as of the last depth frame uploaded
+
+    // Capture thread methods
+    static unsigned int __stdcall CaptureThreadMain(void* kinectController);
+    bool StartCaptureThread();
+    void StopCaptureThread();
+    void CaptureFrames();
+    bool PollForColourFrameEvent();
+    bool PollForDepthFrameEvent();
+    bool PollForSkeletonFrameEvent();
+    void ProcessFrame(KinectFrame& frame);
+    bool IsReferenceSensor() const;
+    bool InitFrameProcessing(int colourWidth, int colourHeight, int depthWidth, int depthHeight);
+    bool InitTextures(int colourWidth, int colourHeight, int depthWidth, int depthHeight);
+
+    // Render thread methods
+    void UpdateColourTexture(const KinectFrame& frame);
+    void UpdateDepthTexture(const KinectFrame& frame);
+    void UpdateSkeleton(const KinectFrame& frame);
+    void UploadImage(Texture2D* texture, GLenum format, GLenum type, const GLvoid* image,
+                     const DirtyTiles& dirtyTiles, bool isNextFrame);
 
     void DrawSkeletonDebugTexture();
-    void DrawSkeleton(const NUI_SKELETON_DATA& skeleton);
-    void DrawSkeletonSegments(const NUI_SKELETON_DATA& skeleton,
-        const std::vector<Eigen::Vector2f>& skeletonPts, int numJoints, ...);
 
     DISALLOW_COPY_AND_ASSIGN(KinectController);
 };
 
-inline void KinectController::PollController() {
-    this->PollForColourFrameEvent();
-    this->PollForDepthFrameEvent();
-    this->PollForSkeletonFrameEvent();
-}
-
 inline const Texture2D* KinectController::GetDepthTexture() const {
     return this->depthFBO->GetFBOTexture();
 }
@@ -107,6 +203,160 @@ inline const Texture2D* KinectController::GetColourTexture() const {
     return this->colourFBO->GetFBOTexture();
 }
 
+/// <summary>
+/// Set the largest difference in sensor timestamps between colour, depth and skeleton frames
+/// that are shown together.
+/// </summary>
+inline void KinectController::SetMaxFrameSkewInMs(LONG maxSkewInMs) {
+    this->framePairer->SetMaxSkewInMs(maxSkewInMs);
+}
+
+/// <summary> Set whether the depth images are filtered over time (see TemporalDepthFilter). </summary>
+inline void KinectController::SetTemporalDepthFiltering(bool isEnabled) {
+    InterlockedExchange(&this->isTemporalDepthFilterEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary> Set whether the depth images are filtered guided by the colour images (see JointBilateralDepthFilter). </summary>
+inline void KinectController::SetBilateralDepthFiltering(bool isEnabled) {
+    InterlockedExchange(&this->isBilateralDepthFilterEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary> Set whether the colour images are resampled to line up with the depth images (see DepthColourRegistration). </summary>
+inline void KinectController::SetColourRegistration(bool isEnabled) {
+    InterlockedExchange(&this->isColourRegistrationEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary>
+/// Set whether the static scene is learned so the depth images' foreground can be told apart
+/// from it (see DepthBackgroundModel), relearning starts from scratch when re-enabled. It is off
+/// by default, it only pays off for CPU-side consumers of GetForegroundMask.
+/// </summary>
+inline void KinectController::SetBackgroundModelling(bool isEnabled) {
+    InterlockedExchange(&this->isBackgroundModelEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary>
+/// Get the pyramid of the depth image in the depth texture, it stays valid (and unchanged)
+/// until the next call to PollController.
+/// </summary>
+inline const DepthPyramid& KinectController::GetDepthPyramid() const {
+    return this->frames.GetReadBuffer().depthPyramid;
+}
+
+/// <summary>
+/// Get the pixels of the depth image in the depth texture that are in front of the learned
+/// background, every pixel is foreground while background modelling is disabled. The mask stays
+/// valid (and unchanged) until the next call to PollController.
+/// </summary>
+inline const ForegroundMask& KinectController::GetForegroundMask() const {
+    return this->frames.GetReadBuffer().foregroundMask;
+}
+
+/// <summary>
+/// Get the tiles of the depth image in the depth texture that changed since the previous depth
+/// image (see DirtyTileTracker), they stay valid (and unchanged) until the next call to PollController.
+/// Frames can be skipped between calls, in which case the tiles don't say what changed since the
+/// previously uploaded image and NULL is returned (consumers should redo the whole image).
+/// </summary>
+inline const DirtyTiles* KinectController::GetDirtyDepthTiles() const {
+    return this->isDepthFrameNext ? &this->frames.GetReadBuffer().dirtyDepthTiles : NULL;
+}
+
+/// <summary> Get the tiles of the colour image in the colour texture that changed, see GetDirtyDepthTiles. </summary>
+inline const DirtyTiles* KinectController::GetDirtyColourTiles() const {
+    return this->isColourFrameNext ? &this->frames.GetReadBuffer().dirtyColourTiles : NULL;
+}
+
+/// <summary>
+/// Get the triangle mesh of the depth image in the depth texture (see DepthMeshGenerator), for
+/// CPU-side consumers of the surface. It is empty unless mesh generation is enabled and stays valid
+/// (and unchanged) until the next call to PollController.
+/// </summary>
+inline const DepthMesh& KinectController::GetDepthMesh() const {
+    return this->frames.GetReadBuffer().depthMesh;
+}
+
+/// <summary>
+/// Get the texture holding the surface normals of the depth image in the depth texture, packed
+/// as in DepthNormalMap. Unlike the depth texture it isn't flipped, row 0 is the top of the image.
+/// </summary>
+inline const Texture2D* KinectController::GetNormalTexture() const {
+    return this->normalTexture;
+}
+
+/// <summary>
+/// Get the surface normals of the depth image in the depth texture (see DepthNormalEstimator), for
+/// CPU-side consumers of the surface. They stay valid (and unchanged) until the next call to PollController.
+/// </summary>
+inline const DepthNormalMap& KinectController::GetDepthNormals() const {
+    return this->frames.GetReadBuffer().depthNormals;
+}
+
+/// <summary> Get the focal length of the depth images, in pixels, the normals were estimated with. </summary>
+inline float KinectController::GetDepthFocalLengthInPixels() const {
+    return this->depthFocalLengthInPixels;
+}
+
+/// <summary> Set whether a triangle mesh is generated from every depth image on the capture thread. </summary>
+inline void KinectController::SetMeshGeneration(bool isEnabled) {
+    InterlockedExchange(&this->isMeshGenerationEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary>
+/// Set whether the surface normals of every depth image are estimated on the capture thread. Without
+/// them every normal is missing and the depth geometry is shaded as if it faced the sensor.
+/// </summary>
+inline void KinectController::SetNormalEstimation(bool isEnabled) {
+    InterlockedExchange(&this->isNormalEstimationEnabled, isEnabled ? 1 : 0);
+}
+
+/// <summary>
+/// Set whether only the tiles of the colour/depth images that changed are uploaded to the
+/// textures (all of them are whenever frames were skipped), or the whole images every frame.
+/// </summary>
+inline void KinectController::SetDirtyTileUploads(bool dirtyTilesOnly) {
+    this->uploadDirtyTilesOnly = dirtyTilesOnly;
+}
+
+/// <summary> Get the recent motion of the skeletons' joints, up to the newest skeleton frame handed over. </summary>
+inline const SkeletonHistory& KinectController::GetSkeletonHistory() const {
+    return this->skeletonHistory;
+}
+
+/// <summary>
+/// Predict every joint of every tracked skeleton for the given time (when the frame being rendered
+/// will be shown) and project them into the depth image, this should be called once per rendered frame.
+/// </summary>
+inline void KinectController::UpdateJoints(double displayTimeInMs) {
+    this->joints.Build(this->skeletonHistory, displayTimeInMs);
+}
+
+/// <summary> Get the joints of the tracked skeletons as of the last call to UpdateJoints. </summary>
+inline const SkeletonJointBatch& KinectController::GetJoints() const {
+    return this->joints;
+}
+
+/// <summary>
+/// Get when the frame currently in the colour/depth textures and skeleton was acquired from the
+/// kinect (see augengine::GetHighResTimeInMs), for measuring how stale it is once it's shown.
+/// </summary>
+inline double KinectController::GetFrameCaptureTimeInMs() const {
+    return this->frameCaptureTimeInMs;
+}
+
+/// <summary> Get the id of the depth frame in the depth texture, it goes up with every new depth frame. </summary>
+inline unsigned int KinectController::GetDepthFrameId() const {
+    return this->lastDepthFrameId;
+}
+
+/// <summary>
+/// Set whether the range of depths held in the depth texture follows the depths in the scene
+/// (see DepthRangeCalibrator), when disabled the range stays where calibration left it.
+/// </summary>
+inline void KinectController::SetRangeCalibration(bool isEnabled) {
+    InterlockedExchange(&this->isRangeCalibrationEnabled, isEnabled ? 1 : 0);
+}
+
 inline float KinectController::GetNearDistanceInMillimeters() const {
     return this->nearDistanceInMm;
 }
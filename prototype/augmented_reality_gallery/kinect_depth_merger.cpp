@@ -0,0 +1,175 @@
+// Augmented Gallery Includes
+#include <kinect_depth_merger.h>
+
+KinectDepthMerger::KinectDepthMerger(int numSensors, int width, int height) :
+width(width), height(height),
+focalLengthInPixels(NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS * width / 320.0f),
+sensorPoses(numSensors), reprojectedDepths(numSensors, NULL), otherDepthsInMm(numSensors - 1, NULL) {
+    assert(numSensors > 0);
+    assert(width > 0 && height > 0);
+
+    // Allocate all the reprojected depth buffers up front so the capture threads never have to
+    for (int i = 0; i < numSensors; i++) {
+        if (i == REFERENCE_SENSOR_IDX) {
+            continue;
+        }
+        this->reprojectedDepths[i] = new TripleBuffer<std::vector<USHORT> >();
+        for (size_t j = 0; j < 3; j++) {
+            this->reprojectedDepths[i]->GetBuffer(j).resize(width*height, 0);
+        }
+    }
+}
+
+KinectDepthMerger::~KinectDepthMerger() {
+    for (size_t i = 0; i < this->reprojectedDepths.size(); i++) {
+        if (this->reprojectedDepths[i] != NULL) {
+            delete this->reprojectedDepths[i];
+            this->reprojectedDepths[i] = NULL;
+        }
+    }
+}
+
+/// <summary>
+/// Load the poses of the sensors from the given file, each line holds the pose of one sensor:
+///   <sensor index> <yaw> <pitch> <roll> <x> <y> <z>
+/// Where the angles are in degrees (about the y, x and z axes, applied in that order) and the
+/// translation is in mm, lines starting with '#' are ignored. Sensors without a line keep their pose.
+/// This must be called before any of the capture threads use the merger.
+/// </summary>
+/// <returns> true if the file was loaded, false if it couldn't be read or has a bad line. </returns>
+bool KinectDepthMerger::LoadSensorPoses(const std::string& filepath) {
+    std::ifstream poseFile(filepath.c_str());
+    if (!poseFile.is_open()) {
+        std::cerr << "Failed to open sensor pose file: " << filepath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(poseFile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream lineStream(line);
+        int sensorIdx;
+        float yaw, pitch, roll;
+        Eigen::Vector3f translationInMm;
+        if (!(lineStream >> sensorIdx >> yaw >> pitch >> roll >> translationInMm[0] >> translationInMm[1] >> translationInMm[2]) ||
+            sensorIdx < 0 || sensorIdx >= this->GetNumSensors() || sensorIdx == REFERENCE_SENSOR_IDX) {
+            std::cerr << "Bad sensor pose in " << filepath << ": " << line << std::endl;
+            return false;
+        }
+
+        static const float DEGREES_TO_RADIANS = static_cast<float>(M_PI) / 180.0f;
+        Eigen::Matrix3f rotation;
+        rotation = Eigen::AngleAxisf(yaw   * DEGREES_TO_RADIANS, Eigen::Vector3f::UnitY()) *
+                   Eigen::AngleAxisf(pitch * DEGREES_TO_RADIANS, Eigen::Vector3f::UnitX()) *
+                   Eigen::AngleAxisf(roll  * DEGREES_TO_RADIANS, Eigen::Vector3f::UnitZ());
+        this->SetSensorPose(sensorIdx, rotation, translationInMm);
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Set the pose that takes points from the given sensor's camera space (skeleton space axes, in mm)
+/// into the reference sensor's. This must be called before any of the capture threads use the merger.
+/// </summary>
+void KinectDepthMerger::SetSensorPose(int sensorIdx, const Eigen::Matrix3f& rotation,
+                                      const Eigen::Vector3f& translationInMm) {
+    assert(sensorIdx >= 0 && sensorIdx < this->GetNumSensors());
+    assert(sensorIdx != REFERENCE_SENSOR_IDX);
+    this->sensorPoses[sensorIdx].rotation = rotation;
+    this->sensorPoses[sensorIdx].translationInMm = translationInMm;
+}
+
+/// <summary>
+/// Reproject the given depth image (in mm, the size of the merger) of the given (non-reference)
+/// sensor into the reference sensor's view and hand it off to the reference sensor's capture thread.
+/// This must only be called from the given sensor's capture thread.
+/// </summary>
+void KinectDepthMerger::SubmitDepth(int sensorIdx, const USHORT* depthInMm) {
+    assert(sensorIdx >= 0 && sensorIdx < this->GetNumSensors());
+    assert(sensorIdx != REFERENCE_SENSOR_IDX);
+    assert(depthInMm != NULL);
+
+    TripleBuffer<std::vector<USHORT> >& reprojectedDepth = *this->reprojectedDepths[sensorIdx];
+    std::vector<USHORT>& reprojectedDepthsInMm = reprojectedDepth.GetWriteBuffer();
+    std::fill(reprojectedDepthsInMm.begin(), reprojectedDepthsInMm.end(), 0);
+
+    const SensorPose& pose = this->sensorPoses[sensorIdx];
+    const Eigen::Vector3f xAxis = pose.rotation.col(0);
+    const float halfWidth  = this->width  * 0.5f;
+    const float halfHeight = this->height * 0.5f;
+    const float invFocalLength = 1.0f / this->focalLengthInPixels;
+
+    for (int y = 0; y < this->height; y++) {
+        // The ray through each pixel (at unit depth) is rotated a row at a time
+        float v = (halfHeight - y) * invFocalLength;
+        Eigen::Vector3f rowRay = pose.rotation.col(1) * v + pose.rotation.col(2);
+
+        const USHORT* depthRow = depthInMm + y*this->width;
+        for (int x = 0; x < this->width; x++) {
+            if (depthRow[x] == 0) {
+                continue;
+            }
+
+            float u = (x - halfWidth) * invFocalLength;
+            Eigen::Vector3f point = (rowRay + xAxis * u) * depthRow[x] + pose.translationInMm;
+            if (point[2] <= 0.0f) {
+                continue;
+            }
+
+            float projectionScale = this->focalLengthInPixels / point[2];
+            int reprojectedX = static_cast<int>(halfWidth  + point[0] * projectionScale + 0.5f);
+            int reprojectedY = static_cast<int>(halfHeight - point[1] * projectionScale + 0.5f);
+            if (reprojectedX < 0 || reprojectedX >= this->width || reprojectedY < 0 || reprojectedY >= this->height ||
+                point[2] >= USHRT_MAX) {
+                continue;
+            }
+
+            // Nearest depth wins where several pixels land on the same reference pixel
+            USHORT reprojectedDepthInMm = static_cast<USHORT>(point[2] + 0.5f);
+            USHORT& mergedDepthInMm = reprojectedDepthsInMm[reprojectedY*this->width + reprojectedX];
+            if (mergedDepthInMm == 0 || reprojectedDepthInMm < mergedDepthInMm) {
+                mergedDepthInMm = reprojectedDepthInMm;
+            }
+        }
+    }
+
+    reprojectedDepth.Publish();
+}
+
+/// <summary>
+/// Fill the holes in the given depth image (in mm, the size of the merger) of the reference sensor
+/// with the nearest of the newest reprojected depths of the other sensors. This must only be called
+/// from the reference sensor's capture thread.
+/// </summary>
+void KinectDepthMerger::Merge(USHORT* depthInMm) {
+    assert(depthInMm != NULL);
+
+    std::vector<const USHORT*>& otherDepthsInMm = this->otherDepthsInMm;
+    size_t numOtherDepths = 0;
+    for (size_t i = 0; i < this->reprojectedDepths.size(); i++) {
+        if (this->reprojectedDepths[i] == NULL) {
+            continue;
+        }
+        // The previous reprojected depths are used again if the sensor hasn't submitted new ones
+        this->reprojectedDepths[i]->Acquire();
+        otherDepthsInMm[numOtherDepths++] = &this->reprojectedDepths[i]->GetReadBuffer()[0];
+    }
+    assert(numOtherDepths == otherDepthsInMm.size());
+
+    size_t numPixels = this->width * this->height;
+    for (size_t i = 0; i < numPixels; i++) {
+        if (depthInMm[i] != 0) {
+            continue;
+        }
+        for (size_t j = 0; j < otherDepthsInMm.size(); j++) {
+            USHORT otherDepthInMm = otherDepthsInMm[j][i];
+            if (otherDepthInMm != 0 && (depthInMm[i] == 0 || otherDepthInMm < depthInMm[i])) {
+                depthInMm[i] = otherDepthInMm;
+            }
+        }
+    }
+}
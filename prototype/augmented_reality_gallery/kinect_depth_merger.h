@@ -0,0 +1,58 @@
+#ifndef KINECT_DEPTH_MERGER_H_
+#define KINECT_DEPTH_MERGER_H_
+
+// AugEngine Includes
+#include <common.h>
+#include <aug_3d_engine/triple_buffer.h>
+
+/// <summary>
+/// Fuses the depth images of several kinect sensors into the depth image of one (reference) sensor.
+/// Each of the other sensors has a pose (rotation and translation in mm) that takes points from its
+/// camera space into the reference sensor's camera space:
+///  - The capture thread of every other sensor reprojects its depth images into the reference
+///    sensor's view (using the nominal depth camera intrinsics, nearest depth wins) and hands them
+///    off through a triple buffer.
+///  - The capture thread of the reference sensor fills the holes in its depth images (pixels it has
+///    no depth for, e.g., where it is occluded or out of range) with the newest reprojected depths.
+/// The sensors aren't synchronized, so a merged depth image can be up to a frame behind on the other sensors.
+/// </summary>
+class KinectDepthMerger {
+public:
+    static const int REFERENCE_SENSOR_IDX = 0;
+
+    KinectDepthMerger(int numSensors, int width, int height);
+    ~KinectDepthMerger();
+
+    bool LoadSensorPoses(const std::string& filepath);
+    void SetSensorPose(int sensorIdx, const Eigen::Matrix3f& rotation, const Eigen::Vector3f& translationInMm);
+
+    int GetNumSensors() const;
+
+    // Capture thread methods
+    void SubmitDepth(int sensorIdx, const USHORT* depthInMm);
+    void Merge(USHORT* depthInMm);
+
+private:
+    // Pose of a sensor in the reference sensor's camera space
+    struct SensorPose {
+        SensorPose() : rotation(Eigen::Matrix3f::Identity()), translationInMm(Eigen::Vector3f::Zero()) {}
+
+        Eigen::Matrix3f rotation;
+        Eigen::Vector3f translationInMm;
+    };
+
+    int width, height;
+    float focalLengthInPixels;  // Nominal focal length of the depth camera at the merged resolution
+
+    std::vector<SensorPose> sensorPoses;
+    std::vector<TripleBuffer<std::vector<USHORT> >*> reprojectedDepths;  // Per sensor (owned by this), NULL for the reference sensor
+    std::vector<const USHORT*> otherDepthsInMm;     // Newest reprojected depths of the other sensors, only used by Merge
+
+    DISALLOW_COPY_AND_ASSIGN(KinectDepthMerger);
+};
+
+inline int KinectDepthMerger::GetNumSensors() const {
+    return static_cast<int>(this->sensorPoses.size());
+}
+
+#endif // KINECT_DEPTH_MERGER_H_
@@ -0,0 +1,75 @@
+#ifndef KINECT_FRAME_H_
+#define KINECT_FRAME_H_
+
+// AugEngine Includes
+#include <common.h>
+#include <aug_3d_engine/depth_pyramid.h>
+#include <aug_3d_engine/foreground_mask.h>
+#include <aug_3d_engine/dirty_tile_tracker.h>
+#include <aug_3d_engine/depth_mesh_generator.h>
+#include <aug_3d_engine/depth_normal_estimator.h>
+
+/// <summary>
+/// CPU-side results of capturing the kinect streams, produced on the KinectController's
+/// capture thread and handed to the render thread. Each stream has an id that increases every
+/// time a new frame of that stream is captured so the consumer can tell which streams changed.
+/// </summary>
+struct KinectFrame {
+    KinectFrame() : captureTimeInMs(0.0), processingTimeInMs(0.0), colourFrameId(0), depthFrameId(0),
+    nearDistanceInMm(0.0f), farDistanceInMm(0.0f), skeletonFrameId(0) {
+        memset(&this->skeletonFrame, 0, sizeof(this->skeletonFrame));
+    }
+
+    double captureTimeInMs;             // When the oldest of the colour/depth images was acquired (see augengine::GetHighResTimeInMs)
+    double processingTimeInMs;          // Time the capture thread spent filtering/registering the images and building the pyramid
+
+    unsigned int colourFrameId;
+    std::vector<BYTE> colourBuffer;     // BGRA colour image (lined up with the depth image if it was registered)
+    DirtyTiles dirtyColourTiles;        // Tiles of the colour image that changed since the previous frame
+
+    unsigned int depthFrameId;
+    std::vector<USHORT> depthBuffer;    // Raw depth image, in mm
+    DepthPyramid depthPyramid;          // Coarser views of the (filtered) depth image
+    ForegroundMask foregroundMask;      // Pixels of the depth image in front of the learned background
+    float nearDistanceInMm;             // Range of depths the depth image is converted over (see DepthRangeCalibrator)
+    float farDistanceInMm;
+    DirtyTiles dirtyDepthTiles;         // Tiles of the depth image that changed since the previous frame
+    DepthMesh depthMesh;                // Triangle mesh of the depth image, empty unless mesh generation is enabled
+    DepthNormalMap depthNormals;        // Surface normals of the (filtered) depth image
+    DirtyTiles dirtyNormalTiles;        // Tiles of the normals that changed since the previous frame
+
+    unsigned int skeletonFrameId;
+    NUI_SKELETON_FRAME skeletonFrame;
+
+    void CopyStaleStreamsFrom(const KinectFrame& newerFrame);
+};
+
+/// <summary>
+/// Copy every stream of the given frame that is newer than the one in this frame, this brings
+/// a recycled frame up-to-date without copying streams that haven't changed or were just captured.
+/// </summary>
+inline void KinectFrame::CopyStaleStreamsFrom(const KinectFrame& newerFrame) {
+    if (this->colourFrameId < newerFrame.colourFrameId) {
+        this->colourBuffer  = newerFrame.colourBuffer;
+        this->dirtyColourTiles = newerFrame.dirtyColourTiles;
+        this->colourFrameId = newerFrame.colourFrameId;
+    }
+    if (this->depthFrameId < newerFrame.depthFrameId) {
+        this->depthBuffer  = newerFrame.depthBuffer;
+        this->depthPyramid = newerFrame.depthPyramid;
+        this->foregroundMask = newerFrame.foregroundMask;
+        this->nearDistanceInMm = newerFrame.nearDistanceInMm;
+        this->farDistanceInMm  = newerFrame.farDistanceInMm;
+        this->dirtyDepthTiles  = newerFrame.dirtyDepthTiles;
+        this->depthMesh        = newerFrame.depthMesh;
+        this->depthNormals     = newerFrame.depthNormals;
+        this->dirtyNormalTiles = newerFrame.dirtyNormalTiles;
+        this->depthFrameId = newerFrame.depthFrameId;
+    }
+    if (this->skeletonFrameId < newerFrame.skeletonFrameId) {
+        this->skeletonFrame   = newerFrame.skeletonFrame;
+        this->skeletonFrameId = newerFrame.skeletonFrameId;
+    }
+}
+
+#endif // KINECT_FRAME_H_
@@ -0,0 +1,110 @@
+// Augmented Gallery Includes
+#include <kinect_frame_pairer.h>
+
+KinectFramePairer::KinectFramePairer(size_t colourBufferSize, size_t depthBufferSize, bool hasSkeletonFrames) :
+maxSkewInMs(DEFAULT_MAX_SKEW_IN_MS), hasSkeletonFrames(hasSkeletonFrames) {
+    // Allocate all the queued frames up front so that pairing frames never allocates
+    for (size_t i = 0; i < MAX_QUEUED_FRAMES; i++) {
+        this->colourFrames.GetPayload(i).resize(colourBufferSize);
+        this->depthFrames.GetPayload(i).resize(depthBufferSize);
+    }
+}
+
+KinectFramePairer::~KinectFramePairer() {
+}
+
+/// <summary> Queue a colour frame with the given sensor timestamp. </summary>
+/// <returns> The buffer that the colour frame's (BGRA) image must be copied into. </returns>
+std::vector<BYTE>& KinectFramePairer::PushColourFrame(LONGLONG timestamp, double captureTimeInMs) {
+    if (this->colourFrames.IsFull()) {
+        this->colourFrames.PopFront();
+        this->stats.numDroppedColourFrames++;
+    }
+    return this->colourFrames.PushBack(timestamp, captureTimeInMs);
+}
+
+/// <summary> Queue a depth frame with the given sensor timestamp. </summary>
+/// <returns> The buffer that the depth frame's (16-bit, in mm) image must be copied into. </returns>
+std::vector<USHORT>& KinectFramePairer::PushDepthFrame(LONGLONG timestamp, double captureTimeInMs) {
+    if (this->depthFrames.IsFull()) {
+        this->depthFrames.PopFront();
+        this->stats.numDroppedDepthFrames++;
+    }
+    return this->depthFrames.PushBack(timestamp, captureTimeInMs);
+}
+
+void KinectFramePairer::PushSkeletonFrame(const NUI_SKELETON_FRAME& skeletonFrame) {
+    if (this->skeletonFrames.IsFull()) {
+        this->skeletonFrames.PopFront();
+        this->stats.numDroppedSkeletonFrames++;
+    }
+    // Only the colour/depth capture times are used (see PopMatchedFrame)
+    this->skeletonFrames.PushBack(skeletonFrame.liTimeStamp.QuadPart, 0.0) = skeletonFrame;
+}
+
+/// <summary>
+/// Pop the oldest matched colour/depth (and skeleton) frames into the given frame, the colour and
+/// depth buffers are swapped with the given frame's so they must be the same size as the queued ones.
+/// When no skeleton frame matches the depth frame, the skeleton of the given frame is left untouched.
+/// A matched colour/depth pair waits for its skeleton frame until the next depth frame is queued
+/// (unless the pairer was told no skeleton frames are coming).
+/// </summary>
+/// <returns> true if matched frames were popped, false if there are no matched frames yet. </returns>
+bool KinectFramePairer::PopMatchedFrame(KinectFrame& frame, bool& hasSkeleton) {
+    LONGLONG maxSkewInMs = this->maxSkewInMs;
+
+    // Find the oldest colour and depth frames within the skew budget of each other, the older of
+    // two frames that don't match can't match anything that is queued later so it gets dropped
+    while (!this->colourFrames.IsEmpty() && !this->depthFrames.IsEmpty()) {
+        LONGLONG colourTimestamp = this->colourFrames.GetFrontTimestamp();
+        LONGLONG depthTimestamp  = this->depthFrames.GetFrontTimestamp();
+
+        if (colourTimestamp + maxSkewInMs < depthTimestamp) {
+            this->colourFrames.PopFront();
+            this->stats.numDroppedColourFrames++;
+        }
+        else if (depthTimestamp + maxSkewInMs < colourTimestamp) {
+            this->depthFrames.PopFront();
+            this->stats.numDroppedDepthFrames++;
+        }
+        else {
+            break;
+        }
+    }
+    if (this->colourFrames.IsEmpty() || this->depthFrames.IsEmpty()) {
+        return false;
+    }
+
+    // Drop any skeleton frames that are too old to match the depth frame
+    LONGLONG depthTimestamp = this->depthFrames.GetFrontTimestamp();
+    while (!this->skeletonFrames.IsEmpty() && this->skeletonFrames.GetFrontTimestamp() + maxSkewInMs < depthTimestamp) {
+        this->skeletonFrames.PopFront();
+        this->stats.numDroppedSkeletonFrames++;
+    }
+
+    hasSkeleton = !this->skeletonFrames.IsEmpty() && this->skeletonFrames.GetFrontTimestamp() <= depthTimestamp + maxSkewInMs;
+    if (!hasSkeleton && this->hasSkeletonFrames && this->skeletonFrames.IsEmpty() && this->depthFrames.GetSize() == 1) {
+        // The skeleton frame for the depth frame may still be on its way
+        return false;
+    }
+
+    assert(frame.colourBuffer.size() == this->colourFrames.GetFront().size());
+    assert(frame.depthBuffer.size() == this->depthFrames.GetFront().size());
+    frame.captureTimeInMs = std::min<double>(this->colourFrames.GetFrontCaptureTimeInMs(),
+                                             this->depthFrames.GetFrontCaptureTimeInMs());
+    frame.colourBuffer.swap(this->colourFrames.GetFront());
+    frame.depthBuffer.swap(this->depthFrames.GetFront());
+    this->colourFrames.PopFront();
+    this->depthFrames.PopFront();
+
+    if (hasSkeleton) {
+        frame.skeletonFrame = this->skeletonFrames.GetFront();
+        this->skeletonFrames.PopFront();
+    }
+    else if (this->hasSkeletonFrames) {
+        this->stats.numUnmatchedSkeletons++;
+    }
+
+    this->stats.numMatchedFrames++;
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef KINECT_FRAME_PAIRER_H_
+#define KINECT_FRAME_PAIRER_H_
+
+// Augmented Gallery Includes
+#include <kinect_frame.h>
+
+// AugEngine Includes
+#include <common.h>
+
+/// <summary>
+/// Pairs up the colour, depth and skeleton frames captured from the kinect using their sensor
+/// timestamps, so that everything rendered for a frame comes from (nearly) the same instant.
+/// Frames are queued per stream and a frame is only emitted once a colour and depth frame
+/// within the skew budget of each other are found, along with a skeleton frame within the skew
+/// budget of the depth frame (if one turns up). Frames that can't be matched are dropped.
+/// This is only meant to be used from a single (capture) thread, except for the skew budget
+/// and the stats, which can be accessed from any thread.
+/// </summary>
+class KinectFramePairer {
+public:
+    static const LONG DEFAULT_MAX_SKEW_IN_MS = 20;
+
+    // Counts of what happened to the frames given to the pairer
+    struct Stats {
+        Stats() : numMatchedFrames(0), numSupersededFrames(0), numUnmatchedSkeletons(0), numDroppedColourFrames(0),
+            numDroppedDepthFrames(0), numDroppedSkeletonFrames(0) {}
+
+        volatile LONG numMatchedFrames;         // Colour/depth pairs that were emitted and delivered
+        volatile LONG numSupersededFrames;      // Emitted pairs that were dropped for a newer pair (see DropSupersededFrame)
+        volatile LONG numUnmatchedSkeletons;    // Emitted pairs that had no skeleton frame within the skew budget
+        volatile LONG numDroppedColourFrames;   // Colour frames that never matched a depth frame
+        volatile LONG numDroppedDepthFrames;    // Depth frames that never matched a colour frame
+        volatile LONG numDroppedSkeletonFrames; // Skeleton frames that never matched a depth frame
+    };
+
+    KinectFramePairer(size_t colourBufferSize, size_t depthBufferSize, bool hasSkeletonFrames = true);
+    ~KinectFramePairer();
+
+    void SetMaxSkewInMs(LONG maxSkewInMs);
+    LONG GetMaxSkewInMs() const;
+    const Stats& GetStats() const;
+
+    std::vector<BYTE>& PushColourFrame(LONGLONG timestamp, double captureTimeInMs);
+    std::vector<USHORT>& PushDepthFrame(LONGLONG timestamp, double captureTimeInMs);
+    void PushSkeletonFrame(const NUI_SKELETON_FRAME& skeletonFrame);
+
+    bool PopMatchedFrame(KinectFrame& frame, bool& hasSkeleton);
+    void DropSupersededFrame();
+
+private:
+    // Maximum number of frames queued per stream, the oldest frame is dropped when a queue is full
+    static const size_t MAX_QUEUED_FRAMES = 4;
+
+    /// <summary> Fixed size FIFO of frames of one stream, the frame payloads are allocated up front and recycled. </summary>
+    template <typename T>
+    class FrameQueue {
+    public:
+        FrameQueue() : frontIdx(0), size(0) {}
+
+        bool IsEmpty() const { return this->size == 0; }
+        bool IsFull() const { return this->size == MAX_QUEUED_FRAMES; }
+        size_t GetSize() const { return this->size; }
+        LONGLONG GetFrontTimestamp() const { assert(!this->IsEmpty()); return this->timestamps[this->frontIdx]; }
+        double GetFrontCaptureTimeInMs() const { assert(!this->IsEmpty()); return this->captureTimesInMs[this->frontIdx]; }
+        T& GetFront() { assert(!this->IsEmpty()); return this->payloads[this->frontIdx]; }
+        T& GetPayload(size_t idx) { return this->payloads[idx]; }
+
+        T& PushBack(LONGLONG timestamp, double captureTimeInMs) {
+            assert(!this->IsFull());
+            size_t backIdx = (this->frontIdx + this->size) % MAX_QUEUED_FRAMES;
+            this->timestamps[backIdx] = timestamp;
+            this->captureTimesInMs[backIdx] = captureTimeInMs;
+            this->size++;
+            return this->payloads[backIdx];
+        }
+        void PopFront() {
+            assert(!this->IsEmpty());
+            this->frontIdx = (this->frontIdx + 1) % MAX_QUEUED_FRAMES;
+            this->size--;
+        }
+
+    private:
+        T payloads[MAX_QUEUED_FRAMES];
+        LONGLONG timestamps[MAX_QUEUED_FRAMES];     // Sensor timestamps, in ms
+        double captureTimesInMs[MAX_QUEUED_FRAMES]; // When the frames were acquired (see augengine::GetHighResTimeInMs)
+        size_t frontIdx;
+        size_t size;
+    };
+
+    volatile LONG maxSkewInMs;
+    bool hasSkeletonFrames;     // Whether skeleton frames are coming at all, matched pairs don't wait for them otherwise
+    Stats stats;
+
+    FrameQueue<std::vector<BYTE> > colourFrames;
+    FrameQueue<std::vector<USHORT> > depthFrames;
+    FrameQueue<NUI_SKELETON_FRAME> skeletonFrames;
+
+    DISALLOW_COPY_AND_ASSIGN(KinectFramePairer);
+};
+
+/// <summary>
+/// Set the largest difference in sensor timestamps (in ms) between frames that are considered
+/// to come from the same instant. This is safe to call while frames are being paired.
+/// </summary>
+inline void KinectFramePairer::SetMaxSkewInMs(LONG maxSkewInMs) {
+    assert(maxSkewInMs >= 0);
+    InterlockedExchange(&this->maxSkewInMs, maxSkewInMs);
+}
+
+inline LONG KinectFramePairer::GetMaxSkewInMs() const {
+    return this->maxSkewInMs;
+}
+
+inline const KinectFramePairer::Stats& KinectFramePairer::GetStats() const {
+    return this->stats;
+}
+
+/// <summary>
+/// Record that the last frame popped by PopMatchedFrame was overwritten by a newer matched frame
+/// before it could be delivered, so it is counted as dropped rather than matched.
+/// </summary>
+inline void KinectFramePairer::DropSupersededFrame() {
+    assert(this->stats.numMatchedFrames > 0);
+    this->stats.numMatchedFrames--;
+    this->stats.numSupersededFrames++;
+}
+
+#endif // KINECT_FRAME_PAIRER_H_
@@ -0,0 +1,74 @@
+#ifndef KINECT_FRAME_SOURCE_H_
+#define KINECT_FRAME_SOURCE_H_
+
+// AugEngine Includes
+#include <common.h>
+
+/// <summary>
+/// Describes a colour or depth image that has been acquired from a KinectFrameSource.
+/// The image data is owned by the frame source and is only valid until the frame is released.
+/// </summary>
+struct KinectImageFrame {
+    KinectImageFrame() : width(0), height(0), pitch(0), frameNumber(0), timestamp(0),
+        captureTimeInMs(0.0), data(NULL) {}
+
+    int width;              // Width of the image in pixels
+    int height;             // Height of the image in pixels
+    int pitch;              // Number of bytes per row of the image, zero if the image is bogus
+    DWORD frameNumber;      // Frame number assigned by the sensor
+    LONGLONG timestamp;     // Timestamp assigned by the sensor, in ms
+    double captureTimeInMs; // Time (see augengine::GetHighResTimeInMs) when the frame was acquired
+    const BYTE* data;       // Pointer to the first byte of the image
+};
+
+/// <summary>
+/// Abstract source of kinect colour, depth and skeleton frames. This decouples the
+/// KinectController from the kinect hardware so that frames can come from a live
+/// sensor or from a previously recorded session.
+/// </summary>
+class KinectFrameSource {
+public:
+    virtual ~KinectFrameSource() {}
+
+    virtual void GetColourResolution(int& width, int& height) const = 0;
+    virtual void GetDepthResolution(int& width, int& height) const = 0;
+
+    /// <summary> Block until a new frame may be available on any stream or until the given time has passed. </summary>
+    virtual void WaitForNextFrame(DWORD maxWaitInMs) = 0;
+
+    /// <summary> Acquire the next available colour frame (BGRA, 32-bits per pixel) without blocking. </summary>
+    /// <returns> true if a frame was acquired, it must then be released with ReleaseColourFrame. </returns>
+    virtual bool AcquireColourFrame(KinectImageFrame& frame) = 0;
+    virtual void ReleaseColourFrame() = 0;
+
+    /// <summary> Acquire the next available depth frame (16-bits per pixel, in mm) without blocking. </summary>
+    /// <returns> true if a frame was acquired, it must then be released with ReleaseDepthFrame. </returns>
+    virtual bool AcquireDepthFrame(KinectImageFrame& frame) = 0;
+    virtual void ReleaseDepthFrame() = 0;
+
+    /// <summary> Get the next available (smoothed) skeleton frame without blocking. </summary>
+    /// <returns> true if a new skeleton frame was copied into the given frame. </returns>
+    virtual bool GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame) = 0;
+
+    /// <summary> Whether the source produces skeleton frames at all (e.g., sensors without skeleton tracking don't). </summary>
+    virtual bool HasSkeletonFrames() const {
+        return true;
+    }
+
+    /// <summary>
+    /// Find the colour image pixel that sees the same point as the given depth image pixel at the given depth.
+    /// Sources without the sensor's calibration can't do this.
+    /// </summary>
+    /// <returns> true if the colour pixel was found. </returns>
+    virtual bool GetColourPixelFromDepthPixel(int depthX, int depthY, USHORT depthInMm,
+                                              int& colourX, int& colourY) const {
+        UNUSED_PARAMETER(depthX);
+        UNUSED_PARAMETER(depthY);
+        UNUSED_PARAMETER(depthInMm);
+        UNUSED_PARAMETER(colourX);
+        UNUSED_PARAMETER(colourY);
+        return false;
+    }
+};
+
+#endif // KINECT_FRAME_SOURCE_H_
@@ -0,0 +1,62 @@
+#ifndef KINECT_SESSION_FILE_H_
+#define KINECT_SESSION_FILE_H_
+
+// AugEngine Includes
+#include <common.h>
+
+/// <summary>
+/// Layout of a recorded kinect session file. A session file is a FileHeader followed by a
+/// sequence of records in the order they were captured, each record is a RecordHeader followed
+/// immediately by payloadSize bytes of frame data. Colour payloads are BGRA images, depth payloads
+/// are 16-bit images (in mm), encoded as given in the file header (see augengine::depthcodec), and
+/// skeleton payloads are a raw NUI_SKELETON_FRAME.
+/// Once the recording is finished, the records are followed by the index: an array of IndexEntry
+/// per stream (in stream order, each in capture order) that the file header points at. The index
+/// is meant to be used straight from a memory mapped file, so the file loads without parsing and
+/// any frame can be found in constant time. A file without an index (e.g., the recording app was
+/// killed) has a zero index offset, its records have to be scanned instead.
+/// Older versions of the file are a prefix of the current version's header:
+///  - Version 1 files have no depth encoding (their depth is raw) and no index.
+///  - Version 2 files have no index.
+/// </summary>
+namespace kinectsession {
+
+static const char MAGIC[4] = {'K', 'S', 'E', 'S'};
+static const unsigned int FILE_VERSION = 3;
+static const unsigned int RAW_DEPTH_FILE_VERSION = 1;
+static const unsigned int UNINDEXED_FILE_VERSION = 2;
+
+enum StreamType { ColourStream = 0, DepthStream = 1, SkeletonStream = 2, NumStreamTypes = 3 };
+enum DepthEncoding { RawDepth = 0, DepthCodec = 1 };
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[4];
+    unsigned int version;
+    int colourWidth, colourHeight;
+    int depthWidth, depthHeight;
+    unsigned int depthEncoding; // One of the DepthEncoding enum values (not in version 1 files)
+
+    // Not in version 1 or 2 files
+    ULONGLONG indexOffset;                      // Offset of the index in the file, zero if there is no index
+    unsigned int numRecords[NumStreamTypes];    // Number of index entries of each stream
+};
+
+struct RecordHeader {
+    unsigned int streamType;    // One of the StreamType enum values
+    unsigned int frameNumber;   // Frame number assigned by the sensor
+    LONGLONG timestamp;         // Timestamp assigned by the sensor, in ms
+    double captureTimeInMs;     // Capture time relative to the start of the recording, in ms
+    int width, height, pitch;   // Image dimensions (zero for skeleton records)
+    unsigned int payloadSize;   // Number of bytes of frame data following this header
+};
+
+struct IndexEntry {
+    RecordHeader header;
+    ULONGLONG payloadOffset;    // Offset of the record's frame data in the file
+};
+#pragma pack(pop)
+
+}; // namespace kinectsession
+
+#endif // KINECT_SESSION_FILE_H_
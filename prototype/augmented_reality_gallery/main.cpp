@@ -2,6 +2,11 @@
 
 #include <common.h>
 #include <kinect_controller.h>
+#include <nui_kinect_frame_source.h>
+#include <replay_kinect_frame_source.h>
+#include <recording_kinect_frame_source.h>
+#include <kinect_depth_merger.h>
+#include <depth_mesh_debug_renderer.h>
 
 // AugEngine Includes
 #include <aug_3d_engine/common.h>
@@ -10,6 +15,11 @@
 #include <aug_3d_engine/texture_2d.h>
 #include <aug_3d_engine/common_geometry_helper.h>
 #include <aug_3d_engine/cgfx_render_depth_geometry.h>
+#include <aug_3d_engine/depth_grid_mesh.h>
+#include <aug_3d_engine/depth_quadtree_mesh.h>
+#include <aug_3d_engine/high_res_timer.h>
+#include <aug_3d_engine/latency_histogram.h>
+#include <aug_3d_engine/thread_pool.h>
 
 // TODO: Fix the upscaling - transforms are not working out right when the resolution of
 // the window is different from that of the depth/colour textures
@@ -27,13 +37,24 @@ bool	fullscreen=TRUE;	// Fullscreen Flag Set To Fullscreen Mode By Default
 
 LRESULT	CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);	// Declaration For WndProc
 
-KinectController* kinect = NULL;
+KinectController* kinect = NULL;                // Controller of the reference sensor, the one that is shown
+std::vector<KinectController*> otherKinects;    // Controllers of any other sensors, their depth is merged into the reference sensor's
+KinectDepthMerger* depthMerger = NULL;          // NULL if there is only one sensor
+ThreadPool* frameProcessingPool = NULL;         // Shared by every sensor's controller, so there is one worker per core
+ReplayKinectFrameSource* replaySource = NULL;   // The session being played back (owned by the kinect controller), NULL if live
+
+// Number of frames skipped by one scrub through a played back session (5 seconds at 30 Hz)
+static const LONG SCRUB_FRAMES = 150;
 int windowWidth;
 int windowHeight;
 
 CgFxRenderDepthGeometry* depthGeometryRenderEffect = NULL;
 
-GLuint topographyDrawList = 0;
+DepthGridMesh* topographyMesh = NULL;
+DepthQuadtreeMesh* topographyLodMesh = NULL;    // Adaptive triangulation of the topography grid, drawn instead of it unless disabled
+unsigned int topographyLodDepthFrameId = 0;     // Id of the depth frame the LOD mesh was last updated for
+DepthMeshDebugRenderer* depthMeshRenderer = NULL;   // Draws the CPU depth mesh, which is only generated while it is shown
+unsigned int depthMeshDepthFrameId = 0;             // Id of the depth frame the depth mesh renderer was last updated for
 
 static const int NUM_HORIZ_VERTS = 640;
 static const int NUM_VERT_VERTS  = 480;
@@ -43,54 +64,272 @@ float rotateAmt = 0;
 
 Camera camera(1,1);
 
+// How stale the kinect frames are (time since they were acquired) when they reach each stage of being shown
+LatencyHistogram captureToUploadLatency("Capture to texture upload");
+LatencyHistogram captureToDrawLatency("Capture to geometry draw");
+LatencyHistogram captureToSwapLatency("Capture to buffer swap");
+
+// Options given on the command line
+struct CommandLineOptions {
+    CommandLineOptions() : playbackMode(ReplayKinectFrameSource::OriginalTiming), loopPlayback(false),
+        streamTextureUploads(true), maxFrameSkewInMs(KinectFramePairer::DEFAULT_MAX_SKEW_IN_MS),
+        temporalDepthFiltering(true), bilateralDepthFiltering(false),
+        colourRegistration(true), jointPrediction(true), numSensors(1), rangeCalibration(false), backgroundModelling(false),
+        dirtyTileUploads(true), meshGeneration(false), lodMeshing(true), normalEstimation(true) {}
+
+    std::string replayFilepath;
+    std::string recordFilepath;
+    ReplayKinectFrameSource::PlaybackMode playbackMode;
+    bool loopPlayback;
+    bool streamTextureUploads;
+    LONG maxFrameSkewInMs;
+    std::string latencyLogFilepath;
+    bool temporalDepthFiltering;
+    bool bilateralDepthFiltering;
+    bool colourRegistration;
+    bool jointPrediction;
+    int numSensors;
+    std::string sensorPosesFilepath;
+    bool rangeCalibration;
+    bool backgroundModelling;
+    bool dirtyTileUploads;
+    bool meshGeneration;
+    bool lodMeshing;
+    bool normalEstimation;
+};
+
+CommandLineOptions options;
+
+bool showDebugSubscreens = true;    // Whether the kinect colour/depth/skeleton textures are shown in the corner
+
+/// <summary>
+/// Parse the command line arguments:
+///   --replay <session file>   Play back a recorded session instead of using the live sensor
+///   --fast                    Play back the recorded session as fast as possible (for benchmarking)
+///   --loop                    Restart the recorded session once it has finished playing
+///   --record <session file>   Record all frames from the sensor (or replayed session) to a session file
+///   --sync-uploads            Upload the kinect textures synchronously instead of streaming them (for comparison)
+///   --full-uploads            Upload the whole kinect images every frame instead of only their changed tiles (for comparison)
+///   --max-skew <ms>           Largest difference in sensor timestamps between colour/depth/skeleton frames shown together
+///   --latency-log <file>      Write the frame latency histograms to the given file on exit (and when printing them)
+///   --no-temporal-filter      Don't filter the depth images over time
+///   --bilateral-filter        Filter the depth images guided by the colour images to line up their edges
+///   --no-registration         Don't resample the colour images to line up with the depth images
+///   --no-joint-prediction     Use the newest skeleton frame's joints instead of predicting them for the display time
+///   --sensors <n>             Use the first n attached sensors, the depth of the others is merged into the first one's
+///   --sensor-poses <file>     Load the poses of the other sensors relative to the first one (see KinectDepthMerger::LoadSensorPoses)
+///   --calibrate-range         Fit the near/far distances of the depth textures and geometry to the depths in the scene
+///   --background-model        Learn the static scene and mark the depth in front of it (for CPU-side consumers)
+///   --cpu-mesh                Generate a triangle mesh of every depth image on the CPU and draw it as a wireframe (F7 toggles it)
+///   --no-lod                  Draw the topography as the full grid instead of adapting its triangles to the depth
+///   --no-normals              Don't estimate the surface normals of the depth images, the geometry is shaded as facing the sensor
+/// </summary>
+CommandLineOptions ParseCommandLine(const std::string& cmdLine) {
+    CommandLineOptions cmdLineOptions;
+
+    std::istringstream argStream(cmdLine);
+    std::string currArg;
+    while (argStream >> currArg) {
+        if (currArg == "--replay") {
+            argStream >> cmdLineOptions.replayFilepath;
+        }
+        else if (currArg == "--record") {
+            argStream >> cmdLineOptions.recordFilepath;
+        }
+        else if (currArg == "--fast") {
+            cmdLineOptions.playbackMode = ReplayKinectFrameSource::AsFastAsPossible;
+        }
+        else if (currArg == "--loop") {
+            cmdLineOptions.loopPlayback = true;
+        }
+        else if (currArg == "--sync-uploads") {
+            cmdLineOptions.streamTextureUploads = false;
+        }
+        else if (currArg == "--full-uploads") {
+            cmdLineOptions.dirtyTileUploads = false;
+        }
+        else if (currArg == "--max-skew") {
+            argStream >> cmdLineOptions.maxFrameSkewInMs;
+        }
+        else if (currArg == "--latency-log") {
+            argStream >> cmdLineOptions.latencyLogFilepath;
+        }
+        else if (currArg == "--no-temporal-filter") {
+            cmdLineOptions.temporalDepthFiltering = false;
+        }
+        else if (currArg == "--bilateral-filter") {
+            cmdLineOptions.bilateralDepthFiltering = true;
+        }
+        else if (currArg == "--no-registration") {
+            cmdLineOptions.colourRegistration = false;
+        }
+        else if (currArg == "--no-joint-prediction") {
+            cmdLineOptions.jointPrediction = false;
+        }
+        else if (currArg == "--sensors") {
+            argStream >> cmdLineOptions.numSensors;
+        }
+        else if (currArg == "--sensor-poses") {
+            argStream >> cmdLineOptions.sensorPosesFilepath;
+        }
+        else if (currArg == "--calibrate-range") {
+            cmdLineOptions.rangeCalibration = true;
+        }
+        else if (currArg == "--cpu-mesh") {
+            cmdLineOptions.meshGeneration = true;
+        }
+        else if (currArg == "--no-lod") {
+            cmdLineOptions.lodMeshing = false;
+        }
+        else if (currArg == "--no-normals") {
+            cmdLineOptions.normalEstimation = false;
+        }
+        else if (currArg == "--background-model") {
+            cmdLineOptions.backgroundModelling = true;
+        }
+        else {
+            std::cerr << "Unknown command line argument: " << currArg << std::endl;
+        }
+    }
+
+    return cmdLineOptions;
+}
+
+/// <summary> Build the source of kinect frames based on the command line options. </summary>
+KinectFrameSource* BuildKinectFrameSource(const CommandLineOptions& cmdLineOptions) {
+    KinectFrameSource* frameSource = NULL;
+    if (cmdLineOptions.replayFilepath.empty()) {
+        frameSource = NuiKinectFrameSource::Build();
+    }
+    else {
+        replaySource = ReplayKinectFrameSource::Build(cmdLineOptions.replayFilepath,
+            cmdLineOptions.playbackMode, cmdLineOptions.loopPlayback);
+        frameSource = replaySource;
+    }
+
+    if (frameSource != NULL && !cmdLineOptions.recordFilepath.empty()) {
+        frameSource = RecordingKinectFrameSource::Build(frameSource, cmdLineOptions.recordFilepath);
+        if (frameSource == NULL) {
+            replaySource = NULL;
+        }
+    }
+
+    return frameSource;
+}
+
+/// <summary> Write the frame latency histograms to the latency log file (if one was given). </summary>
+void WriteLatencyLog() {
+    if (options.latencyLogFilepath.empty()) {
+        return;
+    }
+
+    std::ofstream latencyLog(options.latencyLogFilepath.c_str());
+    if (!latencyLog.is_open()) {
+        std::cerr << "Failed to open latency log file: " << options.latencyLogFilepath << std::endl;
+        return;
+    }
+    captureToUploadLatency.WriteBuckets(latencyLog);
+    captureToDrawLatency.WriteBuckets(latencyLog);
+    captureToSwapLatency.WriteBuckets(latencyLog);
+}
+
+/// <summary> Apply the command line options to the given kinect controller. </summary>
+void ConfigureKinect(KinectController* kinectController) {
+    kinectController->SetStreamingTextureUploads(options.streamTextureUploads);
+    kinectController->SetDirtyTileUploads(options.dirtyTileUploads);
+    kinectController->SetMaxFrameSkewInMs(options.maxFrameSkewInMs);
+    kinectController->SetTemporalDepthFiltering(options.temporalDepthFiltering);
+    kinectController->SetBilateralDepthFiltering(options.bilateralDepthFiltering);
+    kinectController->SetColourRegistration(options.colourRegistration);
+    kinectController->SetRangeCalibration(options.rangeCalibration);
+    kinectController->SetBackgroundModelling(options.backgroundModelling);
+    kinectController->SetMeshGeneration(options.meshGeneration);
+    kinectController->SetNormalEstimation(options.normalEstimation);
+}
+
+/// <summary>
+/// Get the number of sensors to use, multiple sensors are only supported live and limited
+/// to the number of sensors attached.
+/// </summary>
+int GetNumSensors() {
+    if (options.numSensors <= 1) {
+        return 1;
+    }
+    if (!options.replayFilepath.empty()) {
+        std::cerr << "Only one sensor can be replayed, ignoring --sensors." << std::endl;
+        return 1;
+    }
+
+    int numAttachedSensors = NuiKinectFrameSource::GetNumSensors();
+    if (numAttachedSensors < options.numSensors) {
+        std::cerr << "Only " << numAttachedSensors << " kinect sensor(s) attached." << std::endl;
+        return std::max<int>(1, numAttachedSensors);
+    }
+    return options.numSensors;
+}
+
 void InitKinect() {
-    kinect = KinectController::Build();
+    KinectFrameSource* frameSource = BuildKinectFrameSource(options);
+
+    // The capture threads take turns on the pool rather than each sensor starting a worker per core
+    frameProcessingPool = ThreadPool::Build();
+    if (frameProcessingPool == NULL) {
+        std::cerr << "Failed to start the frame processing threads." << std::endl;
+        exit(-1);
+    }
+
+    // Every other sensor gets its own controller (and capture thread), only the reference sensor tracks skeletons
+    int numSensors = GetNumSensors();
+    if (frameSource != NULL && numSensors > 1) {
+        int depthWidth, depthHeight;
+        frameSource->GetDepthResolution(depthWidth, depthHeight);
+        depthMerger = new KinectDepthMerger(numSensors, depthWidth, depthHeight);
+        if (!options.sensorPosesFilepath.empty() && !depthMerger->LoadSensorPoses(options.sensorPosesFilepath)) {
+            exit(-1);
+        }
+
+        for (int i = 0; i < numSensors; i++) {
+            if (i == KinectDepthMerger::REFERENCE_SENSOR_IDX) {
+                continue;
+            }
+            KinectController* otherKinect = KinectController::Build(NuiKinectFrameSource::Build(i, false),
+                                                                    frameProcessingPool, depthMerger, i);
+            if (otherKinect == NULL) {
+                std::cerr << "Failed to initialize kinect sensor " << i << "." << std::endl;
+                exit(-1);
+            }
+            ConfigureKinect(otherKinect);
+            otherKinects.push_back(otherKinect);
+        }
+    }
+
+    kinect = KinectController::Build(frameSource, frameProcessingPool, depthMerger,
+                                     KinectDepthMerger::REFERENCE_SENSOR_IDX);
     if (kinect == NULL) {
         std::cerr << "Failed to initialize kinect." << std::endl;
         exit(-1);
     }
+    ConfigureKinect(kinect);
 
     depthGeometryRenderEffect = new CgFxRenderDepthGeometry(kinect->GetDepthTexture(),
-        kinect->GetColourTexture(), kinect->GetNearDistanceInMillimeters() / 10.0f,
-        kinect->GetFarDistanceInMillimeters() / 10.0f);
-
-    size_t numHorizontalVerts = kinect->GetDepthTexture()->GetWidth();
-    size_t numVerticalVerts   = kinect->GetDepthTexture()->GetHeight();
-    assert(numHorizontalVerts > 0 && numVerticalVerts > 0);
-
-    //static const float NEG_HALF_H = - LEVEL_H_SIZE * NUM_HORIZ_VERTS / 2.0f;
-    //static const float NEG_HALF_V = - LEVEL_V_SIZE * NUM_VERT_VERTS / 2.0f;
+        kinect->GetColourTexture(), kinect->GetNormalTexture(), kinect->GetDepthFocalLengthInPixels(),
+        kinect->GetNearDistanceInMillimeters() / 10.0f, kinect->GetFarDistanceInMillimeters() / 10.0f);
+
+    // The topography is a grid with a vertex for every depth pixel, displaced by the depth texture
+    topographyMesh = DepthGridMesh::Build(static_cast<int>(kinect->GetDepthTexture()->GetWidth()),
+                                          static_cast<int>(kinect->GetDepthTexture()->GetHeight()), TRI_SIZE);
+    if (topographyMesh == NULL) {
+        std::cerr << "Failed to build the topography mesh." << std::endl;
+        exit(-1);
+    }
+    topographyLodMesh = new DepthQuadtreeMesh(topographyMesh);
+    topographyLodDepthFrameId = 0;
 
-    topographyDrawList = glGenLists(1);
-    glNewList(topographyDrawList, GL_COMPILE);
-    
-    float currX = 0.0f;
-    float currY = 0.0f;
-    float tempXTexCoord = 0.0f;
-
-    glNormal3f(0, 0, 1.0f);
-    glPointSize(3.0f);
-    glBegin(GL_POINTS);
-    for (size_t i = 0; i < numVerticalVerts-1; i++) {
-        
-        //glBegin(GL_TRIANGLE_STRIP);
-        for (size_t j = 0; j < numHorizontalVerts; j++) {
-            tempXTexCoord = static_cast<float>(j) / static_cast<float>(numHorizontalVerts-1);
-
-            glTexCoord2f(tempXTexCoord, static_cast<float>(i+1) / static_cast<float>(numVerticalVerts-1));
-            glVertex3f(currX, currY + TRI_SIZE, 0.0f);
-            glTexCoord2f(tempXTexCoord, static_cast<float>(i) / static_cast<float>(numVerticalVerts-1));
-            glVertex3f(currX, currY, 0.0f);
-
-            currX += TRI_SIZE;
-        }
-        //glEnd();
-        currY += TRI_SIZE;
-        currX = 0;
+    depthMeshRenderer = DepthMeshDebugRenderer::Build();
+    if (depthMeshRenderer == NULL) {
+        exit(-1);
     }
-    glEnd();
-    
-    glEndList();
+    depthMeshDepthFrameId = 0;
 
     augengine::debug_opengl_state();
 }
@@ -99,9 +338,36 @@ void KillKinect() {
     assert(kinect != NULL);
     delete kinect;
     kinect = NULL;
+    replaySource = NULL;
+
+    // The depth merger and thread pool go last, every sensor's capture thread uses them
+    for (size_t i = 0; i < otherKinects.size(); i++) {
+        delete otherKinects[i];
+    }
+    otherKinects.clear();
+    if (depthMerger != NULL) {
+        delete depthMerger;
+        depthMerger = NULL;
+    }
+    delete frameProcessingPool;
+    frameProcessingPool = NULL;
 
     delete depthGeometryRenderEffect;
     depthGeometryRenderEffect = NULL;
+    delete topographyLodMesh;
+    topographyLodMesh = NULL;
+    delete depthMeshRenderer;
+    depthMeshRenderer = NULL;
+    delete topographyMesh;
+    topographyMesh = NULL;
+}
+
+/// <summary> Get the mesh the topography is drawn with, the LOD mesh unless it is disabled. </summary>
+const DepthDisplacedMesh& GetTopographyMesh() {
+    if (options.lodMeshing) {
+        return *topographyLodMesh;
+    }
+    return *topographyMesh;
 }
 
 // Resize And Initialize The GL Window
@@ -132,19 +398,34 @@ void InitGL() {
 float temp = -80;
 float multiplier = -1;
 
-// Here's Where We Do All The Drawing
-void DrawGLScene() {
+// Here's Where We Do All The Drawing, returns whether a new kinect frame was drawn
+bool DrawGLScene() {
     // Poll the kinect controller and get the colour and depth textures from it
-    kinect->PollController();
+    bool newKinectFrame = kinect->PollController();
+    if (newKinectFrame) {
+        captureToUploadLatency.AddSample(augengine::GetHighResTimeInMs() - kinect->GetFrameCaptureTimeInMs());
+    }
+    // The other sensors' depth is merged on the capture threads, they are only polled for their stats
+    for (size_t i = 0; i < otherKinects.size(); i++) {
+        otherKinects[i]->PollController();
+    }
+    // Rebuild the LOD mesh where the depth changed (everywhere if depth frames were skipped)
+    if (options.lodMeshing && kinect->GetDepthFrameId() != topographyLodDepthFrameId) {
+        topographyLodMesh->Update(kinect->GetDepthPyramid(), kinect->GetDirtyDepthTiles());
+        topographyLodDepthFrameId = kinect->GetDepthFrameId();
+    }
     const Texture2D* colourTex          = kinect->GetColourTexture();
     const Texture2D* depthTex           = kinect->GetDepthTexture();
-    const Texture2D* skeletonDebugTex   = kinect->GetSkeletalDebugTexture();
 
     size_t depthTexWidth  = depthTex->GetWidth();
     size_t depthTexHeight = depthTex->GetHeight();
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // The depth geometry is converted over the same (possibly calibrated) range as the depth texture
+    depthGeometryRenderEffect->SetDistanceRangeInCm(kinect->GetNearDistanceInMillimeters() / 10.0f,
+                                                    kinect->GetFarDistanceInMillimeters()  / 10.0f);
+
     float nearDist = (kinect->GetNearDistanceInMillimeters() / 10.0f) - 10;
     float farDist  = (kinect->GetFarDistanceInMillimeters()  / 10.0f) + 10;
     assert(nearDist > 0);
@@ -171,7 +452,7 @@ void DrawGLScene() {
     // Draw depth topography geometry
 	glMatrixMode(GL_MODELVIEW);
     depthGeometryRenderEffect->SetTechnique(CgFxRenderDepthGeometry::GEOMETRY_ONLY_TECHNIQUE_NAME);
-    depthGeometryRenderEffect->Draw(camera, topographyDrawList);
+    depthGeometryRenderEffect->Draw(camera, GetTopographyMesh());
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
     // Draw a fullscreen quad of the coloured scene to lay over the geometry
@@ -189,7 +470,7 @@ void DrawGLScene() {
     // Draw colour buffer textured topology geometry
 	glMatrixMode(GL_MODELVIEW);
     glTranslatef(-0.5f*depthTexWidth*TRI_SIZE, -0.5f*depthTexHeight*TRI_SIZE, 0);
-    depthGeometryRenderEffect->Draw(topographyDrawList);
+    depthGeometryRenderEffect->Draw(camera, GetTopographyMesh());
 #endif
     glPopAttrib();
 
@@ -207,6 +488,16 @@ void DrawGLScene() {
 
     glMatrixMode(GL_MODELVIEW);
 
+    // Predict where the skeletons will be when this frame is shown, which is roughly as long from
+    // now as the frames have been taking to get from being drawn to being swapped
+    double displayTimeInMs = 0.0;
+    if (options.jointPrediction) {
+        displayTimeInMs = augengine::GetHighResTimeInMs() + std::max<double>(0.0,
+            captureToSwapLatency.GetPercentileInMs(50.0) - captureToDrawLatency.GetPercentileInMs(50.0));
+    }
+
+    kinect->UpdateJoints(displayTimeInMs);
+
     // We need to bring the hand position into the orthographic space
     Eigen::Vector3f handPos;
     bool foundHandPos = kinect->GetHandPos(depthTexWidth*TRI_SIZE, depthTexHeight*TRI_SIZE, handPos);
@@ -222,7 +513,10 @@ void DrawGLScene() {
     // Draw the virtual light buffer by blending the colours it generates onto the current framebuffer
     depthGeometryRenderEffect->SetTechnique(CgFxRenderDepthGeometry::SHADED_GEOMETRY_TECHNIQUE_NAME);
     
-    depthGeometryRenderEffect->Draw(camera, topographyDrawList);
+    depthGeometryRenderEffect->Draw(camera, GetTopographyMesh());
+    if (newKinectFrame) {
+        captureToDrawLatency.AddSample(augengine::GetHighResTimeInMs() - kinect->GetFrameCaptureTimeInMs());
+    }
 
     glPopAttrib();
 
@@ -265,16 +559,33 @@ void DrawGLScene() {
 
 
 
-    glPushAttrib(GL_CURRENT_BIT);
-    // Draw any debug textures as subscreen quads
-    glColor4f(1,1,1,1);
-    int currX = 10;
-    colourTex->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
-    currX += 10 + windowWidth/8;
-    depthTex->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
-    currX += 10 + windowWidth/8;
-    skeletonDebugTex->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
-    glPopAttrib();
+    // Draw the CPU depth mesh over everything, it's only generated while it is shown
+    if (options.meshGeneration) {
+        if (kinect->GetDepthFrameId() != depthMeshDepthFrameId) {
+            depthMeshRenderer->Update(kinect->GetDepthMesh());
+            depthMeshDepthFrameId = kinect->GetDepthFrameId();
+        }
+        glViewport(0, 0, windowWidth, windowHeight);
+        depthMeshRenderer->Draw(static_cast<int>(depthTexWidth), static_cast<int>(depthTexHeight),
+            kinect->GetDepthFocalLengthInPixels(), nearDist * 10.0f, farDist * 10.0f);
+    }
+
+    // Draw any debug textures as subscreen quads, the skeleton is only drawn into its texture when shown
+    if (showDebugSubscreens) {
+        kinect->UpdateSkeletalDebugTexture();
+
+        glPushAttrib(GL_CURRENT_BIT);
+        glColor4f(1,1,1,1);
+        int currX = 10;
+        colourTex->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
+        currX += 10 + windowWidth/8;
+        depthTex->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
+        currX += 10 + windowWidth/8;
+        kinect->GetSkeletalDebugTexture()->RenderToSubscreenQuad(currX, 10, windowWidth/8, windowHeight/8);
+        glPopAttrib();
+    }
+
+    return newKinectFrame;
 }
 
 // Properly Kill The Window
@@ -629,6 +940,7 @@ int WINAPI WinMain(	HINSTANCE	hInstance,			// Instance
 	}
     */
     fullscreen=FALSE;
+    options = ParseCommandLine(lpCmdLine);
 
 	// Create Our OpenGL Window
 	if (!CreateGLWindow("NeHe's OpenGL Framework", INIT_WIDTH, INIT_HEIGHT, fullscreen)) {
@@ -657,8 +969,11 @@ int WINAPI WinMain(	HINSTANCE	hInstance,			// Instance
 				done = TRUE;
 			}
 			else {
-				DrawGLScene();					// Draw The Scene
-				SwapBuffers(hDC);				// Swap Buffers (Double Buffering)
+				bool newKinectFrame = DrawGLScene();	// Draw The Scene
+				SwapBuffers(hDC);						// Swap Buffers (Double Buffering)
+				if (newKinectFrame) {
+					captureToSwapLatency.AddSample(augengine::GetHighResTimeInMs() - kinect->GetFrameCaptureTimeInMs());
+				}
 			}
 		}
 
@@ -672,6 +987,83 @@ int WINAPI WinMain(	HINSTANCE	hInstance,			// Instance
 			}
 		}
 
+        // Print how long the kinect texture uploads are stalling the render thread, how well
+        // the kinect frames are being paired up and how long processing them takes
+        if (keys[VK_F2]) {
+            keys[VK_F2] = FALSE;
+            kinect->PrintUploadStats(std::cout);
+            kinect->PrintPairingStats(std::cout);
+            kinect->PrintProcessingStats(std::cout);
+            for (size_t i = 0; i < otherKinects.size(); i++) {
+                otherKinects[i]->PrintPairingStats(std::cout);
+                otherKinects[i]->PrintProcessingStats(std::cout);
+            }
+            std::cout << "Topography: " << topographyLodMesh->GetNumTriangles() << " LOD triangles ("
+                      << topographyMesh->GetNumTriangles() << " in the full grid, LOD " << (options.lodMeshing ? "on" : "off")
+                      << "), " << topographyLodMesh->GetNumRebuiltTiles() << " tiles rebuilt by the last update" << std::endl;
+        }
+
+        // Print (and log) how stale the kinect frames are by the time they're shown
+        if (keys[VK_F3]) {
+            keys[VK_F3] = FALSE;
+            captureToUploadLatency.Print(std::cout);
+            captureToDrawLatency.Print(std::cout);
+            captureToSwapLatency.Print(std::cout);
+            WriteLatencyLog();
+        }
+
+        // Show/hide the debug subscreens
+        if (keys[VK_F4]) {
+            keys[VK_F4] = FALSE;
+            showDebugSubscreens = !showDebugSubscreens;
+        }
+
+        // Start/stop fitting the depth range to the scene (the range stays put while stopped)
+        if (keys[VK_F5]) {
+            keys[VK_F5] = FALSE;
+            options.rangeCalibration = !options.rangeCalibration;
+            kinect->SetRangeCalibration(options.rangeCalibration);
+            for (size_t i = 0; i < otherKinects.size(); i++) {
+                otherKinects[i]->SetRangeCalibration(options.rangeCalibration);
+            }
+            std::cout << "Depth range calibration " << (options.rangeCalibration ? "started" : "stopped") << std::endl;
+        }
+
+        // Switch between drawing the LOD and full topography meshes, the LOD mesh went stale while it wasn't drawn
+        if (keys[VK_F6]) {
+            keys[VK_F6] = FALSE;
+            options.lodMeshing = !options.lodMeshing;
+            if (options.lodMeshing) {
+                topographyLodMesh->Update(kinect->GetDepthPyramid(), NULL);
+                topographyLodDepthFrameId = kinect->GetDepthFrameId();
+            }
+            std::cout << "Topography LOD " << (options.lodMeshing ? "on" : "off") << std::endl;
+        }
+
+        // Show/hide the CPU depth mesh, it is only generated while it is shown
+        if (keys[VK_F7]) {
+            keys[VK_F7] = FALSE;
+            options.meshGeneration = !options.meshGeneration;
+            kinect->SetMeshGeneration(options.meshGeneration);
+            std::cout << "CPU depth mesh " << (options.meshGeneration ? "on" : "off") << std::endl;
+        }
+
+        // Scrub through the session being played back (if there is one)
+        if (replaySource != NULL) {
+            if (keys[VK_HOME]) {
+                keys[VK_HOME] = FALSE;
+                replaySource->RequestSeek(0);
+            }
+            if (keys[VK_PRIOR]) {
+                keys[VK_PRIOR] = FALSE;
+                replaySource->RequestSeek(replaySource->GetCurrentFrame() - SCRUB_FRAMES);
+            }
+            if (keys[VK_NEXT]) {
+                keys[VK_NEXT] = FALSE;
+                replaySource->RequestSeek(replaySource->GetCurrentFrame() + SCRUB_FRAMES);
+            }
+        }
+
         if (keys[VK_SUBTRACT]) {
             depthGeometryRenderEffect->Reload();
         }
@@ -702,6 +1094,7 @@ int WINAPI WinMain(	HINSTANCE	hInstance,			// Instance
 	}
 
     // Clean up
+    WriteLatencyLog();
 	KillGLWindow();
     KillKinect();
 
@@ -0,0 +1,178 @@
+// Augmented Gallery Includes
+#include <nui_kinect_frame_source.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/high_res_timer.h>
+
+const NUI_IMAGE_RESOLUTION NuiKinectFrameSource::COLOUR_RESOLUTION = NUI_IMAGE_RESOLUTION_640x480;
+const NUI_IMAGE_RESOLUTION NuiKinectFrameSource::DEPTH_RESOLUTION  = NUI_IMAGE_RESOLUTION_640x480;
+
+NuiKinectFrameSource::NuiKinectFrameSource() : nuiInstance(NULL), isTrackingSkeletons(false),
+colourStreamHandle(NULL), depthStreamHandle(NULL),
+colourImageFrame(NULL), depthImageFrame(NULL) {
+    for (int i = 0; i < NUM_FRAME_EVENTS; i++) {
+        this->nextFrameEvents[i] = CreateEvent(NULL, TRUE, FALSE, NULL);
+    }
+}
+
+NuiKinectFrameSource::~NuiKinectFrameSource() {
+    // Clean up any allocated frames and shutdown the sensor's instance of the kinect API
+    if (this->nuiInstance != NULL) {
+        this->ReleaseImageFrame(this->colourStreamHandle, this->colourImageFrame);
+        this->ReleaseImageFrame(this->depthStreamHandle, this->depthImageFrame);
+
+        this->nuiInstance->NuiShutdown();
+        MSR_NuiDestroyInstance(this->nuiInstance);
+        this->nuiInstance = NULL;
+    }
+
+    for (int i = 0; i < NUM_FRAME_EVENTS; i++) {
+        CloseHandle(this->nextFrameEvents[i]);
+        this->nextFrameEvents[i] = NULL;
+    }
+}
+
+/// <summary> Get the number of kinect sensors attached to this machine. </summary>
+int NuiKinectFrameSource::GetNumSensors() {
+    int numSensors = 0;
+    if (FAILED(MSR_NUIGetDeviceCount(&numSensors))) {
+        return 0;
+    }
+    return numSensors;
+}
+
+/// <summary>
+/// Build a frame source for the attached sensor with the given index (see GetNumSensors).
+/// Skeleton tracking can only be enabled on one sensor at a time, the others should only
+/// be used for their colour and depth.
+/// </summary>
+/// <returns> The new frame source, NULL on failure. </returns>
+NuiKinectFrameSource* NuiKinectFrameSource::Build(int sensorIdx, bool trackSkeletons) {
+    std::auto_ptr<NuiKinectFrameSource> newSource(new NuiKinectFrameSource());
+
+    HRESULT result = MSR_NuiCreateInstanceByIndex(sensorIdx, &newSource->nuiInstance);
+    if (FAILED(result)) {
+        std::cerr << "Failed to find kinect sensor " << sensorIdx << std::endl;
+        newSource->nuiInstance = NULL;
+        return NULL;
+    }
+    INuiInstance* nuiInstance = newSource->nuiInstance;
+
+    // Attempt to initialize the kinect API for the sensor
+    DWORD initFlags = NUI_INITIALIZE_FLAG_USES_COLOR | NUI_INITIALIZE_FLAG_USES_DEPTH;
+    if (trackSkeletons) {
+        initFlags |= NUI_INITIALIZE_FLAG_USES_SKELETON;
+    }
+    result = nuiInstance->NuiInitialize(initFlags);
+    if (FAILED(result)) {
+        std::cerr << "Failed to initialize kinect sensor " << sensorIdx << std::endl;
+        return NULL;
+    }
+
+    // Initialize the colour and depth buffers for the sensor
+    result = nuiInstance->NuiImageStreamOpen(NUI_IMAGE_TYPE_COLOR,               // RGB32
+                                             COLOUR_RESOLUTION,
+                                             0, 2,
+                                             newSource->nextFrameEvents[COLOUR_EVENT_IDX],
+                                             &newSource->colourStreamHandle);
+    if (FAILED(result)) {
+        std::cerr << "Failed to open colour image stream" << std::endl;
+        return NULL;
+    }
+
+    result = nuiInstance->NuiImageStreamOpen(NUI_IMAGE_TYPE_DEPTH,
+                                             DEPTH_RESOLUTION,
+                                             0, 2,
+                                             newSource->nextFrameEvents[DEPTH_EVENT_IDX],
+                                             &newSource->depthStreamHandle);
+    if (FAILED(result)) {
+        std::cerr << "Failed to open depth image stream" << std::endl;
+        return NULL;
+    }
+
+    // Initialize the skeleton tracking
+    if (trackSkeletons) {
+        result = nuiInstance->NuiSkeletonTrackingEnable(newSource->nextFrameEvents[SKELETON_EVENT_IDX], 0);
+        if (FAILED(result)) {
+            std::cerr << "Failed to enable skeletal tracking" << std::endl;
+            return NULL;
+        }
+        newSource->isTrackingSkeletons = true;
+    }
+
+    return newSource.release();
+}
+
+bool NuiKinectFrameSource::GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame) {
+    if (!this->isTrackingSkeletons) {
+        return false;
+    }
+
+    HRESULT result = this->nuiInstance->NuiSkeletonGetNextFrame(0, &frame);
+    if (FAILED(result)) {
+        return false;
+    }
+
+    this->nuiInstance->NuiTransformSmooth(&frame, NULL);
+    return true;
+}
+
+/// <summary> Map a depth pixel to a colour pixel using the sensor's calibration. </summary>
+bool NuiKinectFrameSource::GetColourPixelFromDepthPixel(int depthX, int depthY, USHORT depthInMm,
+                                                        int& colourX, int& colourY) const {
+    // The NUI API expects the depth pixel in a 320x240 depth image and the depth in the
+    // packed format of the depth stream (shifted past the player index bits)
+    DWORD depthWidth, depthHeight;
+    NuiImageResolutionToSize(DEPTH_RESOLUTION, depthWidth, depthHeight);
+
+    LONG x, y;
+    HRESULT result = this->nuiInstance->NuiImageGetColorPixelCoordinatesFromDepthPixel(COLOUR_RESOLUTION, NULL,
+        depthX * 320 / static_cast<LONG>(depthWidth), depthY * 240 / static_cast<LONG>(depthHeight),
+        static_cast<USHORT>(depthInMm << 3), &x, &y);
+    if (FAILED(result)) {
+        return false;
+    }
+
+    colourX = static_cast<int>(x);
+    colourY = static_cast<int>(y);
+    return true;
+}
+
+/// <summary> Poll the given kinect image stream for an available frame and lock its buffer. </summary>
+bool NuiKinectFrameSource::AcquireImageFrame(HANDLE streamHandle, const NUI_IMAGE_FRAME*& imageFrame,
+                                             KinectImageFrame& frame) {
+    this->ReleaseImageFrame(streamHandle, imageFrame);
+
+    HRESULT result = this->nuiInstance->NuiImageStreamGetNextFrame(streamHandle, 0, &imageFrame);
+    if (FAILED(result)) {
+        imageFrame = NULL;
+        return false;
+    }
+
+    KINECT_LOCKED_RECT lockedRect;
+    imageFrame->pFrameTexture->LockRect(0, &lockedRect, NULL, 0);
+
+    DWORD width, height;
+    NuiImageResolutionToSize(imageFrame->eResolution, width, height);
+
+    frame.width           = static_cast<int>(width);
+    frame.height          = static_cast<int>(height);
+    frame.pitch           = lockedRect.Pitch;
+    frame.frameNumber     = imageFrame->dwFrameNumber;
+    frame.timestamp       = imageFrame->liTimeStamp.QuadPart;
+    frame.captureTimeInMs = augengine::GetHighResTimeInMs();
+    frame.data            = static_cast<const BYTE*>(lockedRect.pBits);
+
+    return true;
+}
+
+/// <summary> Unlock and release the given kinect image frame (if there is one). </summary>
+void NuiKinectFrameSource::ReleaseImageFrame(HANDLE streamHandle, const NUI_IMAGE_FRAME*& imageFrame) {
+    if (imageFrame == NULL) {
+        return;
+    }
+
+    imageFrame->pFrameTexture->UnlockRect(0);
+    this->nuiInstance->NuiImageStreamReleaseFrame(streamHandle, imageFrame);
+    imageFrame = NULL;
+}
@@ -0,0 +1,100 @@
+#ifndef NUI_KINECT_FRAME_SOURCE_H_
+#define NUI_KINECT_FRAME_SOURCE_H_
+
+// Augmented Gallery Includes
+#include <kinect_frame_source.h>
+
+/// <summary>
+/// Frame source that reads its frames from a live kinect sensor through the NUI API. Every
+/// source has its own NUI instance, so one source can be built for each attached sensor.
+/// </summary>
+class NuiKinectFrameSource : public KinectFrameSource {
+public:
+    static int GetNumSensors();
+    static NuiKinectFrameSource* Build(int sensorIdx = 0, bool trackSkeletons = true);
+    ~NuiKinectFrameSource();
+
+    int GetSensorIndex() const;
+
+    void GetColourResolution(int& width, int& height) const;
+    void GetDepthResolution(int& width, int& height) const;
+
+    void WaitForNextFrame(DWORD maxWaitInMs);
+
+    bool AcquireColourFrame(KinectImageFrame& frame);
+    void ReleaseColourFrame();
+    bool AcquireDepthFrame(KinectImageFrame& frame);
+    void ReleaseDepthFrame();
+    bool GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame);
+    bool HasSkeletonFrames() const;
+
+    bool GetColourPixelFromDepthPixel(int depthX, int depthY, USHORT depthInMm, int& colourX, int& colourY) const;
+
+private:
+    static const NUI_IMAGE_RESOLUTION COLOUR_RESOLUTION;
+    static const NUI_IMAGE_RESOLUTION DEPTH_RESOLUTION;
+
+    NuiKinectFrameSource();
+
+    INuiInstance* nuiInstance;  // The NUI API instance of the sensor (owned by this)
+    bool isTrackingSkeletons;   // Whether skeleton tracking was enabled on the sensor
+
+    HANDLE colourStreamHandle;
+    HANDLE depthStreamHandle;
+
+    // Events signalled by the NUI runtime when a new frame is ready (colour, depth, skeleton)
+    enum { COLOUR_EVENT_IDX = 0, DEPTH_EVENT_IDX = 1, SKELETON_EVENT_IDX = 2, NUM_FRAME_EVENTS = 3 };
+    HANDLE nextFrameEvents[NUM_FRAME_EVENTS];
+
+    const NUI_IMAGE_FRAME* colourImageFrame;
+    const NUI_IMAGE_FRAME* depthImageFrame;
+
+    bool AcquireImageFrame(HANDLE streamHandle, const NUI_IMAGE_FRAME*& imageFrame, KinectImageFrame& frame);
+    void ReleaseImageFrame(HANDLE streamHandle, const NUI_IMAGE_FRAME*& imageFrame);
+
+    DISALLOW_COPY_AND_ASSIGN(NuiKinectFrameSource);
+};
+
+inline int NuiKinectFrameSource::GetSensorIndex() const {
+    return this->nuiInstance->InstanceIndex();
+}
+
+inline bool NuiKinectFrameSource::HasSkeletonFrames() const {
+    return this->isTrackingSkeletons;
+}
+
+inline void NuiKinectFrameSource::GetColourResolution(int& width, int& height) const {
+    DWORD w, h;
+    NuiImageResolutionToSize(COLOUR_RESOLUTION, w, h);
+    width  = static_cast<int>(w);
+    height = static_cast<int>(h);
+}
+
+inline void NuiKinectFrameSource::GetDepthResolution(int& width, int& height) const {
+    DWORD w, h;
+    NuiImageResolutionToSize(DEPTH_RESOLUTION, w, h);
+    width  = static_cast<int>(w);
+    height = static_cast<int>(h);
+}
+
+inline void NuiKinectFrameSource::WaitForNextFrame(DWORD maxWaitInMs) {
+    WaitForMultipleObjects(NUM_FRAME_EVENTS, this->nextFrameEvents, FALSE, maxWaitInMs);
+}
+
+inline bool NuiKinectFrameSource::AcquireColourFrame(KinectImageFrame& frame) {
+    return this->AcquireImageFrame(this->colourStreamHandle, this->colourImageFrame, frame);
+}
+
+inline void NuiKinectFrameSource::ReleaseColourFrame() {
+    this->ReleaseImageFrame(this->colourStreamHandle, this->colourImageFrame);
+}
+
+inline bool NuiKinectFrameSource::AcquireDepthFrame(KinectImageFrame& frame) {
+    return this->AcquireImageFrame(this->depthStreamHandle, this->depthImageFrame, frame);
+}
+
+inline void NuiKinectFrameSource::ReleaseDepthFrame() {
+    this->ReleaseImageFrame(this->depthStreamHandle, this->depthImageFrame);
+}
+
+#endif // NUI_KINECT_FRAME_SOURCE_H_
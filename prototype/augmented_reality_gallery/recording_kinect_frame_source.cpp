@@ -0,0 +1,196 @@
+// Augmented Gallery Includes
+#include <recording_kinect_frame_source.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/high_res_timer.h>
+#include <aug_3d_engine/depth_codec.h>
+
+static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+// Number of index entries reserved per stream up front (about 10 minutes at 30 Hz), so recording
+// sessions of a typical length never allocate on the capture thread
+static const size_t NUM_RESERVED_INDEX_ENTRIES = 30 * 60 * 10;
+
+RecordingKinectFrameSource::RecordingKinectFrameSource(KinectFrameSource* recordedSource) :
+recordedSource(recordedSource), recordingStartTimeInMs(augengine::GetHighResTimeInMs()), sessionFileSize(0),
+numEncodedDepthFrames(0), rawDepthSizeInMB(0.0), encodedDepthSizeInMB(0.0), depthEncodeTimeInMs(0.0) {
+    assert(recordedSource != NULL);
+    memset(&this->fileHeader, 0, sizeof(this->fileHeader));
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        this->index[i].reserve(NUM_RESERVED_INDEX_ENTRIES);
+    }
+}
+
+RecordingKinectFrameSource::~RecordingKinectFrameSource() {
+    if (this->sessionFile.is_open()) {
+        this->WriteIndex();
+        this->sessionFile.close();
+    }
+    if (this->numEncodedDepthFrames > 0) {
+        this->PrintDepthCompressionStats(std::cout);
+    }
+
+    delete this->recordedSource;
+    this->recordedSource = NULL;
+}
+
+/// <summary>
+/// Build a recording frame source, takes ownership of the given recorded source
+/// (it is deleted if the recording source can't be built).
+/// </summary>
+/// <returns> The new recording source, NULL if the session file could not be created. </returns>
+RecordingKinectFrameSource* RecordingKinectFrameSource::Build(KinectFrameSource* recordedSource,
+                                                              const std::string& sessionFilepath) {
+    if (recordedSource == NULL) {
+        return NULL;
+    }
+    std::auto_ptr<RecordingKinectFrameSource> newSource(new RecordingKinectFrameSource(recordedSource));
+
+    newSource->sessionFile.open(sessionFilepath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!newSource->sessionFile.is_open()) {
+        std::cerr << "Failed to create session file " << sessionFilepath << std::endl;
+        return NULL;
+    }
+
+    // The index offset stays zero until the index is written, so an unfinished file can still be scanned
+    kinectsession::FileHeader& header = newSource->fileHeader;
+    memcpy(header.magic, kinectsession::MAGIC, sizeof(header.magic));
+    header.version = kinectsession::FILE_VERSION;
+    recordedSource->GetColourResolution(header.colourWidth, header.colourHeight);
+    recordedSource->GetDepthResolution(header.depthWidth, header.depthHeight);
+    header.depthEncoding = kinectsession::DepthCodec;
+    newSource->sessionFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    newSource->sessionFileSize = sizeof(header);
+
+    // Allocate the depth compression buffers up front so the capture thread never has to
+    newSource->encodedDepthBuffer.resize(augengine::depthcodec::GetMaxEncodedSize(header.depthWidth, header.depthHeight));
+
+    return newSource.release();
+}
+
+bool RecordingKinectFrameSource::AcquireColourFrame(KinectImageFrame& frame) {
+    if (!this->recordedSource->AcquireColourFrame(frame)) {
+        return false;
+    }
+    this->WriteImageRecord(kinectsession::ColourStream, frame);
+    return true;
+}
+
+bool RecordingKinectFrameSource::AcquireDepthFrame(KinectImageFrame& frame) {
+    if (!this->recordedSource->AcquireDepthFrame(frame)) {
+        return false;
+    }
+    this->WriteDepthRecord(frame);
+    return true;
+}
+
+bool RecordingKinectFrameSource::GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame) {
+    if (!this->recordedSource->GetNextSkeletonFrame(frame)) {
+        return false;
+    }
+
+    kinectsession::RecordHeader record;
+    record.streamType      = kinectsession::SkeletonStream;
+    record.frameNumber     = frame.dwFrameNumber;
+    record.timestamp       = frame.liTimeStamp.QuadPart;
+    record.captureTimeInMs = augengine::GetHighResTimeInMs() - this->recordingStartTimeInMs;
+    record.width           = 0;
+    record.height          = 0;
+    record.pitch           = 0;
+    record.payloadSize     = sizeof(NUI_SKELETON_FRAME);
+
+    this->WriteRecord(record, &frame);
+    return true;
+}
+
+void RecordingKinectFrameSource::WriteImageRecord(kinectsession::StreamType streamType,
+                                                  const KinectImageFrame& frame) {
+    kinectsession::RecordHeader record;
+    record.streamType      = streamType;
+    record.frameNumber     = frame.frameNumber;
+    record.timestamp       = frame.timestamp;
+    record.captureTimeInMs = frame.captureTimeInMs - this->recordingStartTimeInMs;
+    record.width           = frame.width;
+    record.height          = frame.height;
+    record.pitch           = frame.pitch;
+    record.payloadSize     = frame.pitch * frame.height;
+
+    this->WriteRecord(record, frame.data);
+}
+
+/// <summary> Write the given depth frame to the session file, compressed with the depth codec. </summary>
+void RecordingKinectFrameSource::WriteDepthRecord(const KinectImageFrame& frame) {
+    if (frame.pitch == 0) {
+        // Bogus frames are recorded (without a payload) so they are played back as bogus too
+        this->WriteImageRecord(kinectsession::DepthStream, frame);
+        return;
+    }
+    assert(frame.pitch == frame.width * static_cast<int>(sizeof(USHORT)));
+
+    double startTimeInMs = augengine::GetHighResTimeInMs();
+    const USHORT* depthInMm = reinterpret_cast<const USHORT*>(frame.data);
+    size_t encodedSize = augengine::depthcodec::Encode(depthInMm, frame.width, frame.height, &this->encodedDepthBuffer[0]);
+    this->depthEncodeTimeInMs += augengine::GetHighResTimeInMs() - startTimeInMs;
+
+    this->numEncodedDepthFrames++;
+    this->rawDepthSizeInMB     += frame.pitch * frame.height / BYTES_PER_MB;
+    this->encodedDepthSizeInMB += encodedSize / BYTES_PER_MB;
+
+    kinectsession::RecordHeader record;
+    record.streamType      = kinectsession::DepthStream;
+    record.frameNumber     = frame.frameNumber;
+    record.timestamp       = frame.timestamp;
+    record.captureTimeInMs = frame.captureTimeInMs - this->recordingStartTimeInMs;
+    record.width           = frame.width;
+    record.height          = frame.height;
+    record.pitch           = frame.pitch;
+    record.payloadSize     = static_cast<unsigned int>(encodedSize);
+
+    this->WriteRecord(record, &this->encodedDepthBuffer[0]);
+}
+
+/// <summary> Write the given record and its payload to the session file and add it to the index. </summary>
+void RecordingKinectFrameSource::WriteRecord(const kinectsession::RecordHeader& record, const void* payload) {
+    assert(record.streamType < kinectsession::NumStreamTypes);
+
+    kinectsession::IndexEntry entry;
+    entry.header = record;
+    entry.payloadOffset = this->sessionFileSize + sizeof(record);
+    this->index[record.streamType].push_back(entry);
+
+    this->sessionFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (record.payloadSize > 0) {
+        this->sessionFile.write(static_cast<const char*>(payload), record.payloadSize);
+    }
+    this->sessionFileSize += sizeof(record) + record.payloadSize;
+}
+
+/// <summary>
+/// Write the index of every stream after the records and point the file header at it,
+/// once this is done no more records can be written.
+/// </summary>
+void RecordingKinectFrameSource::WriteIndex() {
+    this->fileHeader.indexOffset = this->sessionFileSize;
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        const std::vector<kinectsession::IndexEntry>& streamIndex = this->index[i];
+        this->fileHeader.numRecords[i] = static_cast<unsigned int>(streamIndex.size());
+        if (!streamIndex.empty()) {
+            this->sessionFile.write(reinterpret_cast<const char*>(&streamIndex[0]),
+                                    streamIndex.size() * sizeof(kinectsession::IndexEntry));
+        }
+    }
+
+    this->sessionFile.seekp(0, std::ios::beg);
+    this->sessionFile.write(reinterpret_cast<const char*>(&this->fileHeader), sizeof(this->fileHeader));
+    if (!this->sessionFile.good()) {
+        std::cerr << "Failed to write the index of the session file." << std::endl;
+    }
+}
+
+/// <summary> Print how well and how fast the recorded depth frames were compressed. </summary>
+void RecordingKinectFrameSource::PrintDepthCompressionStats(std::ostream& out) const {
+    out << "Depth recording: " << this->numEncodedDepthFrames << " frames, "
+        << this->rawDepthSizeInMB << " MB compressed to " << this->encodedDepthSizeInMB << " MB ("
+        << this->rawDepthSizeInMB / std::max<double>(this->encodedDepthSizeInMB, 1.0 / BYTES_PER_MB) << ":1), encoding at "
+        << this->rawDepthSizeInMB / std::max<double>(this->depthEncodeTimeInMs / 1000.0, 1e-6) << " MB/s" << std::endl;
+}
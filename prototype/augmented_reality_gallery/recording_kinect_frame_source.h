@@ -0,0 +1,88 @@
+#ifndef RECORDING_KINECT_FRAME_SOURCE_H_
+#define RECORDING_KINECT_FRAME_SOURCE_H_
+
+// Augmented Gallery Includes
+#include <kinect_frame_source.h>
+#include <kinect_session_file.h>
+
+/// <summary>
+/// Frame source that passes through the frames of another source while writing every
+/// acquired frame to a session file, which can later be played back with ReplayKinectFrameSource.
+/// Depth frames are losslessly compressed (see augengine::depthcodec) on the capture thread and
+/// the index of the session file is written once the source is destroyed.
+/// </summary>
+class RecordingKinectFrameSource : public KinectFrameSource {
+public:
+    static RecordingKinectFrameSource* Build(KinectFrameSource* recordedSource, const std::string& sessionFilepath);
+    ~RecordingKinectFrameSource();
+
+    void GetColourResolution(int& width, int& height) const;
+    void GetDepthResolution(int& width, int& height) const;
+
+    void WaitForNextFrame(DWORD maxWaitInMs);
+
+    bool AcquireColourFrame(KinectImageFrame& frame);
+    void ReleaseColourFrame();
+    bool AcquireDepthFrame(KinectImageFrame& frame);
+    void ReleaseDepthFrame();
+    bool GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame);
+    bool HasSkeletonFrames() const;
+
+    bool GetColourPixelFromDepthPixel(int depthX, int depthY, USHORT depthInMm, int& colourX, int& colourY) const;
+
+private:
+    RecordingKinectFrameSource(KinectFrameSource* recordedSource);
+
+    KinectFrameSource* recordedSource;  // The source being recorded (owned by this)
+    std::ofstream sessionFile;
+    double recordingStartTimeInMs;
+    kinectsession::FileHeader fileHeader;
+    ULONGLONG sessionFileSize;                                              // Number of bytes written so far
+    std::vector<kinectsession::IndexEntry> index[kinectsession::NumStreamTypes];  // Per-stream index of the written records
+
+    // Depth compression
+    std::vector<BYTE> encodedDepthBuffer;
+    size_t numEncodedDepthFrames;
+    double rawDepthSizeInMB;
+    double encodedDepthSizeInMB;
+    double depthEncodeTimeInMs;
+
+    void WriteRecord(const kinectsession::RecordHeader& record, const void* payload);
+    void WriteImageRecord(kinectsession::StreamType streamType, const KinectImageFrame& frame);
+    void WriteDepthRecord(const KinectImageFrame& frame);
+    void WriteIndex();
+    void PrintDepthCompressionStats(std::ostream& out) const;
+
+    DISALLOW_COPY_AND_ASSIGN(RecordingKinectFrameSource);
+};
+
+inline void RecordingKinectFrameSource::GetColourResolution(int& width, int& height) const {
+    this->recordedSource->GetColourResolution(width, height);
+}
+
+inline void RecordingKinectFrameSource::GetDepthResolution(int& width, int& height) const {
+    this->recordedSource->GetDepthResolution(width, height);
+}
+
+inline void RecordingKinectFrameSource::WaitForNextFrame(DWORD maxWaitInMs) {
+    this->recordedSource->WaitForNextFrame(maxWaitInMs);
+}
+
+inline void RecordingKinectFrameSource::ReleaseColourFrame() {
+    this->recordedSource->ReleaseColourFrame();
+}
+
+inline void RecordingKinectFrameSource::ReleaseDepthFrame() {
+    this->recordedSource->ReleaseDepthFrame();
+}
+
+inline bool RecordingKinectFrameSource::HasSkeletonFrames() const {
+    return this->recordedSource->HasSkeletonFrames();
+}
+
+inline bool RecordingKinectFrameSource::GetColourPixelFromDepthPixel(int depthX, int depthY, USHORT depthInMm,
+                                                                     int& colourX, int& colourY) const {
+    return this->recordedSource->GetColourPixelFromDepthPixel(depthX, depthY, depthInMm, colourX, colourY);
+}
+
+#endif // RECORDING_KINECT_FRAME_SOURCE_H_
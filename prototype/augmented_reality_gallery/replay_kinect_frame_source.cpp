@@ -0,0 +1,333 @@
+// Augmented Gallery Includes
+#include <replay_kinect_frame_source.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/high_res_timer.h>
+#include <aug_3d_engine/depth_codec.h>
+#include <aug_3d_engine/mapped_file.h>
+
+ReplayKinectFrameSource::ReplayKinectFrameSource(PlaybackMode mode, bool loop) : mode(mode), loop(loop),
+sessionFile(NULL), playbackStartTimeInMs(0.0), currDepthFrameIdx(0), seekDepthFrameIdx(NO_SEEK_REQUESTED) {
+    memset(&this->fileHeader, 0, sizeof(this->fileHeader));
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        this->records[i] = NULL;
+        this->numRecords[i] = 0;
+        this->nextRecordIdx[i] = 0;
+        this->payloads[i] = NULL;
+    }
+}
+
+ReplayKinectFrameSource::~ReplayKinectFrameSource() {
+    if (this->sessionFile != NULL) {
+        delete this->sessionFile;
+        this->sessionFile = NULL;
+    }
+}
+
+/// <summary> Build a replay frame source for the given session file. </summary>
+/// <param name="sessionFilepath"> Path to a session file written by RecordingKinectFrameSource. </param>
+/// <param name="mode"> Whether to play frames back with their original timing or as fast as possible. </param>
+/// <param name="loop"> Whether to restart the session once all of its frames have been played. </param>
+/// <returns> The new replay source, NULL if the session file could not be read. </returns>
+ReplayKinectFrameSource* ReplayKinectFrameSource::Build(const std::string& sessionFilepath,
+                                                        PlaybackMode mode, bool loop) {
+
+    std::auto_ptr<ReplayKinectFrameSource> newSource(new ReplayKinectFrameSource(mode, loop));
+
+    newSource->sessionFile = MappedFile::Build(sessionFilepath, NUM_VIEWS);
+    if (newSource->sessionFile == NULL) {
+        std::cerr << "Failed to open session file " << sessionFilepath << std::endl;
+        return NULL;
+    }
+
+    // Files that were never finished (or are from before the index) have to be scanned
+    if (!newSource->ReadFileHeader() ||
+        !(newSource->fileHeader.indexOffset != 0 ? newSource->MapIndex() : newSource->ScanRecords())) {
+        std::cerr << "Invalid or corrupt session file " << sessionFilepath << std::endl;
+        return NULL;
+    }
+
+    if (newSource->fileHeader.depthEncoding == kinectsession::DepthCodec) {
+        newSource->decodedDepthBuffer.resize(newSource->fileHeader.depthWidth * newSource->fileHeader.depthHeight);
+    }
+
+    newSource->playbackStartTimeInMs = augengine::GetHighResTimeInMs();
+    return newSource.release();
+}
+
+/// <summary> Read the file header, the parts missing from older versions of the file are filled in. </summary>
+bool ReplayKinectFrameSource::ReadFileHeader() {
+    // Older headers are a prefix of the current header
+    static const size_t RAW_DEPTH_HEADER_SIZE = offsetof(kinectsession::FileHeader, depthEncoding);
+    static const size_t UNINDEXED_HEADER_SIZE = offsetof(kinectsession::FileHeader, indexOffset);
+
+    const BYTE* header = this->sessionFile->Map(INDEX_VIEW_IDX, 0, RAW_DEPTH_HEADER_SIZE);
+    if (header == NULL) {
+        return false;
+    }
+    memcpy(&this->fileHeader, header, RAW_DEPTH_HEADER_SIZE);
+    if (memcmp(this->fileHeader.magic, kinectsession::MAGIC, sizeof(this->fileHeader.magic)) != 0) {
+        return false;
+    }
+
+    size_t headerSize = 0;
+    switch (this->fileHeader.version) {
+        case kinectsession::RAW_DEPTH_FILE_VERSION:
+            headerSize = RAW_DEPTH_HEADER_SIZE;
+            break;
+        case kinectsession::UNINDEXED_FILE_VERSION:
+            headerSize = UNINDEXED_HEADER_SIZE;
+            break;
+        case kinectsession::FILE_VERSION:
+            headerSize = sizeof(this->fileHeader);
+            break;
+        default:
+            return false;
+    }
+
+    header = this->sessionFile->Map(INDEX_VIEW_IDX, 0, headerSize);
+    if (header == NULL) {
+        return false;
+    }
+    memcpy(&this->fileHeader, header, headerSize);
+    return this->fileHeader.depthEncoding <= kinectsession::DepthCodec;
+}
+
+/// <summary> Point the per-stream record lists straight at the index in the mapped file. </summary>
+bool ReplayKinectFrameSource::MapIndex() {
+    size_t numIndexEntries = 0;
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        numIndexEntries += this->fileHeader.numRecords[i];
+    }
+    if (numIndexEntries == 0) {
+        return true;
+    }
+
+    // The index view is only used for the index from here on, so the index stays mapped
+    const kinectsession::IndexEntry* index = reinterpret_cast<const kinectsession::IndexEntry*>(
+        this->sessionFile->Map(INDEX_VIEW_IDX, this->fileHeader.indexOffset,
+                               numIndexEntries * sizeof(kinectsession::IndexEntry)));
+    if (index == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        this->records[i] = index;
+        this->numRecords[i] = this->fileHeader.numRecords[i];
+        index += this->fileHeader.numRecords[i];
+    }
+    return true;
+}
+
+/// <summary>
+/// Skip through every record header in the session file to build the per-stream record lists,
+/// for files that have no index.
+/// </summary>
+bool ReplayKinectFrameSource::ScanRecords() {
+    ULONGLONG offset = offsetof(kinectsession::FileHeader, indexOffset);
+    if (this->fileHeader.version == kinectsession::RAW_DEPTH_FILE_VERSION) {
+        offset = offsetof(kinectsession::FileHeader, depthEncoding);
+        this->fileHeader.depthEncoding = kinectsession::RawDepth;
+    }
+    else if (this->fileHeader.version == kinectsession::FILE_VERSION) {
+        offset = sizeof(this->fileHeader);
+    }
+
+    kinectsession::IndexEntry entry;
+    const BYTE* recordHeader;
+    while ((recordHeader = this->sessionFile->Map(INDEX_VIEW_IDX, offset, sizeof(entry.header))) != NULL) {
+        memcpy(&entry.header, recordHeader, sizeof(entry.header));
+        if (entry.header.streamType >= kinectsession::NumStreamTypes) {
+            return false;
+        }
+
+        // A truncated final record (e.g., the recording app was killed) is simply ignored
+        entry.payloadOffset = offset + sizeof(entry.header);
+        if (entry.payloadOffset + entry.header.payloadSize > this->sessionFile->GetSize()) {
+            break;
+        }
+        this->scannedRecords[entry.header.streamType].push_back(entry);
+        offset = entry.payloadOffset + entry.header.payloadSize;
+    }
+
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        this->records[i] = this->scannedRecords[i].empty() ? NULL : &this->scannedRecords[i][0];
+        this->numRecords[i] = this->scannedRecords[i].size();
+    }
+    return true;
+}
+
+bool ReplayKinectFrameSource::IsFinished() const {
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        if (this->nextRecordIdx[i] < this->numRecords[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Move the playback cursor of every stream to the first record captured at or after the given
+/// depth frame and carry on playing from there.
+/// </summary>
+void ReplayKinectFrameSource::Seek(size_t depthFrameIdx) {
+    const size_t numDepthRecords = this->numRecords[kinectsession::DepthStream];
+    if (depthFrameIdx >= numDepthRecords) {
+        return;
+    }
+
+    // The streams are each in capture order, so the other streams are searched by capture time
+    double seekTimeInMs = this->records[kinectsession::DepthStream][depthFrameIdx].header.captureTimeInMs;
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        if (i == kinectsession::DepthStream) {
+            this->nextRecordIdx[i] = depthFrameIdx;
+            continue;
+        }
+
+        size_t beginIdx = 0;
+        size_t endIdx   = this->numRecords[i];
+        while (beginIdx < endIdx) {
+            size_t midIdx = beginIdx + (endIdx - beginIdx) / 2;
+            if (this->records[i][midIdx].header.captureTimeInMs < seekTimeInMs) {
+                beginIdx = midIdx + 1;
+            }
+            else {
+                endIdx = midIdx;
+            }
+        }
+        this->nextRecordIdx[i] = beginIdx;
+    }
+
+    this->playbackStartTimeInMs = augengine::GetHighResTimeInMs() - seekTimeInMs;
+    InterlockedExchange(&this->currDepthFrameIdx, static_cast<LONG>(depthFrameIdx));
+}
+
+/// <summary>
+/// Sleep until the next record of any stream is due for playback (or the given time has passed),
+/// when playing back as fast as possible there is always a record due.
+/// </summary>
+void ReplayKinectFrameSource::WaitForNextFrame(DWORD maxWaitInMs) {
+    LONG seekDepthFrameIdx = InterlockedExchange(&this->seekDepthFrameIdx, NO_SEEK_REQUESTED);
+    if (seekDepthFrameIdx != NO_SEEK_REQUESTED) {
+        this->Seek(static_cast<size_t>(seekDepthFrameIdx));
+    }
+
+    if (this->IsFinished()) {
+        // Nothing left to play unless we're about to loop back to the start of the session
+        if (!this->loop) {
+            Sleep(maxWaitInMs);
+        }
+        return;
+    }
+    if (this->mode == AsFastAsPossible) {
+        return;
+    }
+
+    double playbackTimeInMs = augengine::GetHighResTimeInMs() - this->playbackStartTimeInMs;
+    double waitInMs = static_cast<double>(maxWaitInMs);
+    for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+        if (this->nextRecordIdx[i] < this->numRecords[i]) {
+            double timeUntilDueInMs = this->records[i][this->nextRecordIdx[i]].header.captureTimeInMs - playbackTimeInMs;
+            waitInMs = std::min<double>(waitInMs, std::max<double>(timeUntilDueInMs, 0.0));
+        }
+    }
+
+    if (waitInMs > 0.0) {
+        Sleep(static_cast<DWORD>(std::ceil(waitInMs)));
+    }
+}
+
+/// <summary>
+/// Map the payload of the next record that is due for playback in the given stream.
+/// </summary>
+/// <returns> The record that was read, NULL if no record is currently due. </returns>
+const kinectsession::IndexEntry* ReplayKinectFrameSource::ReadNextRecord(kinectsession::StreamType streamType) {
+    if (this->loop && this->IsFinished()) {
+        for (int i = 0; i < kinectsession::NumStreamTypes; i++) {
+            this->nextRecordIdx[i] = 0;
+        }
+        this->playbackStartTimeInMs = augengine::GetHighResTimeInMs();
+    }
+
+    const kinectsession::IndexEntry* streamRecords = this->records[streamType];
+    size_t numStreamRecords = this->numRecords[streamType];
+    size_t& recordIdx = this->nextRecordIdx[streamType];
+    if (recordIdx >= numStreamRecords) {
+        return NULL;
+    }
+
+    if (this->mode == OriginalTiming) {
+        // Skip to the most recent record that was captured at or before the current playback time,
+        // this drops frames the same way a live sensor does when it isn't polled fast enough
+        double playbackTimeInMs = augengine::GetHighResTimeInMs() - this->playbackStartTimeInMs;
+        if (streamRecords[recordIdx].header.captureTimeInMs > playbackTimeInMs) {
+            return NULL;
+        }
+        while (recordIdx + 1 < numStreamRecords &&
+               streamRecords[recordIdx + 1].header.captureTimeInMs <= playbackTimeInMs) {
+            recordIdx++;
+        }
+    }
+
+    const kinectsession::IndexEntry& entry = streamRecords[recordIdx];
+    if (streamType == kinectsession::DepthStream) {
+        InterlockedExchange(&this->currDepthFrameIdx, static_cast<LONG>(recordIdx));
+    }
+    recordIdx++;
+
+    this->payloads[streamType] = NULL;
+    if (entry.header.payloadSize > 0) {
+        this->payloads[streamType] = this->sessionFile->Map(streamType, entry.payloadOffset, entry.header.payloadSize);
+        if (this->payloads[streamType] == NULL) {
+            debug_output("Failed to map record payload from session file.");
+            return NULL;
+        }
+    }
+
+    return &entry;
+}
+
+bool ReplayKinectFrameSource::AcquireImageFrame(kinectsession::StreamType streamType, KinectImageFrame& frame) {
+    const kinectsession::IndexEntry* entry = this->ReadNextRecord(streamType);
+    if (entry == NULL) {
+        return false;
+    }
+
+    const BYTE* payload = this->payloads[streamType];
+
+    frame.width           = entry->header.width;
+    frame.height          = entry->header.height;
+    frame.pitch           = payload == NULL ? 0 : entry->header.pitch;
+    frame.frameNumber     = entry->header.frameNumber;
+    frame.timestamp       = entry->header.timestamp;
+    frame.captureTimeInMs = augengine::GetHighResTimeInMs();
+    frame.data            = payload;
+
+    if (streamType == kinectsession::DepthStream && this->fileHeader.depthEncoding == kinectsession::DepthCodec &&
+        payload != NULL) {
+        if (frame.width != this->fileHeader.depthWidth || frame.height != this->fileHeader.depthHeight ||
+            !augengine::depthcodec::Decode(payload, entry->header.payloadSize, frame.width, frame.height,
+                                           &this->decodedDepthBuffer[0])) {
+            debug_output("Failed to decode depth record from session file.");
+            return false;
+        }
+        frame.data = reinterpret_cast<const BYTE*>(&this->decodedDepthBuffer[0]);
+    }
+
+    return true;
+}
+
+bool ReplayKinectFrameSource::GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame) {
+    const kinectsession::IndexEntry* entry = this->ReadNextRecord(kinectsession::SkeletonStream);
+    if (entry == NULL) {
+        return false;
+    }
+
+    if (entry->header.payloadSize != sizeof(NUI_SKELETON_FRAME)) {
+        debug_output("Skeleton record in session file has an unexpected size.");
+        return false;
+    }
+
+    memcpy(&frame, this->payloads[kinectsession::SkeletonStream], sizeof(NUI_SKELETON_FRAME));
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef REPLAY_KINECT_FRAME_SOURCE_H_
+#define REPLAY_KINECT_FRAME_SOURCE_H_
+
+// Augmented Gallery Includes
+#include <kinect_frame_source.h>
+#include <kinect_session_file.h>
+
+// AugEngine Forward Declarations
+class MappedFile;
+
+/// <summary>
+/// Frame source that plays back a session file written by RecordingKinectFrameSource.
+/// Frames can be played back with the timing they were originally captured with or
+/// as fast as they are polled for (useful for repeatable benchmarking of the pipeline).
+/// The session file is memory mapped: the index is used in place and the frame data is
+/// handed out without being copied (depth is decompressed), so playback can jump to any
+/// depth frame in constant time (see RequestSeek).
+/// </summary>
+class ReplayKinectFrameSource : public KinectFrameSource {
+public:
+    enum PlaybackMode { OriginalTiming, AsFastAsPossible };
+
+    static ReplayKinectFrameSource* Build(const std::string& sessionFilepath, PlaybackMode mode, bool loop);
+    ~ReplayKinectFrameSource();
+
+    void GetColourResolution(int& width, int& height) const;
+    void GetDepthResolution(int& width, int& height) const;
+
+    void WaitForNextFrame(DWORD maxWaitInMs);
+
+    bool AcquireColourFrame(KinectImageFrame& frame);
+    void ReleaseColourFrame();
+    bool AcquireDepthFrame(KinectImageFrame& frame);
+    void ReleaseDepthFrame();
+    bool GetNextSkeletonFrame(NUI_SKELETON_FRAME& frame);
+
+    bool IsFinished() const;
+
+    // Seeking methods, these can be called from any thread
+    size_t GetNumFrames() const;
+    LONG GetCurrentFrame() const;
+    void RequestSeek(LONG depthFrameIdx);
+
+private:
+    // Views of the mapped session file, one per stream so a stream's frame data stays mapped
+    // until its next frame is read, plus one for the index
+    enum { INDEX_VIEW_IDX = kinectsession::NumStreamTypes, NUM_VIEWS = kinectsession::NumStreamTypes + 1 };
+    static const LONG NO_SEEK_REQUESTED = -1;
+
+    ReplayKinectFrameSource(PlaybackMode mode, bool loop);
+
+    PlaybackMode mode;
+    bool loop;
+
+    MappedFile* sessionFile;                // The mapped session file (owned by this)
+    kinectsession::FileHeader fileHeader;
+
+    // Per-stream records in capture order, either in the mapped index or the scanned index
+    const kinectsession::IndexEntry* records[kinectsession::NumStreamTypes];
+    size_t numRecords[kinectsession::NumStreamTypes];
+    std::vector<kinectsession::IndexEntry> scannedRecords[kinectsession::NumStreamTypes];   // Only for files without an index
+
+    size_t nextRecordIdx[kinectsession::NumStreamTypes];    // Per-stream playback cursor
+    const BYTE* payloads[kinectsession::NumStreamTypes];    // Per-stream frame data of the last read record (in the mapped file)
+    std::vector<USHORT> decodedDepthBuffer;                 // Depth image of the last read (compressed) depth record
+
+    double playbackStartTimeInMs;
+    volatile LONG currDepthFrameIdx;    // Index of the last depth frame read
+    volatile LONG seekDepthFrameIdx;    // Depth frame to jump to before reading any more records
+
+    bool ReadFileHeader();
+    bool MapIndex();
+    bool ScanRecords();
+    void Seek(size_t depthFrameIdx);
+    const kinectsession::IndexEntry* ReadNextRecord(kinectsession::StreamType streamType);
+    bool AcquireImageFrame(kinectsession::StreamType streamType, KinectImageFrame& frame);
+
+    DISALLOW_COPY_AND_ASSIGN(ReplayKinectFrameSource);
+};
+
+inline void ReplayKinectFrameSource::GetColourResolution(int& width, int& height) const {
+    width  = this->fileHeader.colourWidth;
+    height = this->fileHeader.colourHeight;
+}
+
+inline void ReplayKinectFrameSource::GetDepthResolution(int& width, int& height) const {
+    width  = this->fileHeader.depthWidth;
+    height = this->fileHeader.depthHeight;
+}
+
+inline bool ReplayKinectFrameSource::AcquireColourFrame(KinectImageFrame& frame) {
+    return this->AcquireImageFrame(kinectsession::ColourStream, frame);
+}
+
+inline void ReplayKinectFrameSource::ReleaseColourFrame() {
+    // Frame data stays in the mapped file, nothing to release
+}
+
+inline bool ReplayKinectFrameSource::AcquireDepthFrame(KinectImageFrame& frame) {
+    return this->AcquireImageFrame(kinectsession::DepthStream, frame);
+}
+
+inline void ReplayKinectFrameSource::ReleaseDepthFrame() {
+    // Frame data stays in the mapped file, nothing to release
+}
+
+/// <summary> Get the number of depth frames in the session. </summary>
+inline size_t ReplayKinectFrameSource::GetNumFrames() const {
+    return this->numRecords[kinectsession::DepthStream];
+}
+
+/// <summary> Get the index of the depth frame that was played last. </summary>
+inline LONG ReplayKinectFrameSource::GetCurrentFrame() const {
+    return this->currDepthFrameIdx;
+}
+
+/// <summary>
+/// Jump playback of all the streams to the given depth frame (clamped to the session), the jump
+/// happens on the thread playing the session back before it reads its next frame.
+/// </summary>
+inline void ReplayKinectFrameSource::RequestSeek(LONG depthFrameIdx) {
+    LONG lastFrameIdx = static_cast<LONG>(this->GetNumFrames()) - 1;
+    InterlockedExchange(&this->seekDepthFrameIdx, std::max<LONG>(0, std::min<LONG>(depthFrameIdx, lastFrameIdx)));
+}
+
+#endif // REPLAY_KINECT_FRAME_SOURCE_H_
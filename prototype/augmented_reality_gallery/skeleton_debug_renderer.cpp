@@ -0,0 +1,153 @@
+// Augmented Gallery Includes
+#include <skeleton_debug_renderer.h>
+#include <skeleton_joint_batch.h>
+
+const float SkeletonDebugRenderer::JOINT_SIZE = 15.0f;
+const float SkeletonDebugRenderer::BONE_WIDTH = 1.5f;
+
+const NUI_SKELETON_POSITION_INDEX SkeletonDebugRenderer::BONES[NUM_BONES][2] = {
+    // Spine
+    { NUI_SKELETON_POSITION_HIP_CENTER,      NUI_SKELETON_POSITION_SPINE },
+    { NUI_SKELETON_POSITION_SPINE,           NUI_SKELETON_POSITION_SHOULDER_CENTER },
+    { NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD },
+    // Left arm
+    { NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT },
+    { NUI_SKELETON_POSITION_SHOULDER_LEFT,   NUI_SKELETON_POSITION_ELBOW_LEFT },
+    { NUI_SKELETON_POSITION_ELBOW_LEFT,      NUI_SKELETON_POSITION_WRIST_LEFT },
+    { NUI_SKELETON_POSITION_WRIST_LEFT,      NUI_SKELETON_POSITION_HAND_LEFT },
+    // Right arm
+    { NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT },
+    { NUI_SKELETON_POSITION_SHOULDER_RIGHT,  NUI_SKELETON_POSITION_ELBOW_RIGHT },
+    { NUI_SKELETON_POSITION_ELBOW_RIGHT,     NUI_SKELETON_POSITION_WRIST_RIGHT },
+    { NUI_SKELETON_POSITION_WRIST_RIGHT,     NUI_SKELETON_POSITION_HAND_RIGHT },
+    // Left leg
+    { NUI_SKELETON_POSITION_HIP_CENTER,      NUI_SKELETON_POSITION_HIP_LEFT },
+    { NUI_SKELETON_POSITION_HIP_LEFT,        NUI_SKELETON_POSITION_KNEE_LEFT },
+    { NUI_SKELETON_POSITION_KNEE_LEFT,       NUI_SKELETON_POSITION_ANKLE_LEFT },
+    { NUI_SKELETON_POSITION_ANKLE_LEFT,      NUI_SKELETON_POSITION_FOOT_LEFT },
+    // Right leg
+    { NUI_SKELETON_POSITION_HIP_CENTER,      NUI_SKELETON_POSITION_HIP_RIGHT },
+    { NUI_SKELETON_POSITION_HIP_RIGHT,       NUI_SKELETON_POSITION_KNEE_RIGHT },
+    { NUI_SKELETON_POSITION_KNEE_RIGHT,      NUI_SKELETON_POSITION_ANKLE_RIGHT },
+    { NUI_SKELETON_POSITION_ANKLE_RIGHT,     NUI_SKELETON_POSITION_FOOT_RIGHT }
+};
+
+static const GLubyte JOINT_COLOUR[4] = { 255, 0, 0, 255 };
+static const GLubyte BONE_COLOUR[4]  = { 0, 255, 0, 255 };
+
+SkeletonDebugRenderer::SkeletonDebugRenderer() : vertexBuffer(0) {
+}
+
+SkeletonDebugRenderer::~SkeletonDebugRenderer() {
+    if (this->vertexBuffer != 0) {
+        glDeleteBuffers(1, &this->vertexBuffer);
+        this->vertexBuffer = 0;
+    }
+}
+
+/// <summary> Build the renderer and its vertex buffer. </summary>
+/// <returns> The new renderer, NULL if vertex buffer objects aren't supported. </returns>
+SkeletonDebugRenderer* SkeletonDebugRenderer::Build() {
+    if (!GLEW_VERSION_1_5 && !GLEW_ARB_vertex_buffer_object) {
+        std::cerr << "Vertex buffer objects aren't supported, can't draw the skeletons." << std::endl;
+        return NULL;
+    }
+
+    std::auto_ptr<SkeletonDebugRenderer> newRenderer(new SkeletonDebugRenderer());
+
+    // The buffer is big enough for every skeleton there can be, it is never resized
+    glGenBuffers(1, &newRenderer->vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, newRenderer->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(newRenderer->vertices), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    augengine::debug_opengl_state();
+    return newRenderer.release();
+}
+
+/// <summary>
+/// Draw the given skeletons into the current (window coordinate) frame of the given size, the
+/// joints' depth image positions are scaled by the size.
+/// </summary>
+void SkeletonDebugRenderer::Draw(const SkeletonJointBatch& joints, float width, float height) {
+    const float* depthXs = joints.GetDepthXs();
+    const float* depthYs = joints.GetDepthYs();
+    const bool* isValid  = joints.GetIsValid();
+
+    int numVertices = 0;
+    for (int skeletonIdx = 0; skeletonIdx < joints.GetNumSkeletons(); skeletonIdx++) {
+        int firstJointIdx = SkeletonJointBatch::GetJointIndex(skeletonIdx, static_cast<NUI_SKELETON_POSITION_INDEX>(0));
+
+        // Joints first so that the bones are drawn over them
+        for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+            int jointIdx = firstJointIdx + joint;
+            if (!isValid[jointIdx]) {
+                continue;
+            }
+            float x = depthXs[jointIdx] * width;
+            float y = depthYs[jointIdx] * height;
+            float halfSize = 0.5f * JOINT_SIZE;
+            float corners[4][2] = { { x - halfSize, y - halfSize }, { x + halfSize, y - halfSize },
+                                    { x + halfSize, y + halfSize }, { x - halfSize, y + halfSize } };
+            numVertices = this->AddQuad(numVertices, corners, JOINT_COLOUR);
+        }
+
+        // Each bone is a thin quad along the line between its joints
+        for (int bone = 0; bone < NUM_BONES; bone++) {
+            int startIdx = firstJointIdx + BONES[bone][0];
+            int endIdx   = firstJointIdx + BONES[bone][1];
+            if (!isValid[startIdx] || !isValid[endIdx]) {
+                continue;
+            }
+
+            float startX = depthXs[startIdx] * width;
+            float startY = depthYs[startIdx] * height;
+            float endX   = depthXs[endIdx] * width;
+            float endY   = depthYs[endIdx] * height;
+
+            float length = sqrt((endX - startX) * (endX - startX) + (endY - startY) * (endY - startY));
+            if (length < FLT_EPSILON) {
+                continue;
+            }
+            float sideX = -(endY - startY) / length * 0.5f * BONE_WIDTH;
+            float sideY =  (endX - startX) / length * 0.5f * BONE_WIDTH;
+            float corners[4][2] = { { startX - sideX, startY - sideY }, { endX - sideX, endY - sideY },
+                                    { endX + sideX, endY + sideY }, { startX + sideX, startY + sideY } };
+            numVertices = this->AddQuad(numVertices, corners, BONE_COLOUR);
+        }
+    }
+    if (numVertices == 0) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(Vertex), this->vertices);
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, x)));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, colour)));
+
+    glDrawArrays(GL_TRIANGLES, 0, numVertices);
+
+    glPopClientAttrib();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    augengine::debug_opengl_state();
+}
+
+/// <summary> Add the two triangles of the given quad (corners in counter-clockwise order) at the given vertex. </summary>
+/// <returns> The index of the vertex after the quad. </returns>
+int SkeletonDebugRenderer::AddQuad(int vertexIdx, const float corners[4][2], const GLubyte colour[4]) {
+    static const int QUAD_CORNERS[VERTICES_PER_QUAD] = { 0, 1, 2, 0, 2, 3 };
+
+    assert(vertexIdx + VERTICES_PER_QUAD <= MAX_VERTICES);
+    for (int i = 0; i < VERTICES_PER_QUAD; i++) {
+        Vertex& vertex = this->vertices[vertexIdx + i];
+        vertex.x = corners[QUAD_CORNERS[i]][0];
+        vertex.y = corners[QUAD_CORNERS[i]][1];
+        memcpy(vertex.colour, colour, sizeof(vertex.colour));
+    }
+    return vertexIdx + VERTICES_PER_QUAD;
+}
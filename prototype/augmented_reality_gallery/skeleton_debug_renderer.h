@@ -0,0 +1,46 @@
+#ifndef SKELETON_DEBUG_RENDERER_H_
+#define SKELETON_DEBUG_RENDERER_H_
+
+// AugEngine Includes
+#include <common.h>
+
+class SkeletonJointBatch;
+
+/// <summary>
+/// Draws the joints (red squares) and bones (green lines) of every skeleton of a SkeletonJointBatch.
+/// Everything is written as coloured triangles into a fixed-size array, uploaded into one persistent
+/// vertex buffer and drawn with a single call, so drawing never allocates.
+/// </summary>
+class SkeletonDebugRenderer {
+public:
+    static SkeletonDebugRenderer* Build();
+    ~SkeletonDebugRenderer();
+
+    void Draw(const SkeletonJointBatch& joints, float width, float height);
+
+private:
+    static const float JOINT_SIZE;
+    static const float BONE_WIDTH;
+    static const int NUM_BONES = 19;
+    static const int VERTICES_PER_QUAD = 6;
+    static const int MAX_VERTICES = NUI_SKELETON_COUNT * (NUI_SKELETON_POSITION_COUNT + NUM_BONES) * VERTICES_PER_QUAD;
+
+    // Joints at either end of every bone
+    static const NUI_SKELETON_POSITION_INDEX BONES[NUM_BONES][2];
+
+    struct Vertex {
+        float x, y;
+        GLubyte colour[4];
+    };
+
+    SkeletonDebugRenderer();
+
+    GLuint vertexBuffer;
+    Vertex vertices[MAX_VERTICES];
+
+    int AddQuad(int vertexIdx, const float corners[4][2], const GLubyte colour[4]);
+
+    DISALLOW_COPY_AND_ASSIGN(SkeletonDebugRenderer);
+};
+
+#endif // SKELETON_DEBUG_RENDERER_H_
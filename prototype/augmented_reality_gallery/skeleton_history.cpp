@@ -0,0 +1,207 @@
+// Augmented Gallery Includes
+#include <skeleton_history.h>
+
+const double SkeletonHistory::DEFAULT_MAX_PREDICTION_IN_MS = 100.0;
+
+// Smallest determinant of the quadratic fit's normal equations before falling back to a linear fit
+static const double MIN_QUADRATIC_FIT_DETERMINANT = 1e-6;
+
+SkeletonHistory::SkeletonHistory() : newestTimeInMs(0.0), maxPredictionInMs(DEFAULT_MAX_PREDICTION_IN_MS) {
+    this->Clear();
+}
+
+SkeletonHistory::~SkeletonHistory() {
+}
+
+void SkeletonHistory::Clear() {
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        SkeletonTrack& track = this->tracks[i];
+        track.trackingId = 0;
+        track.numFrames = 0;
+        track.newestFrameIdx = 0;
+        for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+            track.jointMotions[joint].isValid = false;
+        }
+    }
+}
+
+/// <summary>
+/// Add the given skeleton frame, captured at the given time, to the history and refit the motion
+/// of every joint. A skeleton slot's history starts over when it starts tracking someone else.
+/// </summary>
+void SkeletonHistory::AddFrame(const NUI_SKELETON_FRAME& skeletonFrame, double timeInMs) {
+    this->newestTimeInMs = timeInMs;
+    double sensorTimeInMs = static_cast<double>(skeletonFrame.liTimeStamp.QuadPart);
+
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        const NUI_SKELETON_DATA& skeletonData = skeletonFrame.SkeletonData[i];
+        SkeletonTrack& track = this->tracks[i];
+
+        if (skeletonData.eTrackingState != NUI_SKELETON_TRACKED) {
+            track.numFrames = 0;
+            for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+                track.jointMotions[joint].isValid = false;
+            }
+            continue;
+        }
+        if (track.numFrames > 0 && (track.trackingId != skeletonData.dwTrackingID ||
+                                    sensorTimeInMs <= track.sensorTimesInMs[track.newestFrameIdx])) {
+            track.numFrames = 0;
+        }
+
+        track.trackingId = skeletonData.dwTrackingID;
+        track.newestFrameIdx = (track.newestFrameIdx + 1) % HISTORY_LENGTH;
+        track.numFrames = std::min<size_t>(track.numFrames + 1, HISTORY_LENGTH);
+        track.sensorTimesInMs[track.newestFrameIdx] = sensorTimeInMs;
+
+        for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+            const Vector4& jointPos = skeletonData.SkeletonPositions[joint];
+            track.jointPositions[track.newestFrameIdx][joint] = jointPos;
+
+            // Every now and then a joint comes through at the sensor (z near zero), those are dropped
+            track.jointIsTracked[track.newestFrameIdx][joint] =
+                skeletonData.eSkeletonPositionTrackingState[joint] != NUI_SKELETON_POSITION_NOT_TRACKED &&
+                jointPos.z > FLT_EPSILON;
+
+            this->FitJointMotion(track, joint);
+        }
+    }
+}
+
+/// <summary>
+/// Least squares fit of a quadratic in time through the tracked positions of the given joint,
+/// falling back to a line (or the newest position) when there aren't enough positions.
+/// </summary>
+void SkeletonHistory::FitJointMotion(SkeletonTrack& track, int joint) {
+    JointMotion& motion = track.jointMotions[joint];
+    double newestSensorTimeInMs = track.sensorTimesInMs[track.newestFrameIdx];
+
+    // Sums of the powers of time (relative to the newest frame) and of the positions times those powers
+    double timeSums[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    double posSums[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+    int newestTrackedIdx = -1;
+
+    size_t frameIdx = track.newestFrameIdx;
+    for (size_t i = 0; i < track.numFrames; i++) {
+        if (track.jointIsTracked[frameIdx][joint]) {
+            if (newestTrackedIdx < 0) {
+                newestTrackedIdx = static_cast<int>(frameIdx);
+            }
+
+            double t = track.sensorTimesInMs[frameIdx] - newestSensorTimeInMs;
+            double tPow = 1.0;
+            for (int p = 0; p < 5; p++) {
+                timeSums[p] += tPow;
+                tPow *= t;
+            }
+
+            const Vector4& pos = track.jointPositions[frameIdx][joint];
+            double coords[3] = { pos.x, pos.y, pos.z };
+            for (int axis = 0; axis < 3; axis++) {
+                posSums[axis][0] += coords[axis];
+                posSums[axis][1] += coords[axis] * t;
+                posSums[axis][2] += coords[axis] * t * t;
+            }
+        }
+        frameIdx = (frameIdx + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+    }
+
+    motion.isValid = (newestTrackedIdx >= 0);
+    if (!motion.isValid) {
+        return;
+    }
+
+    double n = timeSums[0];
+    double quadraticDet = timeSums[0] * (timeSums[2]*timeSums[4] - timeSums[3]*timeSums[3]) -
+                          timeSums[1] * (timeSums[1]*timeSums[4] - timeSums[3]*timeSums[2]) +
+                          timeSums[2] * (timeSums[1]*timeSums[3] - timeSums[2]*timeSums[2]);
+    double linearDet = n * timeSums[2] - timeSums[1] * timeSums[1];
+
+    for (int axis = 0; axis < 3; axis++) {
+        const double* b = posSums[axis];
+        if (n >= 3 && fabs(quadraticDet) > MIN_QUADRATIC_FIT_DETERMINANT) {
+            // Solve the normal equations with Cramer's rule
+            double c0 = b[0] * (timeSums[2]*timeSums[4] - timeSums[3]*timeSums[3]) -
+                        timeSums[1] * (b[1]*timeSums[4] - timeSums[3]*b[2]) +
+                        timeSums[2] * (b[1]*timeSums[3] - timeSums[2]*b[2]);
+            double c1 = timeSums[0] * (b[1]*timeSums[4] - b[2]*timeSums[3]) -
+                        b[0] * (timeSums[1]*timeSums[4] - timeSums[3]*timeSums[2]) +
+                        timeSums[2] * (timeSums[1]*b[2] - b[1]*timeSums[2]);
+            double c2 = timeSums[0] * (timeSums[2]*b[2] - timeSums[3]*b[1]) -
+                        timeSums[1] * (timeSums[1]*b[2] - b[1]*timeSums[2]) +
+                        b[0] * (timeSums[1]*timeSums[3] - timeSums[2]*timeSums[2]);
+
+            motion.position[axis]     = static_cast<float>(c0 / quadraticDet);
+            motion.velocity[axis]     = static_cast<float>(c1 / quadraticDet);
+            motion.acceleration[axis] = static_cast<float>(2.0 * c2 / quadraticDet);
+        }
+        else if (n >= 2 && fabs(linearDet) > 0.0) {
+            motion.position[axis]     = static_cast<float>((b[0]*timeSums[2] - b[1]*timeSums[1]) / linearDet);
+            motion.velocity[axis]     = static_cast<float>((n*b[1] - timeSums[1]*b[0]) / linearDet);
+            motion.acceleration[axis] = 0.0f;
+        }
+        else {
+            const Vector4& pos = track.jointPositions[newestTrackedIdx][joint];
+            motion.position[axis]     = (axis == 0) ? pos.x : ((axis == 1) ? pos.y : pos.z);
+            motion.velocity[axis]     = 0.0f;
+            motion.acceleration[axis] = 0.0f;
+        }
+    }
+}
+
+/// <summary> Predict where the given joint of the first tracked skeleton will be at the given time. </summary>
+/// <returns> true if the joint's position could be predicted. </returns>
+bool SkeletonHistory::PredictJointPosition(NUI_SKELETON_POSITION_INDEX joint, double timeInMs, Vector4& pos) const {
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        if (this->tracks[i].numFrames > 0) {
+            return this->PredictJointPosition(i, joint, timeInMs, pos);
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// Predict where the given joint of the given skeleton will be at the given time, which is clamped
+/// to at most the max prediction past the newest skeleton frame (times before it give the fitted
+/// position at the newest skeleton frame).
+/// </summary>
+/// <returns> true if the joint's position could be predicted. </returns>
+bool SkeletonHistory::PredictJointPosition(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint,
+                                           double timeInMs, Vector4& pos) const {
+    assert(skeletonIdx >= 0 && skeletonIdx < NUI_SKELETON_COUNT);
+    const SkeletonTrack& track = this->tracks[skeletonIdx];
+    const JointMotion& motion = track.jointMotions[joint];
+    if (track.numFrames == 0 || !motion.isValid) {
+        return false;
+    }
+
+    float t = static_cast<float>(std::max<double>(0.0, std::min<double>(timeInMs - this->newestTimeInMs,
+                                                                        this->maxPredictionInMs)));
+    float coords[3];
+    for (int axis = 0; axis < 3; axis++) {
+        coords[axis] = motion.position[axis] + t * (motion.velocity[axis] + 0.5f * t * motion.acceleration[axis]);
+    }
+
+    pos.x = coords[0];
+    pos.y = coords[1];
+    pos.z = coords[2];
+    pos.w = 1.0f;
+    return true;
+}
+
+/// <summary> Get the velocity (in skeleton space units per ms) of the given joint at the newest skeleton frame. </summary>
+/// <returns> true if the joint's velocity is known. </returns>
+bool SkeletonHistory::GetJointVelocity(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint, Vector4& velocityPerMs) const {
+    assert(skeletonIdx >= 0 && skeletonIdx < NUI_SKELETON_COUNT);
+    const SkeletonTrack& track = this->tracks[skeletonIdx];
+    const JointMotion& motion = track.jointMotions[joint];
+    if (track.numFrames == 0 || !motion.isValid) {
+        return false;
+    }
+
+    velocityPerMs.x = motion.velocity[0];
+    velocityPerMs.y = motion.velocity[1];
+    velocityPerMs.z = motion.velocity[2];
+    velocityPerMs.w = 0.0f;
+    return true;
+}
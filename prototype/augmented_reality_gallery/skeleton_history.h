@@ -0,0 +1,82 @@
+#ifndef SKELETON_HISTORY_H_
+#define SKELETON_HISTORY_H_
+
+// AugEngine Includes
+#include <common.h>
+
+/// <summary>
+/// Keeps the last few positions of every joint of every tracked skeleton and fits a quadratic
+/// (position, velocity and acceleration) through them, so that joint positions can be predicted
+/// for a time after the newest skeleton frame, e.g., when the frame being rendered will be shown.
+/// This hides the latency between the sensor seeing a joint and the joint showing up on screen.
+/// Times are in ms on the augengine::GetHighResTimeInMs clock, the sensor timestamps are only
+/// used for the spacing between skeleton frames.
+/// </summary>
+class SkeletonHistory {
+public:
+    static const size_t HISTORY_LENGTH = 8;
+    static const double DEFAULT_MAX_PREDICTION_IN_MS;
+
+    SkeletonHistory();
+    ~SkeletonHistory();
+
+    void SetMaxPredictionInMs(double maxPredictionInMs);
+
+    void AddFrame(const NUI_SKELETON_FRAME& skeletonFrame, double timeInMs);
+    void Clear();
+
+    bool IsTracked(int skeletonIdx) const;
+    DWORD GetTrackingId(int skeletonIdx) const;
+
+    bool PredictJointPosition(NUI_SKELETON_POSITION_INDEX joint, double timeInMs, Vector4& pos) const;
+    bool PredictJointPosition(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint, double timeInMs, Vector4& pos) const;
+    bool GetJointVelocity(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint, Vector4& velocityPerMs) const;
+
+private:
+    // Motion of a joint, fitted through its history as pos(t) = position + velocity*t + acceleration*t^2/2
+    // where t is the time (in ms) since the newest skeleton frame
+    struct JointMotion {
+        bool isValid;
+        float position[3];
+        float velocity[3];
+        float acceleration[3];
+    };
+
+    // History of one skeleton slot of the skeleton frames
+    struct SkeletonTrack {
+        DWORD trackingId;
+        size_t numFrames;
+        size_t newestFrameIdx;
+        double sensorTimesInMs[HISTORY_LENGTH];
+        Vector4 jointPositions[HISTORY_LENGTH][NUI_SKELETON_POSITION_COUNT];
+        bool jointIsTracked[HISTORY_LENGTH][NUI_SKELETON_POSITION_COUNT];
+        JointMotion jointMotions[NUI_SKELETON_POSITION_COUNT];
+    };
+
+    SkeletonTrack tracks[NUI_SKELETON_COUNT];
+    double newestTimeInMs;  // When the newest skeleton frame was captured
+    double maxPredictionInMs;
+
+    void FitJointMotion(SkeletonTrack& track, int joint);
+
+    DISALLOW_COPY_AND_ASSIGN(SkeletonHistory);
+};
+
+/// <summary> Set the furthest (in ms) past the newest skeleton frame that joint positions are predicted. </summary>
+inline void SkeletonHistory::SetMaxPredictionInMs(double maxPredictionInMs) {
+    assert(maxPredictionInMs >= 0.0);
+    this->maxPredictionInMs = maxPredictionInMs;
+}
+
+/// <summary> Whether the given skeleton slot was tracking someone in the newest skeleton frame. </summary>
+inline bool SkeletonHistory::IsTracked(int skeletonIdx) const {
+    assert(skeletonIdx >= 0 && skeletonIdx < NUI_SKELETON_COUNT);
+    return this->tracks[skeletonIdx].numFrames > 0;
+}
+
+inline DWORD SkeletonHistory::GetTrackingId(int skeletonIdx) const {
+    assert(this->IsTracked(skeletonIdx));
+    return this->tracks[skeletonIdx].trackingId;
+}
+
+#endif // SKELETON_HISTORY_H_
@@ -0,0 +1,115 @@
+// Augmented Gallery Includes
+#include <skeleton_joint_batch.h>
+#include <skeleton_history.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/cpu_features.h>
+
+// Intrinsics Includes
+#include <emmintrin.h>
+
+// Same projection as NuiTransformSkeletonToDepthImageF: depth image [0,1] = 0.5 +/- pos * scale / z
+static const float DEPTH_X_SCALE = NUI_CAMERA_SKELETON_TO_DEPTH_IMAGE_MULTIPLIER_320x240 / 320.0f;
+static const float DEPTH_Y_SCALE = NUI_CAMERA_SKELETON_TO_DEPTH_IMAGE_MULTIPLIER_320x240 / 240.0f;
+
+SkeletonJointBatch::SkeletonJointBatch() : numSkeletons(0) {
+    memset(this->xs, 0, sizeof(this->xs));
+    memset(this->ys, 0, sizeof(this->ys));
+    memset(this->zs, 0, sizeof(this->zs));
+    memset(this->depthXs, 0, sizeof(this->depthXs));
+    memset(this->depthYs, 0, sizeof(this->depthYs));
+    memset(this->isValid, 0, sizeof(this->isValid));
+}
+
+SkeletonJointBatch::~SkeletonJointBatch() {
+}
+
+/// <summary> Gather and project the joints of every tracked skeleton of the given skeleton frame. </summary>
+void SkeletonJointBatch::Build(const NUI_SKELETON_FRAME& skeletonFrame) {
+    this->numSkeletons = 0;
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        const NUI_SKELETON_DATA& skeletonData = skeletonFrame.SkeletonData[i];
+        if (skeletonData.eTrackingState != NUI_SKELETON_TRACKED) {
+            continue;
+        }
+
+        int firstJointIdx = this->numSkeletons * NUI_SKELETON_POSITION_COUNT;
+        for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+            this->SetJoint(firstJointIdx + joint, skeletonData.SkeletonPositions[joint],
+                           skeletonData.eSkeletonPositionTrackingState[joint] != NUI_SKELETON_POSITION_NOT_TRACKED);
+        }
+        this->trackingIds[this->numSkeletons++] = skeletonData.dwTrackingID;
+    }
+
+    this->Project();
+}
+
+/// <summary> Gather and project the joints of every tracked skeleton as predicted for the given time. </summary>
+void SkeletonJointBatch::Build(const SkeletonHistory& skeletonHistory, double timeInMs) {
+    this->numSkeletons = 0;
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        if (!skeletonHistory.IsTracked(i)) {
+            continue;
+        }
+
+        int firstJointIdx = this->numSkeletons * NUI_SKELETON_POSITION_COUNT;
+        for (int joint = 0; joint < NUI_SKELETON_POSITION_COUNT; joint++) {
+            Vector4 pos;
+            bool isTracked = skeletonHistory.PredictJointPosition(i, static_cast<NUI_SKELETON_POSITION_INDEX>(joint),
+                                                                  timeInMs, pos);
+            this->SetJoint(firstJointIdx + joint, pos, isTracked);
+        }
+        this->trackingIds[this->numSkeletons++] = skeletonHistory.GetTrackingId(i);
+    }
+
+    this->Project();
+}
+
+inline void SkeletonJointBatch::SetJoint(int jointIdx, const Vector4& pos, bool isTracked) {
+    // Joints that aren't tracked (or came through at the sensor) project to zero like they do through NUI
+    isTracked = isTracked && pos.z > FLT_EPSILON;
+    this->isValid[jointIdx] = isTracked;
+    this->xs[jointIdx] = isTracked ? pos.x : 0.0f;
+    this->ys[jointIdx] = isTracked ? pos.y : 0.0f;
+    this->zs[jointIdx] = isTracked ? pos.z : 0.0f;
+}
+
+/// <summary> Project all the gathered joints into the depth image. </summary>
+void SkeletonJointBatch::Project() {
+    // Every skeleton has a multiple of four joints so the SSE2 loop has no remainder
+    assert(NUI_SKELETON_POSITION_COUNT % 4 == 0);
+    int numJoints = this->GetNumJoints();
+
+    if (augengine::cpufeatures::GetInstructionSet() == augengine::cpufeatures::Scalar) {
+        for (int i = 0; i < numJoints; i++) {
+            if (this->zs[i] > FLT_EPSILON) {
+                this->depthXs[i] = 0.5f + this->xs[i] * (DEPTH_X_SCALE / this->zs[i]);
+                this->depthYs[i] = 0.5f - this->ys[i] * (DEPTH_Y_SCALE / this->zs[i]);
+            }
+            else {
+                this->depthXs[i] = 0.0f;
+                this->depthYs[i] = 0.0f;
+            }
+        }
+        return;
+    }
+
+    // The arrays live in heap allocated objects, which aren't 16 byte aligned on 32-bit Windows
+    const __m128 half    = _mm_set1_ps(0.5f);
+    const __m128 xScale  = _mm_set1_ps(DEPTH_X_SCALE);
+    const __m128 yScale  = _mm_set1_ps(DEPTH_Y_SCALE);
+    const __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+    for (int i = 0; i < numJoints; i += 4) {
+        __m128 x = _mm_loadu_ps(&this->xs[i]);
+        __m128 y = _mm_loadu_ps(&this->ys[i]);
+        __m128 z = _mm_loadu_ps(&this->zs[i]);
+
+        // Untracked joints have z = 0, the division gives inf/nan that is masked out
+        __m128 isValidMask = _mm_cmpgt_ps(z, epsilon);
+        __m128 depthX = _mm_add_ps(half, _mm_mul_ps(x, _mm_div_ps(xScale, z)));
+        __m128 depthY = _mm_sub_ps(half, _mm_mul_ps(y, _mm_div_ps(yScale, z)));
+
+        _mm_storeu_ps(&this->depthXs[i], _mm_and_ps(depthX, isValidMask));
+        _mm_storeu_ps(&this->depthYs[i], _mm_and_ps(depthY, isValidMask));
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef SKELETON_JOINT_BATCH_H_
+#define SKELETON_JOINT_BATCH_H_
+
+// AugEngine Includes
+#include <common.h>
+
+class SkeletonHistory;
+
+/// <summary>
+/// Every joint of every tracked skeleton, gathered into structure-of-arrays form and projected into
+/// the depth image in one go (four joints at a time with SSE2). Joint j of the i-th tracked skeleton
+/// is at index GetJointIndex(i, j) of every array. Readers get the projected joints straight from the
+/// arrays without going through the NUI API.
+/// </summary>
+class SkeletonJointBatch {
+public:
+    static const int MAX_JOINTS = NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT;
+
+    SkeletonJointBatch();
+    ~SkeletonJointBatch();
+
+    void Build(const NUI_SKELETON_FRAME& skeletonFrame);
+    void Build(const SkeletonHistory& skeletonHistory, double timeInMs);
+
+    int GetNumSkeletons() const;
+    int GetNumJoints() const;
+    static int GetJointIndex(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint);
+    DWORD GetTrackingId(int skeletonIdx) const;
+
+    // Skeleton space (in meters) positions of the joints
+    const float* GetXs() const;
+    const float* GetYs() const;
+    const float* GetZs() const;
+    // Depth image positions of the joints, in [0,1] with the origin at the top left
+    const float* GetDepthXs() const;
+    const float* GetDepthYs() const;
+    // Whether each joint was tracked (its positions are zero otherwise)
+    const bool* GetIsValid() const;
+
+private:
+    int numSkeletons;
+    DWORD trackingIds[NUI_SKELETON_COUNT];
+
+    float xs[MAX_JOINTS];
+    float ys[MAX_JOINTS];
+    float zs[MAX_JOINTS];
+    float depthXs[MAX_JOINTS];
+    float depthYs[MAX_JOINTS];
+    bool isValid[MAX_JOINTS];
+
+    void SetJoint(int jointIdx, const Vector4& pos, bool isTracked);
+    void Project();
+
+    DISALLOW_COPY_AND_ASSIGN(SkeletonJointBatch);
+};
+
+inline int SkeletonJointBatch::GetNumSkeletons() const {
+    return this->numSkeletons;
+}
+
+inline int SkeletonJointBatch::GetNumJoints() const {
+    return this->numSkeletons * NUI_SKELETON_POSITION_COUNT;
+}
+
+inline int SkeletonJointBatch::GetJointIndex(int skeletonIdx, NUI_SKELETON_POSITION_INDEX joint) {
+    return skeletonIdx * NUI_SKELETON_POSITION_COUNT + joint;
+}
+
+inline DWORD SkeletonJointBatch::GetTrackingId(int skeletonIdx) const {
+    assert(skeletonIdx >= 0 && skeletonIdx < this->numSkeletons);
+    return this->trackingIds[skeletonIdx];
+}
+
+inline const float* SkeletonJointBatch::GetXs() const {
+    return this->xs;
+}
+
+inline const float* SkeletonJointBatch::GetYs() const {
+    return this->ys;
+}
+
+inline const float* SkeletonJointBatch::GetZs() const {
+    return this->zs;
+}
+
+inline const float* SkeletonJointBatch::GetDepthXs() const {
+    return this->depthXs;
+}
+
+inline const float* SkeletonJointBatch::GetDepthYs() const {
+    return this->depthYs;
+}
+
+inline const bool* SkeletonJointBatch::GetIsValid() const {
+    return this->isValid;
+}
+
+#endif // SKELETON_JOINT_BATCH_H_
@@ -0,0 +1,242 @@
+// Offline checks and timings of the depth processing kernels, run over the depth frames of a
+// session recorded by the gallery (see RecordingKinectFrameSource) so they can be repeated on
+// the same data and kept off the capture thread:
+//   depth_benchmark <session file> [--max-frames <n>] [--repeats <n>]
+// Returns non-zero if any of the checks fails.
+
+#include <common.h>
+#include <replay_kinect_frame_source.h>
+
+// AugEngine Includes
+#include <aug_3d_engine/high_res_timer.h>
+#include <aug_3d_engine/cpu_features.h>
+#include <aug_3d_engine/depth_codec.h>
+#include <aug_3d_engine/thread_pool.h>
+#include <aug_3d_engine/temporal_depth_filter.h>
+
+static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+// Number of depth frames loaded by default (10 seconds at 30 Hz), enough for stable timings
+// without holding a whole session in memory
+static const size_t DEFAULT_MAX_FRAMES = 300;
+static const int DEFAULT_REPEATS = 5;
+
+// Time the temporal depth filter may take per 640x480 depth frame on the capture thread
+static const double TEMPORAL_FILTER_BUDGET_IN_MS = 2.0;
+static const int BUDGET_WIDTH  = 640;
+static const int BUDGET_HEIGHT = 480;
+
+typedef std::vector<USHORT> DepthFrame;
+
+struct CommandLineOptions {
+    CommandLineOptions() : maxFrames(DEFAULT_MAX_FRAMES), repeats(DEFAULT_REPEATS) {}
+
+    std::string sessionFilepath;
+    size_t maxFrames;
+    int repeats;
+};
+
+/// <summary>
+/// Parse the command line:
+///   <session file>        Session to load the depth frames from
+///   --max-frames <n>      Number of depth frames to load
+///   --repeats <n>         Number of times every timing is repeated over the loaded frames
+/// </summary>
+bool ParseCommandLine(int argc, char** argv, CommandLineOptions& cmdLineOptions) {
+    for (int i = 1; i < argc; i++) {
+        std::string currArg(argv[i]);
+        if (currArg == "--max-frames" && i + 1 < argc) {
+            cmdLineOptions.maxFrames = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (currArg == "--repeats" && i + 1 < argc) {
+            cmdLineOptions.repeats = std::max<int>(atoi(argv[++i]), 1);
+        }
+        else if (cmdLineOptions.sessionFilepath.empty()) {
+            cmdLineOptions.sessionFilepath = currArg;
+        }
+        else {
+            std::cerr << "Unknown command line argument: " << currArg << std::endl;
+            return false;
+        }
+    }
+    return !cmdLineOptions.sessionFilepath.empty();
+}
+
+/// <summary>
+/// Load (up to maxFrames of) the valid depth frames of the given session, in capture order.
+/// </summary>
+bool LoadDepthFrames(const std::string& sessionFilepath, size_t maxFrames, std::vector<DepthFrame>& frames,
+                     int& width, int& height) {
+    std::auto_ptr<ReplayKinectFrameSource> session(
+        ReplayKinectFrameSource::Build(sessionFilepath, ReplayKinectFrameSource::AsFastAsPossible, false));
+    if (session.get() == NULL) {
+        return false;
+    }
+    session->GetDepthResolution(width, height);
+
+    while (!session->IsFinished() && frames.size() < maxFrames) {
+        session->WaitForNextFrame(0);
+
+        // Colour and skeleton frames are skipped but still have to be consumed
+        KinectImageFrame frame;
+        if (session->AcquireColourFrame(frame)) {
+            session->ReleaseColourFrame();
+        }
+        NUI_SKELETON_FRAME skeletonFrame;
+        session->GetNextSkeletonFrame(skeletonFrame);
+
+        if (session->AcquireDepthFrame(frame)) {
+            // Bogus frames (without any data) are left out
+            if (frame.pitch != 0) {
+                assert(frame.width == width && frame.height == height);
+                const USHORT* depthInMm = reinterpret_cast<const USHORT*>(frame.data);
+                frames.push_back(DepthFrame(depthInMm, depthInMm + width * height));
+            }
+            session->ReleaseDepthFrame();
+        }
+    }
+
+    if (frames.empty()) {
+        std::cerr << "No depth frames in session: " << sessionFilepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Check that the depth codec round-trips every frame losslessly with each supported instruction
+/// set, that they all write the same bytes as the scalar one, and time encoding and decoding.
+/// </summary>
+bool BenchmarkDepthCodec(const std::vector<DepthFrame>& frames, int width, int height, int repeats) {
+    using namespace augengine;
+
+    std::cout << "Depth codec:" << std::endl;
+    const cpufeatures::InstructionSet supportedSet = cpufeatures::GetSupportedInstructionSet();
+    const size_t maxEncodedSize = depthcodec::GetMaxEncodedSize(width, height);
+    const double rawSizeInMB = frames.size() * width * height * sizeof(USHORT) / BYTES_PER_MB;
+
+    std::vector<std::vector<BYTE> > scalarEncodedFrames(frames.size());
+    std::vector<BYTE> encoded(maxEncodedSize);
+    DepthFrame decoded(width * height);
+    bool passed = true;
+
+    for (int set = cpufeatures::Scalar; set <= supportedSet; set++) {
+        const cpufeatures::InstructionSet instructionSet = static_cast<cpufeatures::InstructionSet>(set);
+        cpufeatures::SetInstructionSet(instructionSet);
+
+        // Check every frame before timing anything
+        size_t numFailedFrames = 0;
+        double encodedSizeInMB = 0.0;
+        for (size_t i = 0; i < frames.size(); i++) {
+            size_t encodedSize = depthcodec::Encode(&frames[i][0], width, height, &encoded[0]);
+            encodedSizeInMB += encodedSize / BYTES_PER_MB;
+
+            bool isLossless = depthcodec::Decode(&encoded[0], encodedSize, width, height, &decoded[0]) &&
+                              decoded == frames[i];
+            bool matchesScalar = true;
+            if (instructionSet == cpufeatures::Scalar) {
+                scalarEncodedFrames[i].assign(encoded.begin(), encoded.begin() + encodedSize);
+            }
+            else {
+                matchesScalar = encodedSize == scalarEncodedFrames[i].size() &&
+                                std::equal(scalarEncodedFrames[i].begin(), scalarEncodedFrames[i].end(), encoded.begin());
+            }
+            if (!isLossless || !matchesScalar) {
+                numFailedFrames++;
+            }
+        }
+
+        double encodeTimeInMs = 0.0;
+        double decodeTimeInMs = 0.0;
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            for (size_t i = 0; i < frames.size(); i++) {
+                double startTimeInMs = GetHighResTimeInMs();
+                size_t encodedSize = depthcodec::Encode(&frames[i][0], width, height, &encoded[0]);
+                double encodedTimeInMs = GetHighResTimeInMs();
+                depthcodec::Decode(&encoded[0], encodedSize, width, height, &decoded[0]);
+                decodeTimeInMs += GetHighResTimeInMs() - encodedTimeInMs;
+                encodeTimeInMs += encodedTimeInMs - startTimeInMs;
+            }
+        }
+
+        std::cout << "  " << cpufeatures::GetInstructionSetName(instructionSet) << ": encoding at "
+            << repeats * rawSizeInMB / std::max<double>(encodeTimeInMs / 1000.0, 1e-6) << " MB/s, decoding at "
+            << repeats * rawSizeInMB / std::max<double>(decodeTimeInMs / 1000.0, 1e-6) << " MB/s ("
+            << rawSizeInMB / std::max<double>(encodedSizeInMB, 1.0 / BYTES_PER_MB) << ":1)" << std::endl;
+        if (numFailedFrames != 0) {
+            std::cerr << "  " << cpufeatures::GetInstructionSetName(instructionSet) << ": " << numFailedFrames
+                << " of " << frames.size() << " frames were not round-tripped exactly or differ from scalar" << std::endl;
+            passed = false;
+        }
+    }
+
+    cpufeatures::SetInstructionSet(supportedSet);
+    return passed;
+}
+
+/// <summary>
+/// Time the temporal depth filter over the frames in order, as the capture thread runs it, and check
+/// its mean time per frame against its budget (scaled to the size of the frames).
+/// </summary>
+bool BenchmarkTemporalDepthFilter(const std::vector<DepthFrame>& frames, int width, int height, int repeats,
+                                  ThreadPool* threadPool) {
+    std::cout << "Temporal depth filter on " << threadPool->GetNumThreads() << " threads:" << std::endl;
+    TemporalDepthFilter filter(width, height, threadPool);
+    DepthFrame filtered(width * height);
+
+    double filterTimeInMs = 0.0;
+    double maxFilterTimeInMs = 0.0;
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        // Every repeat starts from the same (empty) state, the filter works in place so it gets a copy
+        filter.Reset();
+        for (size_t i = 0; i < frames.size(); i++) {
+            filtered = frames[i];
+            double startTimeInMs = augengine::GetHighResTimeInMs();
+            filter.Apply(&filtered[0]);
+            double timeInMs = augengine::GetHighResTimeInMs() - startTimeInMs;
+            filterTimeInMs += timeInMs;
+            maxFilterTimeInMs = std::max<double>(maxFilterTimeInMs, timeInMs);
+        }
+    }
+
+    const double meanFilterTimeInMs = filterTimeInMs / (repeats * frames.size());
+    const double budgetInMs = TEMPORAL_FILTER_BUDGET_IN_MS * (width * height) / (BUDGET_WIDTH * BUDGET_HEIGHT);
+    std::cout << "  " << meanFilterTimeInMs << " ms/frame (at most " << maxFilterTimeInMs << " ms), budget "
+        << budgetInMs << " ms/frame" << std::endl;
+    if (meanFilterTimeInMs > budgetInMs) {
+        std::cerr << "  Temporal depth filter is over its budget of " << TEMPORAL_FILTER_BUDGET_IN_MS << " ms per "
+            << BUDGET_WIDTH << "x" << BUDGET_HEIGHT << " frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    CommandLineOptions options;
+    if (!ParseCommandLine(argc, argv, options)) {
+        std::cerr << "Usage: depth_benchmark <session file> [--max-frames <n>] [--repeats <n>]" << std::endl;
+        return 1;
+    }
+
+    std::vector<DepthFrame> frames;
+    int width  = 0;
+    int height = 0;
+    if (!LoadDepthFrames(options.sessionFilepath, options.maxFrames, frames, width, height)) {
+        return 1;
+    }
+    std::cout << "Loaded " << frames.size() << " depth frames (" << width << "x" << height << ") from "
+        << options.sessionFilepath << std::endl;
+
+    bool passed = true;
+    passed &= BenchmarkDepthCodec(frames, width, height, options.repeats);
+
+    // One worker per core, as the gallery's frame processing pool has
+    std::auto_ptr<ThreadPool> threadPool(ThreadPool::Build());
+    if (threadPool.get() == NULL) {
+        std::cerr << "Failed to start the worker threads." << std::endl;
+        return 1;
+    }
+    passed &= BenchmarkTemporalDepthFilter(frames, width, height, options.repeats, threadPool.get());
+
+    return passed ? 0 : 1;
+}